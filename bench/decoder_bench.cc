@@ -0,0 +1,128 @@
+/**
+ * @file decoder_bench.cc
+ * @brief Generic vs compile-time specialized data line decoders
+ * @date 2026-10-17
+ */
+#include "batchdecoder.hh"
+#include "eventlayouts.hh"
+#include <benchmark/benchmark.h>
+
+namespace
+{
+/**
+ * Schema of a FixedLayout, as parseSchema would decode it from the file.
+ */
+template <std::size_t NbFields, std::size_t Next, std::size_t Cell,
+          std::size_t X, std::size_t Y, std::size_t Z,
+          std::size_t Erg, std::size_t Wt, std::size_t Tme>
+EventSchema schemaOf(FixedLayout<NbFields, Next, Cell, X, Y, Z, Erg, Wt, Tme> const &)
+{
+    const std::size_t d = sizeof(double);
+    return EventSchema{0, 0, NbFields * d, true, Next * d, Cell * d,
+                       X * d, Y * d, Z * d, Erg * d, Wt * d, Tme * d};
+}
+
+/// a block of data lines of one layout, the next event is always a collision
+template <typename Layout>
+std::vector<char> makeRecords(std::size_t nbRecords)
+{
+    const EventSchema event = schemaOf(Layout());
+    std::vector<char> records(nbRecords * event.length, 0);
+    for (std::size_t i = 0; i < nbRecords; i++)
+    {
+        char *record = &records[i * event.length];
+        const double values[] = {4000, 601, 1.0 * i, 2.0, 3.0, 1.5, 1.0, 1e6 + i};
+        const std::size_t offsets[] = {event.next, event.cell, event.x, event.y, event.z,
+                                       event.erg, event.wt, event.tme};
+        for (int f = 0; f < 8; f++)
+        {
+            std::memcpy(record + offsets[f], &values[f], sizeof(double));
+        }
+    }
+    return records;
+}
+
+template <typename Layout>
+void decodeRecords(benchmark::State &state, EventDecoder decoder)
+{
+    const std::size_t nbRecords = 4096;
+    const EventSchema event = schemaOf(Layout());
+    const std::vector<char> records = makeRecords<Layout>(nbRecords);
+    NPSHistory history;
+    for (auto _ : state)
+    {
+        history.clear();
+        long next = 0;
+        for (std::size_t i = 0; i < nbRecords; i++)
+        {
+            next += decoder(&records[i * event.length], event.length, event, 1, 4000, history);
+        }
+        benchmark::DoNotOptimize(next);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * nbRecords);
+    state.SetBytesProcessed(state.iterations() * records.size());
+}
+
+template <typename Layout>
+void BM_DecodeGeneric(benchmark::State &state)
+{
+    decodeRecords<Layout>(state, &decodeEventGeneric);
+}
+
+template <typename Layout>
+void BM_DecodeSpecialized(benchmark::State &state)
+{
+    decodeRecords<Layout>(state, &Layout::decode);
+}
+
+/// all fields of the data lines of a history block at once
+void extractRecords(benchmark::State &state, BatchExtractor extractor)
+{
+    const std::size_t nbRecords = 4096;
+    PTRACSchema schema;
+    std::fill(schema.events, schema.events + NbEventTypes, schemaOf(StandardLayout()));
+    const std::vector<char> records = makeRecords<StandardLayout>(nbRecords);
+    const BatchFieldTable table(schema);
+    RecordBatch batch;
+    for (std::size_t i = 0; i < nbRecords; i++)
+    {
+        batch.add(i * StandardLayout::length, static_cast<int64_t>(i % NbEventTypes));
+    }
+    NPSHistory history;
+    history.cellID.resize(nbRecords);
+    for (auto column : {&history.x, &history.y, &history.z, &history.energy, &history.weight, &history.time})
+    {
+        column->resize(nbRecords);
+    }
+    for (auto _ : state)
+    {
+        extractor(records.data(), batch, table, history, 0);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * nbRecords);
+    state.SetBytesProcessed(state.iterations() * records.size());
+}
+
+void BM_ExtractScalar(benchmark::State &state)
+{
+    extractRecords(state, &extractEventsScalar);
+}
+
+void BM_ExtractAVX2(benchmark::State &state)
+{
+    if (!hasAVX2Extractor())
+    {
+        state.SkipWithError("no AVX2 on this CPU");
+        return;
+    }
+    extractRecords(state, &extractEventsAVX2);
+}
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_DecodeGeneric, StandardLayout);
+BENCHMARK_TEMPLATE(BM_DecodeSpecialized, StandardLayout);
+BENCHMARK_TEMPLATE(BM_DecodeGeneric, CompactLayout);
+BENCHMARK_TEMPLATE(BM_DecodeSpecialized, CompactLayout);
+BENCHMARK(BM_ExtractScalar);
+BENCHMARK(BM_ExtractAVX2);
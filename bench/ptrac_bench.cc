@@ -0,0 +1,338 @@
+/**
+ * @file ptrac_bench.cc
+ * @brief Record reading, history decoding, pulse building, pulse output and
+ * end-to-end throughput on a synthetic PTRAC file
+ * @date 2026-10-17
+ */
+#include "deadtime.hh"
+#include "parallelparser.hh"
+#include "pipeline.hh"
+#include "ptracwriter.hh"
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+/**
+ * Synthetic PTRAC file shared by all benchmarks, PTRAC_BENCH_MB megabytes
+ * (32 by default), written once and removed at exit.
+ */
+class BenchFile
+{
+public:
+    static BenchFile const &get()
+    {
+        static const BenchFile file;
+        return file;
+    }
+
+    std::string path;
+    std::size_t size;
+    long nbHistories;
+
+private:
+    BenchFile() : path("ptrac_bench.ptrac")
+    {
+        const char *megabytes = std::getenv("PTRAC_BENCH_MB");
+        const std::size_t target = static_cast<std::size_t>((megabytes ? std::atof(megabytes) : 32) * (1 << 20));
+        nbHistories = writeSyntheticPTRAC(path, LONG_MAX, target);
+        MappedFile file(path);
+        size = file.size();
+    }
+    ~BenchFile() { std::remove(path.c_str()); }
+};
+
+/// discards everything written to it
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) { return c; }
+    std::streamsize xsputn(const char *, std::streamsize n) { return n; }
+};
+
+/// the pulses of the first histories of the file
+std::vector<Pulse> const &benchPulses()
+{
+    static std::vector<Pulse> pulses;
+    if (pulses.empty())
+    {
+        MCNPPTRACMmap ptrac(BenchFile::get().path);
+        while (pulses.size() < 100000 && ptrac.readNextNPS(1e9))
+        {
+            for (auto const &parHist : ptrac.getNPSHistory())
+            {
+                pulses.emplace_back(parHist);
+            }
+        }
+    }
+    return pulses;
+}
+
+void BM_ReadRecord(benchmark::State &state)
+{
+    BenchFile const &file = BenchFile::get();
+    std::ifstream ptrac(file.path, std::ios::binary);
+    std::string record;
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        if (ptrac.peek() == std::char_traits<char>::eof())
+        {
+            ptrac.clear();
+            ptrac.seekg(0);
+        }
+        readRecord(ptrac, record);
+        bytes += record.size() + 2 * sizeof(int);
+    }
+    state.SetBytesProcessed(bytes);
+}
+
+/// parsePTRACRecord of the reader, through readNextNPS
+template <typename Reader>
+void BM_ParsePTRACRecord(benchmark::State &state)
+{
+    BenchFile const &file = BenchFile::get();
+    std::unique_ptr<Reader> ptrac(new Reader(file.path));
+    long nbHistories = 0;
+    for (auto _ : state)
+    {
+        if (!ptrac->readNextNPS(1e9))
+        {
+            state.PauseTiming();
+            ptrac.reset(new Reader(file.path));
+            state.ResumeTiming();
+            ptrac->readNextNPS(1e9);
+        }
+        benchmark::DoNotOptimize(ptrac->getNPSHistory().nbEvents());
+        nbHistories++;
+    }
+    state.SetItemsProcessed(nbHistories);
+    state.SetBytesProcessed(static_cast<int64_t>(nbHistories * (double(file.size) / file.nbHistories)));
+}
+
+/// mmap reader with a projection: the fields of pulses (0), energies only (1),
+/// or the fields of pulses in a cell that no particle reaches (2)
+void BM_ParseProjected(benchmark::State &state)
+{
+    BenchFile const &file = BenchFile::get();
+    EventProjection projection = EventProjection::pulses({SyntheticMix().detectorCell});
+    if (state.range(0) == 1)
+    {
+        projection = EventProjection();
+        projection.fields = EventProjection::Energy;
+    }
+    else if (state.range(0) == 2)
+    {
+        projection.cells = {-1};
+    }
+    std::unique_ptr<MCNPPTRACMmap> ptrac(new MCNPPTRACMmap(file.path));
+    ptrac->setProjection(projection);
+    long nbHistories = 0;
+    for (auto _ : state)
+    {
+        if (!ptrac->readNextNPS(1e9))
+        {
+            state.PauseTiming();
+            ptrac.reset(new MCNPPTRACMmap(file.path));
+            ptrac->setProjection(projection);
+            state.ResumeTiming();
+            ptrac->readNextNPS(1e9);
+        }
+        benchmark::DoNotOptimize(ptrac->getNPSHistory().nbEvents());
+        nbHistories++;
+    }
+    state.SetItemsProcessed(nbHistories);
+    state.SetBytesProcessed(static_cast<int64_t>(nbHistories * (double(file.size) / file.nbHistories)));
+}
+
+void BM_Pulse(benchmark::State &state)
+{
+    MCNPPTRACMmap ptrac(BenchFile::get().path);
+    std::vector<NPSHistory> histories(1000);
+    for (auto &history : histories)
+    {
+        ptrac.readNextNPS(1e9);
+        ptrac.swapNPSHistory(history);
+    }
+    long nbPulses = 0;
+    for (auto _ : state)
+    {
+        for (auto const &history : histories)
+        {
+            for (auto const &parHist : history)
+            {
+                Pulse pulse(parHist);
+                benchmark::DoNotOptimize(pulse.energy);
+                nbPulses++;
+            }
+        }
+    }
+    state.SetItemsProcessed(nbPulses);
+}
+
+/// PulseBuilder with range(0) detector cells around the detector cell
+void BM_PulseBuilder(benchmark::State &state)
+{
+    MCNPPTRACMmap ptrac(BenchFile::get().path);
+    std::vector<NPSHistory> histories(1000);
+    for (auto &history : histories)
+    {
+        ptrac.readNextNPS(1e9);
+        ptrac.swapNPSHistory(history);
+    }
+    std::vector<long> cells;
+    for (long cell = defaultDetectorCell; cell < defaultDetectorCell + state.range(0); cell++)
+    {
+        cells.push_back(cell);
+    }
+    PulseBuilder builder{DetectorCells(cells)};
+    std::vector<Pulse> pulses;
+    long nbParticles = 0;
+    for (auto _ : state)
+    {
+        for (auto const &history : histories)
+        {
+            for (auto const &parHist : history)
+            {
+                pulses.clear();
+                builder.build(parHist, pulses);
+                nbParticles++;
+            }
+        }
+        benchmark::DoNotOptimize(pulses.data());
+    }
+    state.SetItemsProcessed(nbParticles);
+}
+
+/// counts the pulses written to it
+class CountingPulseWriter : public PulseWriter
+{
+public:
+    long nbPulses = 0;
+    void write(const Pulse &) { nbPulses++; }
+    void flush() {}
+};
+
+/**
+ * Pulses of the whole file, with the pulse projection: decoded histories
+ * handed to PulseBuilder for range(0) == 0, PulseVisitor called from the
+ * decoding loop for range(0) == 1.
+ */
+void BM_FileToPulses(benchmark::State &state)
+{
+    BenchFile const &file = BenchFile::get();
+    const std::vector<long> cells = {defaultDetectorCell};
+    for (auto _ : state)
+    {
+        MCNPPTRACMmap ptrac(file.path);
+        ptrac.setProjection(EventProjection::pulses(cells));
+        CountingPulseWriter writer;
+        if (state.range(0) == 0)
+        {
+            PulseBuilder builder{DetectorCells(cells)};
+            std::vector<Pulse> pulses;
+            while (ptrac.readNextNPS(LONG_MAX))
+            {
+                for (auto const &parHist : ptrac.getNPSHistory())
+                {
+                    pulses.clear();
+                    builder.build(parHist, pulses);
+                    for (auto const &pulse : pulses)
+                    {
+                        writer.write(pulse);
+                    }
+                }
+            }
+        }
+        else
+        {
+            PulseVisitor visitor(DetectorCells(cells), writer);
+            ptrac.visit(visitor);
+        }
+        benchmark::DoNotOptimize(writer.nbPulses);
+    }
+    state.SetBytesProcessed(state.iterations() * file.size);
+}
+
+template <typename Writer>
+void BM_WritePulses(benchmark::State &state)
+{
+    std::vector<Pulse> const &pulses = benchPulses();
+    NullBuffer buffer;
+    std::ostream os(&buffer);
+    Writer writer(os);
+    for (auto _ : state)
+    {
+        for (auto const &pulse : pulses)
+        {
+            writer.write(pulse);
+        }
+        writer.flush();
+    }
+    state.SetItemsProcessed(state.iterations() * pulses.size());
+}
+
+/// pile-up and dead time on a sorted train spread over range(0) cells
+void BM_DeadTime(benchmark::State &state)
+{
+    std::vector<Pulse> pulses = benchPulses();
+    std::vector<long> cells;
+    for (long i = 0; i < state.range(0); i++)
+    {
+        cells.push_back(defaultDetectorCell + i);
+    }
+    for (std::size_t i = 0; i < pulses.size(); i++)
+    {
+        pulses[i].time = static_cast<double>(i);
+        pulses[i].cellID = cells[i % cells.size()];
+    }
+    DeadTimeOptions options;
+    options.resolvingTime = 2;
+    options.deadTime = 5;
+    options.model = DeadTimeModel::NonParalyzable;
+    NullBuffer buffer;
+    std::ostream os(&buffer);
+    BinaryPulseWriter writer(os);
+    for (auto _ : state)
+    {
+        DeadTimeWriter stage(writer, DetectorCells(cells), options);
+        for (auto const &pulse : pulses)
+        {
+            stage.write(pulse);
+        }
+        stage.flush();
+    }
+    state.SetItemsProcessed(state.iterations() * pulses.size());
+}
+
+/// the whole file through the pipeline, with the given number of parser threads
+void BM_EndToEnd(benchmark::State &state)
+{
+    BenchFile const &file = BenchFile::get();
+    NullBuffer buffer;
+    std::ostream os(&buffer);
+    for (auto _ : state)
+    {
+        MCNPPTRACParallel ptrac(file.path, static_cast<unsigned>(state.range(0)));
+        BinaryPulseWriter writer(os);
+        PulsePipeline pipeline(ptrac, writer);
+        benchmark::DoNotOptimize(pipeline.run());
+    }
+    state.SetBytesProcessed(state.iterations() * file.size);
+    state.counters["histories/s"] = benchmark::Counter(static_cast<double>(state.iterations() * file.nbHistories),
+                                                       benchmark::Counter::kIsRate);
+}
+} // namespace
+
+BENCHMARK(BM_ReadRecord);
+BENCHMARK_TEMPLATE(BM_ParsePTRACRecord, MCNPPTRACBinary);
+BENCHMARK_TEMPLATE(BM_ParsePTRACRecord, MCNPPTRACMmap);
+BENCHMARK(BM_ParseProjected)->Arg(0)->Arg(1)->Arg(2);
+BENCHMARK(BM_Pulse);
+BENCHMARK(BM_PulseBuilder)->Arg(1)->Arg(3)->Arg(500);
+BENCHMARK(BM_FileToPulses)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_WritePulses, TextPulseWriter);
+BENCHMARK_TEMPLATE(BM_WritePulses, BinaryPulseWriter);
+BENCHMARK(BM_DeadTime)->Arg(1)->Arg(1000)->Arg(10000);
+BENCHMARK(BM_EndToEnd)->Arg(1)->Arg(2)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
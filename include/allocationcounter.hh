@@ -0,0 +1,36 @@
+/**
+ * @file allocationcounter.hh
+ * @brief Counts heap allocations, to check that steady-state parsing makes none
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counting replaces the global operator new, so it is only in the programs
+ * that link the allocationcounter object library (main and tests); the
+ * parser libraries never replace it themselves. Without
+ * PTRAC_INSTRUMENTATION the object library is not built and the counts are 0.
+ */
+namespace AllocationCounter
+{
+#ifdef PTRAC_INSTRUMENTATION
+
+constexpr bool enabled = true;
+
+/// calls to operator new since the start of the program, on all threads
+uint64_t count();
+
+/// calls to operator new since the start of the program, on this thread
+uint64_t threadCount();
+
+#else
+
+constexpr bool enabled = false;
+
+inline uint64_t count() { return 0; }
+inline uint64_t threadCount() { return 0; }
+
+#endif
+} // namespace AllocationCounter
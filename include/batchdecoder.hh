@@ -0,0 +1,83 @@
+/**
+ * @file batchdecoder.hh
+ * @brief Extracts the fields of many data lines at once into event columns
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include "parser.hh"
+#include <cstdint>
+
+/**
+ * @brief Byte offsets of the extracted fields in the data line of each event
+ * type, -1 if the field is not in the data line.
+ *
+ */
+struct BatchFieldTable {
+  enum Field {Cell = 0, X, Y, Z, Energy, Weight, Time, NbFields};
+
+  // offsets[field][EventType], padded to 8 entries for vector loads
+  int64_t offsets[NbFields][8];
+  // false for the fields absent from all event types, which are not extracted
+  bool extracted[NbFields];
+
+  BatchFieldTable() = default;
+  explicit BatchFieldTable(PTRACSchema const &schema);
+};
+
+/**
+ * @brief Data lines found by following the next event chain, waiting to be
+ * extracted.
+ *
+ */
+struct RecordBatch {
+  // start of each data line relative to the buffer
+  std::vector<int64_t> offsets;
+  // EventType of each data line
+  std::vector<int64_t> categories;
+
+  std::size_t size() const { return offsets.size(); }
+  void clear()
+  {
+    offsets.clear();
+    categories.clear();
+  }
+  void add(int64_t offset, int64_t category)
+  {
+    offsets.push_back(offset);
+    categories.push_back(category);
+  }
+  /// keeps the first n data lines
+  void truncate(std::size_t n)
+  {
+    offsets.resize(n);
+    categories.resize(n);
+  }
+};
+
+/**
+ * Fills the cell, position, energy, weight and time columns of the events
+ * [first, first + batch.size()) of history from the data lines of batch.
+ * Absent fields are 0, an absent cell is -1. The columns must already hold
+ * that many events; the columns of fields that are not extracted at all are
+ * left as they are.
+ */
+typedef void (*BatchExtractor)(const char *base, RecordBatch const &batch, BatchFieldTable const &table,
+                               NPSHistory &history, std::size_t first);
+
+/// one data line at a time, works everywhere
+void extractEventsScalar(const char *base, RecordBatch const &batch, BatchFieldTable const &table,
+                         NPSHistory &history, std::size_t first);
+
+/**
+ * Four data lines at a time with AVX2 gathers. Only call it if
+ * hasAVX2Extractor() is true.
+ */
+void extractEventsAVX2(const char *base, RecordBatch const &batch, BatchFieldTable const &table,
+                       NPSHistory &history, std::size_t first);
+
+/// true if this build has the AVX2 extractor and the CPU supports it
+bool hasAVX2Extractor();
+
+/// the fastest extractor the CPU supports, chosen once
+BatchExtractor selectBatchExtractor();
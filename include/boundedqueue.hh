@@ -0,0 +1,74 @@
+/**
+ * @file boundedqueue.hh
+ * @brief Blocking FIFO queue with a fixed capacity, to connect pipeline stages
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+template <typename T>
+class BoundedQueue
+{
+public:
+  explicit BoundedQueue(std::size_t capacity) : capacity(capacity), closed(false) {}
+
+  /**
+   * Blocks while the queue is full.
+   *
+   * @returns false if the queue was closed, the item is then dropped.
+   */
+  bool push(T &&item)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+    if (closed)
+    {
+      return false;
+    }
+    items.push_back(std::move(item));
+    notEmpty.notify_one();
+    return true;
+  }
+
+  /**
+   * Blocks while the queue is empty.
+   *
+   * @returns false if the queue is closed and drained.
+   */
+  bool pop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+    if (items.empty())
+    {
+      return false;
+    }
+    item = std::move(items.front());
+    items.pop_front();
+    notFull.notify_one();
+    return true;
+  }
+
+  /**
+   * Wakes up all waiting threads. Items already queued can still be popped,
+   * further pushes fail.
+   */
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    notFull.notify_all();
+    notEmpty.notify_all();
+  }
+
+private:
+  const std::size_t capacity;
+  bool closed;
+  std::deque<T> items;
+  std::mutex mutex;
+  std::condition_variable notFull;
+  std::condition_variable notEmpty;
+};
@@ -0,0 +1,61 @@
+/**
+ * @file checkpoint.hh
+ * @brief Checkpoints of a pulse extraction, to resume it after it was killed
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include "npsindex.hh"
+#include <string>
+
+/**
+ * @brief Where a pulse extraction stands: the histories read from the PTRAC
+ * file and the bytes of the pulse file that hold their pulses.
+ *
+ * A checkpoint is only taken once the pulses of every history before offset
+ * are written and synced, so the pulse file cut to outputPosition plus the
+ * histories from offset on give the same pulses as an uninterrupted run.
+ */
+struct Checkpoint {
+  std::string ptracPath;
+  FileStamp ptracStamp;
+  long offset = 0;         // offset of the next history to read in the PTRAC file
+  long npsRead = 0;        // histories read before it
+  long nbPulses = 0;       // pulses written before it
+  std::string outputPath;
+  long outputPosition = 0; // bytes of the pulse file that hold these pulses
+  std::string settings;    // options the pulse file depends on, must match to resume
+
+  /// path of the checkpoint of a pulse file
+  static std::string defaultPath(std::string const &outputPath);
+
+  /**
+   * Syncs the pulse file, then writes the checkpoint to a temporary file,
+   * syncs it and renames it, so that the checkpoint at path is always a
+   * whole one that describes data on disk.
+   *
+   * @returns true if successful, false otherwise.
+   */
+  bool save(std::string const &path) const;
+
+  /**
+   * Reads a checkpoint.
+   *
+   * @returns false if the file is missing or corrupt.
+   */
+  bool load(std::string const &path);
+
+  /**
+   * Throws std::runtime_error if the checkpoint was not taken on the same
+   * PTRAC file with the same settings, or if the pulse file is shorter than
+   * outputPosition.
+   */
+  void validate(std::string const &ptracPath, std::string const &settings) const;
+
+  /**
+   * Cuts the pulses written after the checkpoint off the pulse file.
+   *
+   * @returns true if successful, false otherwise.
+   */
+  bool truncateOutput() const;
+};
@@ -0,0 +1,90 @@
+/**
+ * @file coincidence.hh
+ * @brief Streaming coincidence analysis of a time-ordered pulse train
+ * @date 2026-10-17
+ */
+#pragma once
+#include "pulseio.hh"
+#include "ringbuffer.hh"
+#include <cstdint>
+
+struct CoincidenceOptions {
+    double window = 100;                     // multiplicity gate opened by a pulse, shakes
+    double rossiBinWidth = 1;                // shakes
+    std::size_t rossiNbBins = 1000;          // pairs further apart are not counted
+    std::vector<double> feynmanGates = {10, 100, 1000, 10000}; // gate widths, shakes
+};
+
+/**
+ * @brief Counts coincidences in a pulse train sorted by time, as it streams
+ * through the writer interface.
+ *
+ * - Multiplicity: the first pulse opens a gate of the coincidence window,
+ *   every pulse within it belongs to the same event, the next pulse after
+ *   the gate opens a new one.
+ * - Rossi-alpha: time differences between each pulse and every earlier
+ *   pulse within rossiNbBins * rossiBinWidth. The earlier pulses are kept in
+ *   a ring buffer, so memory grows with the pulses in that range only.
+ * - Feynman-Y: the timeline from the first pulse is cut into consecutive
+ *   gates of each width, and the number of pulses in each gate is counted.
+ *   The last gate, which is not complete, is left out.
+ *
+ * Nothing is written; the histograms are read once the writer is flushed.
+ * Throws std::logic_error if a pulse is earlier than the previous one.
+ */
+class CoincidenceCounter : public PulseWriter
+{
+public:
+    CoincidenceCounter(CoincidenceOptions const& options = CoincidenceOptions());
+
+    void write(const Pulse& p);
+
+    /// closes the open multiplicity event
+    void flush();
+
+    CoincidenceOptions const& getOptions() const { return options; }
+    uint64_t getNbPulses() const { return nbPulses; }
+    uint64_t getNbPairs() const { return nbPairs; }
+
+    /// number of events of multiplicity m at index m
+    std::vector<uint64_t> const& getMultiplicity() const { return multiplicity; }
+
+    /// pairs in time difference bin i at index i
+    std::vector<uint64_t> const& getRossiAlpha() const { return rossiAlpha; }
+
+    /// number of gates of the g-th width with n pulses at index n
+    std::vector<uint64_t> const& getFeynmanHistogram(std::size_t g) const { return feynman[g].counts; }
+
+    /// excess variance to mean ratio of the counts in the g-th gate width
+    double feynmanY(std::size_t g) const;
+
+    /// the histograms as text tables
+    void report(std::ostream& os) const;
+
+private:
+    struct FeynmanGate
+    {
+        double width;
+        long current; // index of the open gate
+        uint64_t count; // pulses in the open gate
+        std::vector<uint64_t> counts;
+    };
+
+    CoincidenceOptions options;
+    double rossiRange;
+    bool started;
+    double origin; // time of the first pulse
+    double last;   // time of the previous pulse
+    uint64_t nbPulses;
+    uint64_t nbPairs;
+
+    double gateStart;
+    uint64_t gateCount;
+    std::vector<uint64_t> multiplicity;
+
+    RingBuffer<double> window;
+    std::vector<uint64_t> rossiAlpha;
+    std::vector<FeynmanGate> feynman;
+
+    static void increment(std::vector<uint64_t>& histogram, std::size_t bin, uint64_t n = 1);
+};
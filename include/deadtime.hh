@@ -0,0 +1,83 @@
+/**
+ * @file deadtime.hh
+ * @brief Pile-up and dead time of each detector cell
+ * @date 2026-10-17
+ */
+#pragma once
+#include "pulsebuilder.hh"
+#include "pulseio.hh"
+#include "ringbuffer.hh"
+
+enum class DeadTimeModel
+{
+    None,
+    NonParalyzable, // pulses during the dead time are lost
+    Paralyzable     // lost pulses also extend the dead time
+};
+
+struct DeadTimeOptions {
+    double resolvingTime = 0;               // pulses closer than this pile up, shakes
+    double deadTime = 0;                    // after each recorded pulse, shakes
+    DeadTimeModel model = DeadTimeModel::None;
+};
+
+/**
+ * @brief Applies pile-up and dead time to a pulse train sorted by time, and
+ * passes the recorded pulses on to another writer, still sorted by time.
+ *
+ * Each cell has a small state machine:
+ * - a pulse within the resolving time of the open pulse of its cell piles
+ *   up: its energy is added to the open pulse, which keeps its time and
+ *   start position and takes the end position of the last pulse;
+ * - otherwise, a pulse during the dead time of the cell is lost;
+ * - otherwise, it opens a new pulse and starts the dead time.
+ * With the paralyzable model, piled-up and lost pulses restart the dead
+ * time. An open pulse is passed on once the train is past its resolving
+ * time, so the output stays sorted.
+ *
+ * Throws std::logic_error for a pulse out of time order or in a cell that
+ * is not a detector cell.
+ */
+class DeadTimeWriter : public PulseWriter
+{
+public:
+    DeadTimeWriter(PulseWriter& out, DetectorCells const& cells, DeadTimeOptions const& options);
+
+    void write(const Pulse& p);
+
+    /// passes on the open pulses and flushes the output writer
+    void flush();
+
+    uint64_t getNbPiledUp() const { return nbPiledUp; }
+    uint64_t getNbLost() const { return nbLost; }
+    uint64_t getNbRecorded() const { return nbRecorded; }
+
+private:
+    /// the open pulse is kept without its heap-allocated vectors
+    struct CellState
+    {
+        bool open;
+        double deadUntil;
+        double time;
+        double energy;
+        double startPos[3];
+        double endPos[3];
+        long nps;
+    };
+
+    PulseWriter& out;
+    DetectorCells cells;
+    DeadTimeOptions options;
+    std::vector<CellState> states;
+    // cells with an open pulse, in the order the pulses were opened
+    RingBuffer<int> openCells;
+    double last;
+    uint64_t nbPiledUp;
+    uint64_t nbLost;
+    uint64_t nbRecorded;
+    // reused for every pulse passed on
+    Pulse pulse;
+
+    /// passes on the open pulses that can no longer pile up at time t
+    void close(double t);
+};
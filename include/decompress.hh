@@ -0,0 +1,63 @@
+/**
+ * @file decompress.hh
+ * @brief Streaming decompression of gzip and zstd compressed PTRAC files
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+enum class Compression
+{
+  None,
+  Gzip,
+  Zstd
+};
+
+/// compression of a file from its first bytes, its magic number
+Compression detectCompression(const char *bytes, std::size_t n);
+
+/// compression of the file at path, None if it cannot be read
+Compression detectCompression(std::string const &path);
+
+/// whether zstd support was built in
+bool hasZstd();
+
+/**
+ * @brief Decompresses a gzip stream read from another stream buffer.
+ *
+ * Concatenated gzip members, as written by pigz or by appending .gz files,
+ * are decompressed one after the other into a single stream. A member cut
+ * off before its end throws std::runtime_error.
+ */
+class GzipBuffer : public std::streambuf
+{
+public:
+  explicit GzipBuffer(std::streambuf &source, std::size_t bufferSize = std::size_t(1) << 20);
+  ~GzipBuffer();
+
+  GzipBuffer(GzipBuffer const &) = delete;
+  GzipBuffer &operator=(GzipBuffer const &) = delete;
+
+protected:
+  int_type underflow();
+
+private:
+  std::streambuf &source;
+  z_stream stream;
+  std::vector<char> input;
+  std::vector<char> output;
+  bool finished;
+  // a member was started and its end not reached yet
+  bool inMember;
+};
+
+/**
+ * @returns a stream buffer decompressing source, or nullptr if compression
+ * is None. Throws if the compression is not supported by this build.
+ */
+std::unique_ptr<std::streambuf> makeDecompressor(Compression compression, std::streambuf &source);
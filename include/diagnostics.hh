@@ -0,0 +1,59 @@
+/**
+ * @file diagnostics.hh
+ * @brief Counts and samples of the anomalies met while parsing, reported at
+ * the end instead of printed as they happen
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * Anomalies are counted per thread, so recording one from the decoding
+ * threads is an uncontended store. Only the first few of each kind seen by
+ * each thread are kept as samples, the others are only counted, so a file
+ * full of them costs no more than a counter increment each.
+ */
+namespace Diagnostics
+{
+enum Anomaly
+{
+  UnusualBankEvent,   // bank event numbers other than 2030 and 2033
+  MissingTermination, // particles whose last event is in a detector cell
+  CorruptRegion,      // regions skipped in recovery mode
+  NbAnomalies
+};
+
+/// what an anomaly was recorded with
+struct Sample {
+  long value; // event number, or bytes of a corrupt region
+  long nps;   // history, -1 if it is not known
+};
+
+/// samples kept of each anomaly, over all threads
+constexpr std::size_t maxSamples = 8;
+
+const char *name(Anomaly anomaly);
+/// one line description of an anomaly, for the report
+const char *description(Anomaly anomaly);
+
+void record(Anomaly anomaly, long value, long nps = -1);
+
+/// anomalies recorded so far, by all threads
+uint64_t count(Anomaly anomaly);
+std::vector<Sample> samples(Anomaly anomaly);
+
+/// true if no anomaly was recorded
+bool empty();
+
+void reset();
+
+/// one line per kind of anomaly recorded, with its count and samples
+void report(std::ostream &out);
+
+/// the counts as a JSON object
+void writeJSON(std::ostream &out);
+} // namespace Diagnostics
@@ -0,0 +1,83 @@
+/**
+ * @file eventlayouts.hh
+ * @brief Data line decoders specialized at compile time for known layouts
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include "parser.hh"
+
+/**
+ * @brief A data line layout known at compile time: the number of fields and
+ * the positions (in doubles) of the decoded fields.
+ *
+ */
+template <std::size_t NbFields, std::size_t Next, std::size_t Cell,
+          std::size_t X, std::size_t Y, std::size_t Z,
+          std::size_t Erg, std::size_t Wt, std::size_t Tme>
+struct FixedLayout {
+  static constexpr std::size_t length = NbFields * sizeof(double);
+
+  /// true if the layout decoded from the file is this one
+  static bool matches(EventSchema const &event)
+  {
+    return event.exactLength && event.length == length &&
+           event.next == Next * sizeof(double) && event.cell == Cell * sizeof(double) &&
+           event.x == X * sizeof(double) && event.y == Y * sizeof(double) &&
+           event.z == Z * sizeof(double) && event.erg == Erg * sizeof(double) &&
+           event.wt == Wt * sizeof(double) && event.tme == Tme * sizeof(double);
+  }
+
+  /**
+   * Every offset is a constant, so each field read is a single load.
+   */
+  static long decode(const char *record, std::size_t recordLength, EventSchema const &,
+                     long nps, long type, NPSHistory &history)
+  {
+    if (recordLength != length)
+    {
+      throw std::logic_error("data line length does not match the event type");
+    }
+    auto field = [record](std::size_t position) {
+      return loadBinary<double>(record + position * sizeof(double));
+    };
+    history.addEvent(nps, type, static_cast<long>(field(Cell)),
+                     field(X), field(Y), field(Z), field(Erg), field(Wt), field(Tme));
+    return static_cast<long>(field(Next));
+  }
+};
+
+/**
+ * 6 longs (next event, nodes, bank type, zzaaa, reaction, cell) and 9
+ * doubles (x, y, z, u, v, w, energy, weight, time): the layout of our
+ * production files, and the positions the parser has always assumed.
+ */
+typedef FixedLayout<15, 0, 5, 6, 7, 8, 12, 13, 14> StandardLayout;
+
+/**
+ * 2 longs (next event, cell) and 6 doubles (x, y, z, energy, weight, time):
+ * files written with a PTRAC filter keeping only what pulses need.
+ */
+typedef FixedLayout<8, 0, 1, 2, 3, 4, 5, 6, 7> CompactLayout;
+
+/**
+ * @returns the specialized decoder of the first known layout that matches,
+ * nullptr if none does.
+ */
+template <typename Layout, typename... Layouts>
+struct LayoutSelector {
+  static EventDecoder select(EventSchema const &event)
+  {
+    return Layout::matches(event) ? &Layout::decode : LayoutSelector<Layouts...>::select(event);
+  }
+};
+
+template <typename Layout>
+struct LayoutSelector<Layout> {
+  static EventDecoder select(EventSchema const &event)
+  {
+    return Layout::matches(event) ? &Layout::decode : nullptr;
+  }
+};
+
+typedef LayoutSelector<StandardLayout, CompactLayout> KnownLayouts;
@@ -0,0 +1,122 @@
+/**
+ * @file historyvisitor.hh
+ * @brief Push-style consumers of the events of a PTRAC file
+ * @date 2026-10-17
+ */
+#pragma once
+#include "parser.hh"
+#include <climits>
+
+/**
+ * @brief Callbacks called by the readers for each history, in file order:
+ * onHistoryBegin, then onEvent for each event of a particle followed by
+ * onParticleEnd, for each particle, then onHistoryEnd. A history found
+ * corrupt after onHistoryBegin ends with onHistoryAbort instead: the events
+ * passed on since onHistoryBegin are to be dropped.
+ *
+ * Visitors are template parameters, not virtual classes: a visitor derives
+ * from HistoryVisitor and hides the callbacks it needs, the others do
+ * nothing and compile away. The event passed to onEvent is only valid during
+ * the call.
+ */
+struct HistoryVisitor {
+  void onHistoryBegin(long /*nps*/) {}
+  void onEvent(Event const & /*event*/) {}
+  void onParticleEnd() {}
+  void onHistoryEnd(long /*nps*/) {}
+  void onHistoryAbort(long /*nps*/) {}
+};
+
+/**
+ * @brief Appends the visited events to one vector per field, so that a chunk
+ * of histories ends up as arrays. Particle i owns the events
+ * [particleOffsets[i], particleOffsets[i + 1]); the nps column tells the
+ * histories apart.
+ */
+struct EventColumns : public HistoryVisitor {
+  std::vector<long> nps;
+  std::vector<long> eventID;
+  std::vector<long> cellID;
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> z;
+  std::vector<double> energy;
+  std::vector<double> weight;
+  std::vector<double> time;
+  std::vector<std::size_t> particleOffsets = std::vector<std::size_t>(1, 0);
+
+  void onHistoryBegin(long /*nps*/)
+  {
+    historyEvents = nps.size();
+    historyParticles = particleOffsets.size();
+  }
+  void onEvent(Event const &event)
+  {
+    nps.push_back(event.nps);
+    eventID.push_back(event.eventID);
+    cellID.push_back(event.cellID);
+    x.push_back(event.pos[0]);
+    y.push_back(event.pos[1]);
+    z.push_back(event.pos[2]);
+    energy.push_back(event.energy);
+    weight.push_back(event.weight);
+    time.push_back(event.time);
+  }
+  void onParticleEnd() { particleOffsets.push_back(nps.size()); }
+  void onHistoryAbort(long /*nps*/)
+  {
+    for (auto column : {&nps, &eventID, &cellID})
+      column->resize(historyEvents);
+    for (auto column : {&x, &y, &z, &energy, &weight, &time})
+      column->resize(historyEvents);
+    particleOffsets.resize(historyParticles);
+  }
+
+  std::size_t nbEvents() const { return nps.size(); }
+  std::size_t nbParticles() const { return particleOffsets.size() - 1; }
+
+  /// removes all the events, keeps the capacity
+  void clear()
+  {
+    for (auto column : {&nps, &eventID, &cellID})
+      column->clear();
+    for (auto column : {&x, &y, &z, &energy, &weight, &time})
+      column->clear();
+    particleOffsets.assign(1, 0);
+  }
+
+private:
+  // sizes of the columns before the history being visited
+  std::size_t historyEvents = 0;
+  std::size_t historyParticles = 1;
+};
+
+/**
+ * @brief Visits the histories already decoded by any reader, one
+ * NPSHistory at a time. MCNPPTRACMmap::visit does the same straight from
+ * the mapped file: histories with no event left after the projection
+ * still get onHistoryBegin and onHistoryEnd, with the NPS of their NPS line.
+ *
+ * @returns number of histories read.
+ */
+template <typename Visitor>
+long visitHistories(MCNPPTRAC &ptrac, Visitor &visitor, long maxReadNPS = LONG_MAX)
+{
+  long nbHistories = 0;
+  while (ptrac.readNextNPS(maxReadNPS))
+  {
+    nbHistories++;
+    NPSHistory const &history = ptrac.getNPSHistory();
+    visitor.onHistoryBegin(history.historyNPS);
+    for (auto const &parHist : history)
+    {
+      for (auto const &event : parHist)
+      {
+        visitor.onEvent(event);
+      }
+      visitor.onParticleEnd();
+    }
+    visitor.onHistoryEnd(history.historyNPS);
+  }
+  return nbHistories;
+}
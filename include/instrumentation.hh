@@ -0,0 +1,103 @@
+/**
+ * @file instrumentation.hh
+ * @brief Counters and stage timers of the hot paths, compiled out unless
+ * PTRAC_INSTRUMENTATION is defined
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Process-wide counters and timers. Counting is a relaxed atomic add, done
+ * once per history or per batch rather than per event. Without
+ * PTRAC_INSTRUMENTATION every call is an empty inline function and the
+ * getters return 0.
+ */
+namespace Instrumentation
+{
+enum Counter
+{
+  Bytes,      // PTRAC bytes parsed, after decompression
+  Records,    // NPS lines and data lines
+  Events,     // events kept in the histories
+  Particles,
+  Histories,
+  Pulses,     // pulses handed to the writer by the pipeline
+  NbCounters
+};
+
+enum Stage
+{
+  Read,       // reading and decompressing ahead of the decoder
+  ReadWait,   // decoder waiting for the read ahead
+  Decode,     // pipeline parse stage
+  Build,      // pipeline pulse building stage
+  Write,      // pipeline output stage
+  Checkpoint, // flushing the output and saving checkpoints
+  NbStages
+};
+
+const char *name(Counter counter);
+const char *name(Stage stage);
+
+#ifdef PTRAC_INSTRUMENTATION
+
+constexpr bool enabled = true;
+
+void add(Counter counter, uint64_t n);
+void addTime(Stage stage, uint64_t nanoseconds);
+uint64_t get(Counter counter);
+uint64_t nanoseconds(Stage stage);
+void reset();
+
+/**
+ * @brief Adds the time from its construction to its destruction to a stage.
+ */
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer()
+  {
+    addTime(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  }
+
+  ScopedTimer(ScopedTimer const &) = delete;
+  ScopedTimer &operator=(ScopedTimer const &) = delete;
+
+private:
+  Stage stage;
+  std::chrono::steady_clock::time_point start;
+};
+
+#else
+
+constexpr bool enabled = false;
+
+inline void add(Counter, uint64_t) {}
+inline void addTime(Stage, uint64_t) {}
+inline uint64_t get(Counter) { return 0; }
+inline uint64_t nanoseconds(Stage) { return 0; }
+inline void reset() {}
+
+class ScopedTimer
+{
+public:
+  explicit ScopedTimer(Stage) {}
+};
+
+#endif
+
+/**
+ * Writes the counters, the stage times in seconds, the rates over
+ * wallSeconds and the anomaly counts of Diagnostics as a JSON object. allocations is the number of heap
+ * allocations if the program counts them.
+ */
+void writeJSON(std::ostream &out, double wallSeconds, uint64_t allocations);
+
+/// one line with the rates over seconds: NPS, MB/s and histories/s
+void writeThroughput(std::ostream &out, long nps, double seconds);
+} // namespace Instrumentation
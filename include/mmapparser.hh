@@ -0,0 +1,404 @@
+/**
+ * @file mmapparser.hh
+ * @brief Memory-mapped binary PTRAC file parser
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include "batchdecoder.hh"
+#include "instrumentation.hh"
+#include "npsindex.hh"
+#include "parser.hh"
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @brief Read-only memory map of a whole file.
+ *
+ */
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  MappedFile(std::string const &path);
+  ~MappedFile();
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+
+  bool isOpen() const { return data != nullptr; }
+  const char *begin() const { return data; }
+  const char *end() const { return data + length; }
+  std::size_t size() const { return length; }
+
+private:
+  const char *data = nullptr;
+  std::size_t length = 0;
+};
+
+class MCNPPTRACMmap : public MCNPPTRAC
+{
+protected:
+  std::string path;
+  MappedFile ptracFile;
+  // position of the next record
+  const char *cursor;
+  // NPS line of the first history, right after the header
+  const char *firstHistory;
+  // histories from this NPS on are not read
+  long npsEnd;
+  PTRACSchema schema;
+  // where the fields are in the data line of each event type
+  BatchFieldTable fields;
+  BatchExtractor extractor;
+  NPSIndex index;
+  // length of the NPS lines, to find them again after a corrupt region
+  std::size_t npsLineLength;
+  // last history read without error, to resync after a corrupt region
+  long lastValidNPS;
+
+public:
+  /**
+     * @param[in] ptracPath MCNP ptrac file path.
+     *
+     * Throws std::invalid_argument if the file cannot be mapped.
+     */
+  MCNPPTRACMmap(std::string const &ptracPath);
+
+  /**
+     * If the maximum number of histories has not been reached: reads the history
+     * in PTRAC file.
+     *
+     * @returns true if successful, false otherwise.
+     */
+  bool readNextNPS(long maxReadNPS);
+
+  /**
+   * Loads the NPS index from the sidecar file next to the PTRAC file. If the
+   * sidecar is missing or stale, builds the index by pre-scanning the file
+   * and writes the sidecar.
+   */
+  NPSIndex const &loadIndex(long stride = NPSIndex::defaultStride);
+
+  /**
+   * Moves to the first history whose NPS is not less than nps.
+   *
+   * @returns true if there is such a history, false otherwise.
+   */
+  virtual bool seekToNPS(long nps);
+
+  /**
+   * Restricts reading to the histories with npsBegin <= NPS < npsEnd.
+   *
+   * @returns true if there is a history in the range, false otherwise.
+   */
+  bool setNPSRange(long npsBegin, long npsEnd = LONG_MAX);
+
+  /**
+   * Sets what the next histories read decode. Fields left out are never
+   * loaded from the data lines. Throws std::invalid_argument for cells the
+   * file cannot filter on, see checkProjection.
+   */
+  void setProjection(EventProjection const &projection);
+
+  void setRecovery(bool recover);
+
+  long tell() const;
+
+  /**
+   * Moves to the history starting at offset, as returned by tell, and counts
+   * nbRead histories as read before it.
+   *
+   * @returns false if no history that can be read starts at offset.
+   */
+  virtual bool resume(long offset, long nbRead);
+
+  /**
+   * Passes the next histories to visitor straight from the mapped file,
+   * without filling an NPSHistory. Visitor is any class with the member
+   * functions of HistoryVisitor, called directly so that they can be
+   * inlined into the decoding loop. The projection applies as it does to
+   * readNextNPS; a history none of whose events is kept is still visited.
+   * In recovery mode, a history found corrupt is aborted and skipped.
+   *
+   * @returns number of histories visited.
+   */
+  template <typename Visitor>
+  long visit(Visitor &visitor, long maxReadNPS = LONG_MAX);
+
+protected:
+  /// NPS number of the history starting at position
+  long peekNPS(const char *position) const;
+
+  /// true if there is no history to read from position on
+  bool atRangeEnd(const char *position) const
+  {
+    return position >= ptracFile.end() || (npsEnd != LONG_MAX && peekNPS(position) >= npsEnd);
+  }
+
+  /**
+   * Reads the header
+   */
+  void parseHeader();
+
+  void skipHeader();
+
+  void skipPtracInputData();
+
+  /// decodes the layout of the data lines
+  void parseVariableIDs();
+
+  void parsePTRACRecord();
+
+  /**
+   * Decodes the history whose NPS line starts at begin. Does not touch the
+   * state of the reader, so histories can be decoded concurrently.
+   * The data lines are first found by following the next event chain, then
+   * their fields are extracted all at once.
+   *
+   * @returns start of the next history.
+   */
+  const char *decodeHistory(const char *begin, NPSHistory &history) const;
+
+  /**
+   * Finds the end of the history whose NPS line starts at begin by reading
+   * only the next-event field of each data line. Checks the records as
+   * decodeHistory does, so a history skipped without error decodes without
+   * error.
+   *
+   * @returns start of the next history.
+   */
+  const char *skipHistory(const char *begin, long &nps) const;
+
+  /**
+   * In recovery mode, once the history at the cursor failed to read with
+   * error: moves the cursor to the next history that can be read, or to the
+   * end of the file, and records the region skipped.
+   */
+  void skipCorruptRegion(std::logic_error const &error);
+
+  /**
+   * @returns the first position from from on where a history with an NPS
+   * above lastValidNPS starts and reads without error, the end of the file
+   * if there is none.
+   */
+  const char *resync(const char *from) const;
+
+  /**
+   * Returns the payload of the record at the cursor and advances the cursor
+   * past it. Nothing is copied.
+   */
+  const char *nextRecord(std::size_t &length);
+
+  /**
+   * Calls f(eventID, type, dataLine) for each data line of the particle
+   * whose first event is event, and moves position past them.
+   *
+   * @returns the first event of the next particle, or 9000 at the end of the history.
+   */
+  template <typename F>
+  long walkParticle(const char *&position, long event, std::size_t &nbRecords, F &&f) const;
+
+  /**
+   * Passes the history at position to visitor and moves position past it.
+   * The visitor gets onHistoryAbort if the history turns out corrupt after
+   * onHistoryBegin.
+   *
+   * @returns NPS of the history.
+   */
+  template <typename Visitor>
+  long visitHistory(const char *&position, Visitor &visitor);
+
+  /// value of the double at offset in a data line, 0 for a field that is not extracted
+  static double fieldAt(const char *line, int64_t offset)
+  {
+    return offset < 0 ? 0. : loadBinary<double>(line + offset);
+  }
+};
+
+/*******************************************************
+*  utility functions for parsing mapped FORTRAN files  *
+********************************************************/
+
+/**
+ * Returns the payload of the FORTRAN record starting at cursor and moves the
+ * cursor to the next record.
+ */
+inline const char *nextRecord(const char *&cursor, const char *end, std::size_t &length)
+{
+  if (end - cursor < static_cast<std::ptrdiff_t>(sizeof(int)))
+  {
+    throw std::logic_error("bad stream state after read");
+  }
+  const int rec_len_start = loadBinary<int>(cursor);
+  if (rec_len_start < 0 ||
+      end - cursor < static_cast<std::ptrdiff_t>(2 * sizeof(int)) + rec_len_start)
+  {
+    throw std::logic_error("bad stream state after read");
+  }
+  const char *payload = cursor + sizeof(int);
+  const int rec_len_end = loadBinary<int>(payload + rec_len_start);
+  if (rec_len_start != rec_len_end)
+  {
+    throw std::logic_error("mismatched record length");
+  }
+  cursor = payload + rec_len_start + sizeof(int);
+  length = rec_len_start;
+  return payload;
+}
+
+/************************************************
+*  template methods of the MCNPPTRACMmap class  *
+*************************************************/
+
+template <typename F>
+long MCNPPTRACMmap::walkParticle(const char *&position, long event, std::size_t &nbRecords, F &&f) const
+{
+  constexpr long lastEvent = 9000;
+  do
+  {
+    const int type = eventType(event);
+    if (type < 0 || schema.events[type].next == EventSchema::absent)
+    {
+      throw std::logic_error("unknown event type " + std::to_string(event));
+    }
+    EventSchema const &layout = schema.events[type];
+    std::size_t length;
+    const char *line = ::nextRecord(position, ptracFile.end(), length); // data line
+    if (length < layout.length || (layout.exactLength && length != layout.length))
+    {
+      throw std::logic_error("data line length does not match the event type");
+    }
+    nbRecords++;
+    f(event, type, line);
+    event = static_cast<long>(loadBinary<double>(line + layout.next));
+  } while (!isBnkEvent(event) && event != lastEvent);
+  return event;
+}
+
+template <typename Visitor>
+long MCNPPTRACMmap::visit(Visitor &visitor, long maxReadNPS)
+{
+  long nbHistories = 0;
+  while (true)
+  {
+    // the cursor only moves once the whole history is visited
+    const char *position = cursor;
+    long nps;
+    try
+    {
+      if (atRangeEnd(cursor) || npsRead > maxReadNPS)
+      {
+        break;
+      }
+      nps = visitHistory(position, visitor);
+    }
+    catch (std::logic_error const &error)
+    {
+      if (!recovery)
+      {
+        throw;
+      }
+      skipCorruptRegion(error);
+      continue;
+    }
+    lastValidNPS = nps;
+    cursor = position;
+    incrementNPSRead();
+    nbHistories++;
+  }
+  return nbHistories;
+}
+
+template <typename Visitor>
+long MCNPPTRACMmap::visitHistory(const char *&position, Visitor &visitor)
+{
+  constexpr long lastEvent = 9000;
+  const char *begin = position;
+  std::size_t nbRecords = 1;
+  std::size_t nbEvents = 0;
+  std::size_t nbParticles = 0;
+
+  std::size_t length;
+  const char *buffer = ::nextRecord(position, ptracFile.end(), length); // NPS line
+  if (length < 2 * sizeof(long))
+  {
+    throw std::logic_error("NPS line is too short");
+  }
+  Event event;
+  event.nps = loadBinary<long>(buffer);
+  long next = loadBinary<long>(buffer + sizeof(long));
+  if (!isBnkEvent(next))
+  {
+    throw std::logic_error("expected bank event at the start of the history, got event " + std::to_string(next));
+  }
+
+  visitor.onHistoryBegin(event.nps);
+  try
+  {
+    while (next != lastEvent)
+    {
+      // every particle starts with a bank event, counted once here
+      recordBnkEvent(next);
+      if (!projection.cells.empty())
+      {
+        // a first walk over the particle finds whether it goes through one
+        // of the cells, its events are only passed on if it does
+        const char *particle = position;
+        std::size_t scanned = 0;
+        bool inCells = false;
+        const long following = walkParticle(particle, next, scanned, [&](long, int type, const char *line) {
+          const std::size_t cell = schema.events[type].cell;
+          inCells = inCells || (cell != EventSchema::absent &&
+                                projection.keepsCell(static_cast<long>(loadBinary<double>(line + cell))));
+        });
+        if (!inCells)
+        {
+          nbRecords += scanned;
+          position = particle;
+          next = following;
+          continue;
+        }
+      }
+      std::size_t kept = 0;
+      next = walkParticle(position, next, nbRecords, [&](long id, int type, const char *line) {
+        if (!projection.keepsType(type))
+        {
+          return;
+        }
+        const int64_t cell = fields.offsets[BatchFieldTable::Cell][type];
+        event.eventID = id;
+        event.cellID = cell < 0 ? -1 : static_cast<long>(loadBinary<double>(line + cell));
+        event.pos = {fieldAt(line, fields.offsets[BatchFieldTable::X][type]),
+                     fieldAt(line, fields.offsets[BatchFieldTable::Y][type]),
+                     fieldAt(line, fields.offsets[BatchFieldTable::Z][type])};
+        event.energy = fieldAt(line, fields.offsets[BatchFieldTable::Energy][type]);
+        event.weight = fieldAt(line, fields.offsets[BatchFieldTable::Weight][type]);
+        event.time = fieldAt(line, fields.offsets[BatchFieldTable::Time][type]);
+        visitor.onEvent(event);
+        kept++;
+      });
+      if (kept > 0)
+      {
+        visitor.onParticleEnd();
+        nbEvents += kept;
+        nbParticles++;
+      }
+    }
+  }
+  catch (std::logic_error const &)
+  {
+    visitor.onHistoryAbort(event.nps);
+    throw;
+  }
+  visitor.onHistoryEnd(event.nps);
+
+  Instrumentation::add(Instrumentation::Bytes, position - begin);
+  Instrumentation::add(Instrumentation::Records, nbRecords);
+  Instrumentation::add(Instrumentation::Events, nbEvents);
+  Instrumentation::add(Instrumentation::Particles, nbParticles);
+  Instrumentation::add(Instrumentation::Histories, 1);
+  return event.nps;
+}
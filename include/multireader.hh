@@ -0,0 +1,121 @@
+/**
+ * @file multireader.hh
+ * @brief Reads the PTRAC files of several MCNP jobs as a single file
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include "boundedqueue.hh"
+#include "parser.hh"
+#include "threadpool.hh"
+#include <memory>
+
+/**
+ * @returns a reader of one PTRAC file: memory mapped, or streamed and
+ * decompressed if the file is compressed.
+ */
+std::unique_ptr<MCNPPTRAC> openPTRAC(std::string const &path);
+
+/**
+ * Expands the shell wildcards of each pattern, like job.*\/ptrac, into the
+ * matching paths in sorted order. Patterns without a match are kept as they
+ * are.
+ */
+std::vector<std::string> expandPTRACPaths(std::vector<std::string> const &patterns);
+
+/**
+ * @brief Reads several PTRAC files, one reader per file on a shared thread
+ * pool, and hands back their histories one file after the other.
+ *
+ * Each file is parsed by its own task into a bounded queue of batches, so
+ * the files after the one being consumed are parsed ahead of it. Parsing
+ * starts with the first read. NPS are
+ * renumbered: the histories of a file are shifted by the last NPS of the
+ * files before it, so that NPS keep increasing and do not collide between
+ * jobs that each start from 1. The last NPS is that of the last NPS line of
+ * the file, whatever the projection keeps of its history.
+ */
+class MCNPPTRACMulti : public MCNPPTRAC
+{
+public:
+  /**
+     * @param[in] paths PTRAC files, in the order they are read.
+     * @param[in] nbThreads number of files parsed at once, 0 for one per core.
+     * @param[in] batchSize number of histories per batch.
+     * @param[in] nbBatches batches parsed ahead for each file.
+     */
+  MCNPPTRACMulti(std::vector<std::string> const &paths, unsigned nbThreads = 0,
+                 std::size_t batchSize = 1024, std::size_t nbBatches = 4);
+  ~MCNPPTRACMulti();
+
+  MCNPPTRACMulti(MCNPPTRACMulti const &) = delete;
+  MCNPPTRACMulti &operator=(MCNPPTRACMulti const &) = delete;
+
+  /**
+     * If the maximum number of histories has not been reached: reads the next
+     * history of the current file, or of the next one.
+     *
+     * @returns true if successful, false otherwise. Rethrows the errors of
+     * the parsing tasks.
+     */
+  bool readNextNPS(long maxReadNPS);
+
+  /**
+     * Sets what the readers of the files decode. The files are parsed from
+     * the first read on, so this must be called before it.
+     */
+  void setProjection(EventProjection const &projection);
+
+  /**
+     * Sets recovery mode for the readers of the files, before the first read.
+     * The regions skipped in a file are reported once the file is read, with
+     * the NPS renumbered. Throws std::invalid_argument if a file is
+     * compressed, its reader cannot skip.
+     */
+  void setRecovery(bool recover);
+
+  std::size_t getNbFiles() const { return files.size(); }
+
+  /// file being read, getNbFiles() once all are read
+  std::size_t getCurrentFile() const { return current; }
+
+  /// added to the NPS of the current file
+  long getNPSOffset() const { return offset; }
+
+private:
+  struct Batch
+  {
+    std::vector<NPSHistory> histories;
+    std::size_t size = 0;
+  };
+  struct File
+  {
+    std::string path;
+    BoundedQueue<Batch> filled;
+    BoundedQueue<Batch> free;
+    std::future<void> task;
+    // regions skipped by the reader of the file, set before the task ends
+    std::vector<SkippedRegion> skipped;
+
+    File(std::string const &path, std::size_t nbBatches) : path(path), filled(nbBatches), free(nbBatches) {}
+  };
+
+  std::size_t batchSize;
+  std::vector<std::unique_ptr<File>> files;
+  bool started;
+  // file being consumed, its batch and the position in it
+  std::size_t current;
+  Batch batch;
+  std::size_t position;
+  long offset;
+  // NPS line of the last history read from the current file, before renumbering
+  long lastNPS;
+  // declared last so that the tasks finish before the files go away
+  ThreadPool pool;
+
+  /// submits the parsing of all the files
+  void start();
+  void parseFile(File &file);
+  /// next batch of the current file or the following ones, false at the end
+  bool nextBatch();
+};
@@ -0,0 +1,89 @@
+/**
+ * @file npsindex.hh
+ * @brief Sparse NPS number to file offset index of a PTRAC file
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Size and modification time of a file, used to tell whether a
+ * sidecar index still describes it.
+ *
+ */
+struct FileStamp {
+  long size;
+  long mtimeSec;
+  long mtimeNsec;
+
+  /// stamp of the file at path, all -1 if it cannot be stat'ed
+  static FileStamp of(std::string const &path);
+  bool operator==(FileStamp const &other) const
+  {
+    return size == other.size && mtimeSec == other.mtimeSec && mtimeNsec == other.mtimeNsec;
+  }
+};
+
+/**
+ * @brief Offsets of every stride-th history of a PTRAC file.
+ *
+ * Any history is reached by jumping to the closest indexed history before it
+ * and skipping at most stride - 1 histories, so the index stays small even
+ * for billions of histories.
+ */
+class NPSIndex
+{
+public:
+  struct Entry {
+    long nps;
+    long offset; // offset of the NPS line from the start of the file
+  };
+
+  static constexpr long defaultStride = 1024;
+
+  explicit NPSIndex(long stride = defaultStride);
+
+  /// path of the sidecar index file of a PTRAC file
+  static std::string sidecarPath(std::string const &ptracPath);
+
+  /**
+   * Appends a history. Histories must be added in file order.
+   */
+  void add(long nps, long offset);
+
+  /**
+   * Reads an index file. The entries must be in file order, between
+   * firstOffset, where the first history starts, and the end of the file.
+   *
+   * @returns false if the file is missing, corrupt or does not match stamp.
+   */
+  bool load(std::string const &path, FileStamp const &stamp, long firstOffset = 0);
+
+  /**
+   * Writes the index file atomically.
+   *
+   * @returns true if successful, false otherwise.
+   */
+  bool save(std::string const &path, FileStamp const &stamp) const;
+
+  /**
+   * @returns the last indexed history whose NPS is not greater than nps, or
+   * nullptr if nps is before the first history.
+   */
+  Entry const *floor(long nps) const;
+
+  bool empty() const { return nbHistories == 0; }
+  long getStride() const { return stride; }
+  long getNbHistories() const { return nbHistories; }
+  long getFirstNPS() const { return entries.empty() ? -1 : entries.front().nps; }
+  long getLastNPS() const { return lastNPS; }
+  std::vector<Entry> const &getEntries() const { return entries; }
+
+private:
+  long stride;
+  long nbHistories;
+  long lastNPS;
+  std::vector<Entry> entries;
+};
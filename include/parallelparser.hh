@@ -0,0 +1,111 @@
+/**
+ * @file parallelparser.hh
+ * @brief Multi-threaded binary PTRAC file parser
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include "mmapparser.hh"
+#include "threadpool.hh"
+
+/**
+ * @brief Decodes batches of histories on a thread pool.
+ *
+ * The start of every history is found by a cheap pre-scan that only reads
+ * the record markers and the next-event field of each data line. Each batch
+ * is then split into chunks of whole histories that are decoded concurrently,
+ * while the caller consumes the previous batch. Histories are handed back in
+ * file order, so the output is the same as MCNPPTRACMmap.
+ */
+class MCNPPTRACParallel : public MCNPPTRACMmap
+{
+protected:
+  struct Batch
+  {
+    std::vector<const char *> starts;
+    std::vector<NPSHistory> histories;
+    std::vector<std::future<void>> tasks;
+  };
+
+  std::size_t batchSize;
+  Batch batches[2];
+  // false until the first read, and again after a seek or a new projection
+  bool started;
+  // batch being consumed and position in it
+  int active;
+  std::size_t position;
+  // declared last so that queued tasks finish before the batches go away
+  ThreadPool pool;
+
+public:
+  /**
+     * @param[in] ptracPath MCNP ptrac file path.
+     * @param[in] nbThreads number of decoding threads, 0 for one per core.
+     * @param[in] batchSize number of histories per batch.
+     */
+  MCNPPTRACParallel(std::string const &ptracPath, unsigned nbThreads = 0,
+                    std::size_t batchSize = 4096);
+
+  /**
+     * If the maximum number of histories has not been reached: reads the history
+     * in PTRAC file.
+     *
+     * @returns true if successful, false otherwise.
+     */
+  bool readNextNPS(long maxReadNPS);
+
+  /**
+   * Moves to the first history whose NPS is not less than nps. Batches that
+   * were already decoded are dropped.
+   *
+   * @returns true if there is such a history, false otherwise.
+   */
+  bool seekToNPS(long nps);
+
+  /// offset of the next history handed back, not of the ones decoded ahead
+  long tell() const;
+
+  /**
+   * Moves to the history starting at offset, see MCNPPTRACMmap::resume.
+   * Batches that were already decoded are dropped.
+   */
+  bool resume(long offset, long nbRead);
+
+  /**
+   * Sets what the next histories read decode, the histories decoded ahead
+   * are decoded again.
+   */
+  void setProjection(EventProjection const &projection);
+
+  /**
+   * Visits the next histories on the calling thread, see
+   * MCNPPTRACMmap::visit. The histories decoded ahead are dropped.
+   */
+  template <typename Visitor>
+  long visit(Visitor &visitor, long maxReadNPS = LONG_MAX)
+  {
+    stopBatches();
+    return MCNPPTRACMmap::visit(visitor, maxReadNPS);
+  }
+
+protected:
+  /**
+   * Pre-scans the next histories from the cursor and queues their decoding.
+   */
+  void scheduleBatch(Batch &batch);
+
+  /**
+   * Blocks until all the histories of the batch are decoded.
+   */
+  void waitBatch(Batch &batch);
+
+  /// waits for the tasks of both batches
+  void cancelBatches();
+  /// start of the next history to hand back
+  const char *nextHistory() const;
+  /// drops the batches decoded ahead and moves the cursor back to the next history to read
+  void stopBatches();
+
+  /// schedules both batches from the cursor and waits for the first
+  void restartBatches();
+};
@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <array>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -18,29 +20,216 @@
 #include <tuple>
 #include <utility>
 #include <vector>
-#include <list>
+#include <iterator>
+#include "decompress.hh"
+#include "diagnostics.hh"
+#include "readahead.hh"
+#include <memory>
 
 struct Event {
   long nps, eventID;
   long cellID;
-  std::vector<double> pos;
+  std::array<double, 3> pos;
   double energy;
   double weight;
   double time;
 };
 
+class NPSHistory;
+
 /**
  * @brief class of a single particle's history.
- * consists of multiple events.
+ * consists of multiple events. It is a view of a range of the event columns
+ * of a NPSHistory, and is only valid while that history is not modified.
  * 
  */
-typedef std::list<Event> ParticleHistory;
+class ParticleHistory
+{
+public:
+  /**
+   * @brief Random access iterator over the events. Events are assembled from
+   * the columns when dereferenced.
+   */
+  class const_iterator
+  {
+  public:
+    struct EventPointer {
+      Event event;
+      Event const *operator->() const { return &event; }
+    };
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef Event value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Event reference;
+    typedef EventPointer pointer;
+
+    const_iterator() : history(nullptr), index(0) {}
+    const_iterator(NPSHistory const *history, std::size_t index) : history(history), index(index) {}
+
+    Event operator*() const;
+    EventPointer operator->() const { return EventPointer{**this}; }
+    Event operator[](difference_type n) const { return *(*this + n); }
+
+    const_iterator &operator++() { ++index; return *this; }
+    const_iterator operator++(int) { const_iterator old(*this); ++index; return old; }
+    const_iterator &operator--() { --index; return *this; }
+    const_iterator operator--(int) { const_iterator old(*this); --index; return old; }
+    const_iterator &operator+=(difference_type n) { index += n; return *this; }
+    const_iterator &operator-=(difference_type n) { index -= n; return *this; }
+    const_iterator operator+(difference_type n) const { return const_iterator(history, index + n); }
+    const_iterator operator-(difference_type n) const { return const_iterator(history, index - n); }
+    difference_type operator-(const_iterator const &other) const { return index - other.index; }
+
+    bool operator==(const_iterator const &other) const { return index == other.index; }
+    bool operator!=(const_iterator const &other) const { return index != other.index; }
+    bool operator<(const_iterator const &other) const { return index < other.index; }
+    bool operator>(const_iterator const &other) const { return index > other.index; }
+    bool operator<=(const_iterator const &other) const { return index <= other.index; }
+    bool operator>=(const_iterator const &other) const { return index >= other.index; }
+
+    /// position of the event in the columns of the NPSHistory
+    std::size_t getIndex() const { return index; }
+
+  private:
+    NPSHistory const *history;
+    std::size_t index;
+  };
+  typedef const_iterator iterator;
+  typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+  ParticleHistory() : history(nullptr), firstEvent(0), lastEvent(0) {}
+  ParticleHistory(NPSHistory const *history, std::size_t first, std::size_t last)
+      : history(history), firstEvent(first), lastEvent(last) {}
+
+  std::size_t size() const { return lastEvent - firstEvent; }
+  bool empty() const { return lastEvent == firstEvent; }
+  Event operator[](std::size_t i) const { return begin()[i]; }
+
+  const_iterator begin() const { return const_iterator(history, firstEvent); }
+  const_iterator end() const { return const_iterator(history, lastEvent); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  /// the history holding the event columns
+  NPSHistory const &events() const { return *history; }
+  /// range [first(), last()) of the events of this particle in the columns
+  std::size_t first() const { return firstEvent; }
+  std::size_t last() const { return lastEvent; }
+
+private:
+  NPSHistory const *history;
+  std::size_t firstEvent;
+  std::size_t lastEvent;
+};
 
 /**
  * @brief class of all particles' histories in one nps simulation.
+ * Events are stored column by column, particles are ranges of events. Clearing
+ * keeps the capacity, so reusing one NPSHistory for all the records does not
+ * allocate once the columns are large enough.
  * 
  */
-typedef std::vector<ParticleHistory> NPSHistory;
+class NPSHistory
+{
+public:
+  /**
+   * @brief Iterator over the particles.
+   */
+  class const_iterator
+  {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef ParticleHistory value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef ParticleHistory reference;
+    typedef void pointer;
+
+    const_iterator(NPSHistory const *history, std::size_t particle) : history(history), particle(particle) {}
+    ParticleHistory operator*() const { return (*history)[particle]; }
+    const_iterator &operator++() { ++particle; return *this; }
+    const_iterator operator++(int) { const_iterator old(*this); ++particle; return old; }
+    bool operator==(const_iterator const &other) const { return particle == other.particle; }
+    bool operator!=(const_iterator const &other) const { return particle != other.particle; }
+
+  private:
+    NPSHistory const *history;
+    std::size_t particle;
+  };
+  typedef const_iterator iterator;
+
+  // event columns
+  std::vector<long> nps;
+  std::vector<long> eventID;
+  std::vector<long> cellID;
+  std::vector<double> x;
+  std::vector<double> y;
+  std::vector<double> z;
+  std::vector<double> energy;
+  std::vector<double> weight;
+  std::vector<double> time;
+  // NPS on the NPS line of the history, also when the projection kept none of its events
+  long historyNPS;
+
+  NPSHistory() : historyNPS(-1), particleOffsets(1, 0) {}
+
+  /// number of particles
+  std::size_t size() const { return particleOffsets.size() - 1; }
+  bool empty() const { return size() == 0; }
+  /// number of events of all particles
+  std::size_t nbEvents() const { return nps.size(); }
+
+  ParticleHistory operator[](std::size_t particle) const
+  {
+    return ParticleHistory(this, particleOffsets[particle], particleOffsets[particle + 1]);
+  }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  /// removes all the events, keeps the capacity
+  void clear();
+
+  /// appends an event to the current particle
+  void addEvent(long nps, long eventID, long cellID, double x, double y, double z,
+                double energy, double weight, double time)
+  {
+    this->nps.push_back(nps);
+    this->eventID.push_back(eventID);
+    this->cellID.push_back(cellID);
+    this->x.push_back(x);
+    this->y.push_back(y);
+    this->z.push_back(z);
+    this->energy.push_back(energy);
+    this->weight.push_back(weight);
+    this->time.push_back(time);
+  }
+  void addEvent(Event const &event)
+  {
+    addEvent(event.nps, event.eventID, event.cellID, event.pos[0], event.pos[1], event.pos[2],
+             event.energy, event.weight, event.time);
+  }
+
+  /// closes the current particle, the next events belong to a new one
+  void endParticle() { particleOffsets.push_back(nps.size()); }
+
+  /// number of events added since the last particle was closed
+  std::size_t openEvents() const { return nps.size() - particleOffsets.back(); }
+
+  /// removes the events added since the last particle was closed
+  void discardParticle();
+
+  void swap(NPSHistory &other);
+
+private:
+  // particle i owns the events [particleOffsets[i], particleOffsets[i+1])
+  std::vector<std::size_t> particleOffsets;
+};
+
+inline Event ParticleHistory::const_iterator::operator*() const
+{
+  return Event{history->nps[index], history->eventID[index], history->cellID[index],
+               {history->x[index], history->y[index], history->z[index]},
+               history->energy[index], history->weight[index], history->time[index]};
+}
 
 struct VariableIDNum {
   long nbDataNPS;
@@ -56,9 +245,137 @@ struct VariableIDNum {
   long nbDataTerDouble;
 };
 
-struct EventIndices {
-  int event, cell, px, py, pz, erg, wt, tme;
+/**
+ * @brief event types, in the order of their variable counts on line 6.
+ *
+ */
+enum EventType { SrcEvent = 0, BnkEvent, SufEvent, ColEvent, TerEvent, NbEventTypes };
+
+/**
+ * @brief MCNP variable ids on line 7 of the fields that are decoded.
+ *
+ */
+enum PTRACVariableID : long {
+  NextEventID = 7,
+  CellID = 17,
+  XID = 20,
+  YID = 21,
+  ZID = 22,
+  EnergyID = 26,
+  WeightID = 27,
+  TimeID = 28
+};
+
+/**
+ * @brief Byte offsets of the decoded fields in the data line of one event
+ * type. Data lines are all doubles, even though the first group are
+ * actually longs.
+ *
+ */
+struct EventSchema {
+  static constexpr std::size_t absent = static_cast<std::size_t>(-1);
+
+  long nbLong;
+  long nbDouble;
+  std::size_t length;      // bytes of a data line
+  bool exactLength;        // false if only the minimum length is known
+  std::size_t next, cell;  // offsets of the long fields
+  std::size_t x, y, z, erg, wt, tme; // offsets of the double fields
+};
+
+/**
+ * @brief Decodes one data line of an event described by event and appends it
+ * to history.
+ *
+ * @returns type of the next event.
+ */
+typedef long (*EventDecoder)(const char *record, std::size_t length, EventSchema const &event,
+                             long nps, long type, NPSHistory &history);
+
+/**
+ * @brief Layout of the data lines of each event type, decoded from the
+ * variable counts on line 6 and the variable ids on line 7, and the decoder
+ * selected for each of them.
+ *
+ */
+struct PTRACSchema {
   VariableIDNum idNum;
+  EventSchema events[NbEventTypes];
+  EventDecoder decoders[NbEventTypes];
+};
+
+/**
+ * @brief What a reader decodes: the fields it extracts, the event types it
+ * keeps and the particles it keeps.
+ *
+ * Fields left out are never read from the data lines, their columns are 0.
+ * Events of the types left out are skipped with only their next event field
+ * read, and a particle left without events is not added. With cells, the
+ * particles with no event in any of these cells are dropped before their
+ * fields are extracted; the particles that are kept have all their events,
+ * which is what the pulse builder needs.
+ */
+struct EventProjection {
+  enum Field : unsigned {
+    Cell = 1 << 0,
+    Position = 1 << 1,
+    Energy = 1 << 2,
+    Weight = 1 << 3,
+    Time = 1 << 4,
+    AllFields = (1 << 5) - 1
+  };
+
+  unsigned fields = AllFields;
+  unsigned eventTypes = (1 << NbEventTypes) - 1; // bit EventType is set for the types kept
+  std::vector<long> cells;                       // empty keeps all particles
+
+  /// fields of a pulse: cells, positions, energies and times, no weights
+  static EventProjection pulses(std::vector<long> const &cells);
+
+  bool keepsType(int type) const { return (eventTypes >> type) & 1u; }
+  /// cells must be sorted, which MCNPPTRAC::setProjection does
+  bool keepsCell(long cell) const;
+  /// true if everything is decoded and kept
+  bool isIdentity() const { return fields == AllFields && eventTypes == (1u << NbEventTypes) - 1 && cells.empty(); }
+};
+
+/**
+ * Builds the schema from the payloads of line 6 and line 7. Line 7 ids may be
+ * 4 or 8 bytes wide, which is told from its length. If line 7 cannot be
+ * decoded, the layout of the bank events with the historical field positions
+ * is used for all event types and a warning is printed.
+ */
+PTRACSchema parseSchema(const char *line6, std::size_t length6, const char *line7, std::size_t length7);
+
+/// event numbers whose absolute value is below this have an entry in the table
+constexpr long maxEventNumber = 6000;
+
+struct EventTypeTable {
+  int8_t types[maxEventNumber];
+  bool banks[maxEventNumber];
+};
+
+/// EventType of each absolute event number, -1 for the numbers that are not
+/// events, and whether it is a bank event
+extern const EventTypeTable eventTypeTable;
+
+/// event type of an event number, or -1 if it is not an event. No branch to mispredict.
+inline int eventType(long id)
+{
+  const unsigned long number = static_cast<unsigned long>(id < 0 ? -id : id);
+  return number < static_cast<unsigned long>(maxEventNumber) ? eventTypeTable.types[number] : -1;
+}
+
+/**
+ * @brief Part of a corrupt or truncated PTRAC file skipped in recovery mode.
+ *
+ */
+struct SkippedRegion {
+  std::string path;
+  std::size_t offset; // bytes from the start of the file
+  std::size_t length; // bytes skipped, up to the next history or the end of the file
+  long lastNPS;       // last history before the region, 0 if there is none
+  std::string reason; // error that was raised at the start of the region
 };
 
 class MCNPPTRAC
@@ -67,6 +384,10 @@ protected:
   long npsRead;
   // Event record;
   NPSHistory npsHistory;
+  EventProjection projection;
+  // skip corrupt regions instead of throwing
+  bool recovery;
+  std::vector<SkippedRegion> skipped;
 
 public:
   MCNPPTRAC();
@@ -87,19 +408,63 @@ public:
   long getNPSRead();
 
   NPSHistory const &getNPSHistory() const;
+
+  /**
+     * Sets what the next histories read decode, see EventProjection and
+     * checkProjection.
+     */
+  virtual void setProjection(EventProjection const &projection);
+  EventProjection const &getProjection() const { return projection; }
+
+  /**
+     * In recovery mode, a region of the file that cannot be read, such as a
+     * corrupt block or the truncated tail of a killed job, is skipped up to
+     * the next history that can be read and recorded, instead of throwing.
+     * Throws std::invalid_argument for readers that cannot skip.
+     */
+  virtual void setRecovery(bool recover);
+
+  /// regions skipped so far in recovery mode
+  std::vector<SkippedRegion> const &getSkippedRegions() const { return skipped; }
+
+  /**
+     * @returns offset in the file of the next history to read, or -1 for
+     * readers that cannot resume from an offset.
+     */
+  virtual long tell() const { return -1; }
+
+  /**
+     * Swaps the history just read with history, so that a consumer can keep
+     * it without copying. The reader reuses whatever it gets back.
+     */
+  void swapNPSHistory(NPSHistory &history);
 };
 
 class MCNPPTRACBinary : public MCNPPTRAC
 {
 protected:
-  std::ifstream ptracFile;
-  EventIndices indices;
+  // read ahead of the decoder by a background thread
+  ReadAheadBuffer readAhead;
+  // for compressed files: the decompressor reading from readAhead, and
+  // another thread decompressing ahead of the decoder
+  std::unique_ptr<std::streambuf> decompressor;
+  std::unique_ptr<ReadAheadBuffer> decompressAhead;
+  std::istream ptracFile;
+  PTRACSchema schema;
+  // schema with the fields left out of the projection marked absent
+  PTRACSchema projected;
+  // reused for every record
+  std::string record;
 
 public:
   /**
-     * @param[in] ptracPath MCNP ptrac file path.
+     * @param[in] ptracPath MCNP ptrac file path, gzip or zstd compressed
+     * files are decompressed on the fly.
+     * @param[in] options block size of the reads and whether to bypass the page cache.
      */
-  MCNPPTRACBinary(std::string const &ptracPath);
+  MCNPPTRACBinary(std::string const &ptracPath, ReadAheadOptions const &options = ReadAheadOptions());
+
+  void setProjection(EventProjection const &projection);
 
   /**
      * If the maximum number of histories has not been reached: reads the history
@@ -110,6 +475,9 @@ public:
   bool readNextNPS(long maxReadNPS);
 
 protected:
+  /// the stream buffer to decode from, decompressing if the file is compressed
+  std::streambuf *openInput(ReadAheadOptions const &options);
+
   /**
    * Reads the header
    */
@@ -119,7 +487,7 @@ protected:
 
   void skipPtracInputData();
 
-  /// return the indices of the field IDs
+  /// decodes the layout of the data lines
   void parseVariableIDs();
 
   void parsePTRACRecord();
@@ -150,6 +518,35 @@ inline std::string readBinary(std::istream &file, size_t length)
   return buffer;
 }
 
+template <typename T>
+T loadBinary(const char *ptr)
+{
+  T value;
+  std::memcpy(&value, ptr, sizeof(T));
+  return value;
+}
+
+/**
+ * Reads the next record into buffer, reusing its storage.
+ */
+inline void readRecord(std::istream &file, std::string &buffer)
+{
+  const int rec_len_start = readBinary<int>(file);
+  if (rec_len_start < 0)
+  {
+    throw std::logic_error("bad stream state after read");
+  }
+  buffer.resize(rec_len_start);
+  file.read(&buffer[0], rec_len_start);
+  if (!file) {
+    throw std::logic_error("bad stream state after read");
+  }
+  const int rec_len_end = readBinary<int>(file);
+  if (rec_len_start != rec_len_end) {
+    throw std::logic_error("mismatched record length");
+  }
+}
+
 inline std::string readRecord(std::istream &file)
 {
   const int rec_len_start = readBinary<int>(file);
@@ -186,4 +583,80 @@ std::tuple<Ts...> reinterpretBuffer(std::string const &buffer)
   return reinterpretBuffer<Ts...>(stream);
 }
 
-bool isBnkEvent(const long& id);
\ No newline at end of file
+/// true for the bank events, 2000 +- 39. No branch to mispredict.
+inline bool isBnkEvent(long id)
+{
+  const unsigned long number = static_cast<unsigned long>(id < 0 ? -id : id);
+  return number < static_cast<unsigned long>(maxEventNumber) && eventTypeTable.banks[number];
+}
+
+/**
+ * Records the bank events other than 2030 and 2033 as anomalies. Called once
+ * per bank event, by the readers that decode or visit it, not by the scans.
+ */
+inline void recordBnkEvent(long id)
+{
+  if (id != 2030 && id != -2030 && id != 2033 && id != -2033)
+  {
+    Diagnostics::record(Diagnostics::UnusualBankEvent, id);
+  }
+}
+
+/**
+ * Generic decoder, reads the fields at the offsets of the schema.
+ */
+inline long decodeEventGeneric(const char *record, std::size_t length, EventSchema const &event,
+                               long nps, long type, NPSHistory &history)
+{
+  if (event.next == EventSchema::absent)
+  {
+    throw std::logic_error("no data line layout for event type " + std::to_string(type));
+  }
+  if (length < event.length || (event.exactLength && length != event.length))
+  {
+    throw std::logic_error("data line length does not match the event type");
+  }
+  auto field = [record](std::size_t offset) {
+    return offset == EventSchema::absent ? 0. : loadBinary<double>(record + offset);
+  };
+  const long next = static_cast<long>(loadBinary<double>(record + event.next));
+  const long cell = event.cell == EventSchema::absent ? -1 : static_cast<long>(field(event.cell));
+  history.addEvent(nps, type, cell, field(event.x), field(event.y), field(event.z),
+                   field(event.erg), field(event.wt), field(event.tme));
+  return next;
+}
+
+/**
+ * Picks a decoder specialized for a known layout for each event type, or the
+ * generic one.
+ */
+void selectDecoders(PTRACSchema &schema);
+
+/**
+ * @returns schema with the fields left out of projection marked absent, and
+ * the decoders selected again for that layout.
+ */
+PTRACSchema projectSchema(PTRACSchema const &schema, EventProjection const &projection);
+
+/**
+ * Throws std::invalid_argument if projection keeps particles by cell but no
+ * data line of schema holds the cell, which would drop every particle.
+ */
+void checkProjection(PTRACSchema const &schema, EventProjection const &projection);
+
+/**
+ * Decodes a data line of an event of type type, described by the schema, and
+ * appends the event to history.
+ *
+ * @returns type of the next event.
+ */
+inline long decodeEvent(const char *record, std::size_t length, PTRACSchema const &schema,
+                        long nps, long type, NPSHistory &history)
+{
+  const int category = eventType(type);
+  if (category < 0)
+  {
+    throw std::logic_error("unknown event type " + std::to_string(type));
+  }
+  return schema.decoders[category](record, length, schema.events[category], nps, type, history);
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+ * @file pipeline.hh
+ * @brief Streaming parse -> pulse -> write pipeline with bounded memory
+ * @date 2026-10-17
+ */
+#pragma once
+#include "boundedqueue.hh"
+#include "pulsebuilder.hh"
+#include "pulseio.hh"
+#include <functional>
+
+/// where the pipeline stands once the pulses of the histories read so far are written
+struct PipelineProgress {
+  long npsRead;  // histories read
+  long offset;   // offset of the next history to read, see MCNPPTRAC::tell
+  long nbPulses; // pulses written
+};
+
+struct PipelineOptions {
+  long maxNPS = 1e9;                      // passed to readNextNPS
+  long maxPulses = 1e9;                   // stop after this many pulses
+  std::size_t batchSize = 1024;           // histories per batch
+  std::size_t nbBatches = 8;              // batches in flight between two stages
+  long progressInterval = 1000000;        // print NPS every this many histories
+  std::vector<long> detectorCells = {defaultDetectorCell}; // one pulse per particle and cell
+  double checkpointInterval = 60;         // seconds between two calls of checkpoint
+  std::function<void(PipelineProgress const &)> checkpoint; // called after the writer is flushed, if set
+};
+
+/**
+ * @brief Reads histories, builds pulses and writes them on three threads.
+ *
+ * The stages exchange batches through bounded queues. Batches are recycled
+ * instead of freed, so memory use does not grow with the size of the file
+ * and pulses are written while the file is still being parsed. The writer
+ * is flushed once all the pulses are written.
+ *
+ * If a checkpoint function is given, the writer is also flushed every
+ * checkpointInterval seconds between two batches, and the function is told
+ * how far the pipeline got. The writer must then be one that can be flushed
+ * more than once, like the file writers but unlike the time sorting writer.
+ */
+class PulsePipeline
+{
+public:
+  PulsePipeline(MCNPPTRAC &reader, PulseWriter &writer, PipelineOptions const &options = PipelineOptions());
+
+  /**
+   * Runs until the reader is exhausted or the maximum number of pulses is
+   * reached. Exceptions thrown by any stage are rethrown here.
+   *
+   * @returns number of pulses written.
+   */
+  long run();
+
+private:
+  struct HistoryBatch {
+    std::vector<NPSHistory> histories;
+    std::size_t size = 0;
+    long npsRead = 0; // histories read after the batch
+    long offset = -1; // next history to read after the batch
+  };
+  struct PulseBatch {
+    std::vector<Pulse> pulses;
+    long npsRead = 0;
+    long offset = -1; // -1 if the batch stops in the middle of its histories
+  };
+
+  MCNPPTRAC &reader;
+  PulseWriter &writer;
+  PipelineOptions options;
+
+  BoundedQueue<HistoryBatch> histories;
+  BoundedQueue<HistoryBatch> freeHistories;
+  BoundedQueue<PulseBatch> pulses;
+  BoundedQueue<PulseBatch> freePulses;
+
+  void parse();
+  void build();
+  long write();
+  void closeAll();
+};
@@ -0,0 +1,114 @@
+/**
+ * @file ptracwriter.hh
+ * @brief Writes synthetic binary PTRAC files for the tests and benchmarks
+ * @date 2026-10-17
+ */
+#pragma once
+#include "parser.hh"
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One particle is a list of events. Event::eventID is the type of the
+ * event itself, the writer takes care of storing it as the "next event"
+ * field of the previous record, the way MCNP does.
+ */
+typedef std::vector<Event> SyntheticParticle;
+
+struct SyntheticHistory {
+  long nps;
+  std::vector<SyntheticParticle> particles;
+};
+
+/**
+ * @brief Variable ids on the long and double data lines of one event type.
+ */
+struct SyntheticLayout {
+  std::vector<int32_t> longIDs;
+  std::vector<int32_t> doubleIDs;
+
+  /// the layout of all event types in our production files
+  static SyntheticLayout standard()
+  {
+    return SyntheticLayout{{7, 8, 10, 12, 13, 17}, {20, 21, 22, 23, 24, 25, 26, 27, 28}};
+  }
+};
+
+/**
+ * @brief Event mix of the random histories.
+ */
+struct SyntheticMix {
+  int minParticles = 1;          // per history
+  int maxParticles = 3;
+  int minCollisions = 1;         // per particle
+  int maxCollisions = 4;
+  double surfaceFraction = 0.2;  // chance that a step ends on a surface instead of a collision
+  long detectorCell = 601;       // cell of the collisions
+  unsigned long seed = 1;
+};
+
+/**
+ * @brief Writes a binary PTRAC file with the header structure the parsers
+ * expect: 3 header records, one PTRAC input data record, the variable counts
+ * (line 6) and the variable ids (line 7), followed by the histories.
+ */
+class SyntheticPTRACWriter
+{
+public:
+  SyntheticPTRACWriter(std::string const &path);
+
+  /**
+   * @param[in] layouts layout of src, bnk, suf, col and ter events.
+   */
+  SyntheticPTRACWriter(std::string const &path, std::vector<SyntheticLayout> const &layouts);
+
+  void writeHistory(SyntheticHistory const &history);
+
+  void close() { file.close(); }
+
+  /// bytes written so far
+  std::size_t size() { return static_cast<std::size_t>(file.tellp()); }
+
+  /**
+   * @brief A deterministic history: every particle is banked in cell 602,
+   * collides in cell 601 (the detector) and terminates in cell 603.
+   */
+  static SyntheticHistory makeHistory(long nps, int nParticles);
+
+  /**
+   * @brief A random history following the mix: every particle is banked,
+   * then collides or crosses surfaces, then terminates.
+   */
+  static SyntheticHistory randomHistory(long nps, SyntheticMix const &mix, std::mt19937_64 &generator);
+
+private:
+  std::ofstream file;
+  std::vector<SyntheticLayout> layouts;
+
+  static constexpr int nbDataNPS = 2;
+
+  template <typename T>
+  static void append(std::string &buffer, T value)
+  {
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void writeRecord(std::string const &payload);
+  void writeHeader();
+  static double fieldValue(int32_t id, long next, Event const &event);
+  void writeDataLine(long next, Event const &event);
+};
+
+/**
+ * Writes random histories until the file holds nbHistories histories or
+ * reaches size bytes, whichever comes first.
+ *
+ * @returns number of histories written.
+ */
+long writeSyntheticPTRAC(std::string const &path, long nbHistories, std::size_t size,
+                         SyntheticMix const &mix = SyntheticMix(),
+                         std::vector<SyntheticLayout> const &layouts =
+                             std::vector<SyntheticLayout>(NbEventTypes, SyntheticLayout::standard()));
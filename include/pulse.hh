@@ -8,6 +8,9 @@
 #include "parser.hh"
 #include <math.h>
 
+// the detector cell of the original single-detector setup
+const long defaultDetectorCell = 601;
+
 class Pulse
 {
     friend std::ostream &operator<<(std::ostream &os, const Pulse& p);
@@ -28,6 +31,7 @@ public:
     std::vector<double> pos; // center of track, (x,y,z), cm
     double time; // time stamp, shakes
     double energy; // deposited energy, MeV
+    long cellID = defaultDetectorCell; // detector cell
 };
 
 std::ostream &operator<<(std::ostream &os, const Pulse& p);
@@ -0,0 +1,167 @@
+/**
+ * @file pulsebuilder.hh
+ * @brief Pulses of a particle in any number of detector cells
+ * @date 2026-10-17
+ */
+#pragma once
+#include "historyvisitor.hh"
+#include "pulse.hh"
+#include "pulseio.hh"
+#include <cstdint>
+
+/**
+ * @brief Set of detector cells, with a dense lookup table from cell number to
+ * the position of the cell in the set.
+ *
+ */
+class DetectorCells
+{
+public:
+    /**
+     * @param[in] cells detector cell numbers. Throws std::invalid_argument if
+     * the set is empty or spans too many cell numbers for the table.
+     */
+    DetectorCells(std::vector<long> const& cells);
+
+    /**
+     * @returns position of cell in the set, -1 if it is not a detector cell.
+     * One subtraction, one comparison and one load.
+     */
+    int index(long cell) const
+    {
+        const unsigned long offset = static_cast<unsigned long>(cell) - static_cast<unsigned long>(minCell);
+        return offset < table.size() ? table[offset] : -1;
+    }
+
+    std::size_t size() const { return cells.size(); }
+    long operator[](std::size_t i) const { return cells[i]; }
+
+    /// largest span of cell numbers of a set, keeps the table under 64 MB
+    static constexpr long maxSpan = 1L << 24;
+
+private:
+    long minCell;
+    std::vector<int32_t> table;
+    std::vector<long> cells;
+};
+
+/**
+ * @brief Energy deposited by a particle in one detector cell so far.
+ *
+ */
+struct CellDeposit
+{
+    bool touched;
+    long nps;
+    double time;
+    double energy;
+    std::array<double, 3> startPos;
+    std::array<double, 3> endPos;
+
+    static CellDeposit none() { return CellDeposit{false, 0, 0, 0, {0, 0, 0}, {0, 0, 0}}; }
+
+    /// pulse of the track from startPos to endPos in cell
+    Pulse toPulse(long cell) const;
+};
+
+/**
+ * @brief Builds one pulse per detector cell in which a particle deposited
+ * energy, in a single pass over its events. With only the default detector
+ * cell, the pulses are the ones of Pulse::Pulse.
+ *
+ */
+class PulseBuilder
+{
+public:
+    PulseBuilder(DetectorCells const& cells);
+
+    /**
+     * Appends the pulses of a particle to pulses, in the order the particle
+     * entered the cells. Pulses without deposited energy are dropped.
+     *
+     * @returns number of pulses appended.
+     */
+    std::size_t build(const ParticleHistory& parHist, std::vector<Pulse>& pulses);
+
+    DetectorCells const& getCells() const { return cells; }
+
+private:
+    DetectorCells cells;
+    // one per detector cell, reset after each particle
+    std::vector<CellDeposit> deposits;
+    // cells the current particle went through
+    std::vector<int> touched;
+};
+
+/**
+ * @brief The pulses of PulseBuilder, built while the events are visited and
+ * written to a pulse writer at the end of each history, so that only the
+ * pulses of one history are ever stored and none of a history aborted is
+ * written. Use with MCNPPTRACMmap::visit.
+ *
+ */
+class PulseVisitor : public HistoryVisitor
+{
+public:
+    PulseVisitor(DetectorCells const& cells, PulseWriter& out);
+
+    void onEvent(Event const& event)
+    {
+        if (pending >= 0)
+        {
+            // the previous event was in a detector cell, the track ends here
+            CellDeposit& deposit = deposits[pending];
+            deposit.endPos = event.pos;
+            deposit.energy += pendingEnergy - event.energy;
+            pending = -1;
+        }
+        const int cell = cells.index(event.cellID);
+        if (cell < 0 || event.eventID == 5000)
+        {
+            return;
+        }
+        CellDeposit& deposit = deposits[cell];
+        if (!deposit.touched)
+        {
+            deposit.touched = true;
+            touched.push_back(cell);
+        }
+        if (deposit.energy == 0)
+        {
+            // first event in this detector cell
+            deposit.nps = event.nps;
+            deposit.startPos = event.pos;
+            deposit.time = event.time;
+        }
+        pending = cell;
+        pendingEnergy = event.energy;
+        pendingNPS = event.nps;
+        pendingEventID = event.eventID;
+    }
+
+    /// keeps the pulses of the particle, in the order it entered the cells
+    void onParticleEnd();
+
+    /// writes the pulses of the history
+    void onHistoryEnd(long nps);
+
+    /// drops the pulses of the history and the particle being built
+    void onHistoryAbort(long nps);
+
+    /// number of pulses written so far
+    std::size_t getNbPulses() const { return nbPulses; }
+
+private:
+    DetectorCells cells;
+    PulseWriter& out;
+    std::vector<CellDeposit> deposits;
+    std::vector<int> touched;
+    // pulses of the particles of the history visited
+    std::vector<Pulse> historyPulses;
+    // detector cell of the previous event, -1 if it was not in one
+    int pending;
+    double pendingEnergy;
+    long pendingNPS;
+    long pendingEventID;
+    std::size_t nbPulses;
+};
@@ -0,0 +1,160 @@
+/**
+ * @file pulseio.hh
+ * @brief Text and binary pulse file writers, and the binary pulse reader
+ * @date 2026-10-17
+ */
+#pragma once
+#include "pulse.hh"
+#include <cstdint>
+
+/**
+ * @brief Interface of the pulse output stage.
+ *
+ */
+class PulseWriter
+{
+public:
+    virtual ~PulseWriter() {}
+    virtual void write(const Pulse& p) = 0;
+    /// writes buffered pulses to the stream
+    virtual void flush() = 0;
+};
+
+/**
+ * @brief The pulses.txt layout, one line per pulse, formatted by
+ * operator<<(std::ostream&, const Pulse&).
+ */
+class TextPulseWriter : public PulseWriter
+{
+public:
+    static const char* header;
+
+    /**
+     * @param[in] writeCell appends the detector cell to each line.
+     */
+    TextPulseWriter(std::ostream& os, bool writeHeader = true, std::size_t bufferSize = 16 << 20,
+                    bool writeCell = false);
+    void write(const Pulse& p);
+    void flush();
+
+private:
+    std::ostream& os;
+    std::size_t bufferSize;
+    bool writeCell;
+    std::string text;
+    std::ostringstream line;
+};
+
+/**
+ * @brief Passes every pulse on to two writers.
+ *
+ */
+class TeePulseWriter : public PulseWriter
+{
+public:
+    TeePulseWriter(PulseWriter& first, PulseWriter& second) : first(first), second(second) {}
+    void write(const Pulse& p)
+    {
+        first.write(p);
+        second.write(p);
+    }
+    void flush()
+    {
+        first.flush();
+        second.flush();
+    }
+
+private:
+    PulseWriter& first;
+    PulseWriter& second;
+};
+
+/**
+ * @brief Keeps the pulses in memory, one vector per field, for consumers
+ * that want arrays rather than a file.
+ *
+ */
+class ColumnPulseWriter : public PulseWriter
+{
+public:
+    std::vector<double> startPos; // x1 y1 z1 of each pulse, cm
+    std::vector<double> endPos;   // x2 y2 z2 of each pulse, cm
+    std::vector<double> energy;   // MeV
+    std::vector<double> time;     // shakes
+    std::vector<long> nps;
+    std::vector<long> cellID;
+
+    void write(const Pulse& p);
+    void flush() {}
+
+    std::size_t size() const { return nps.size(); }
+    /// removes all the pulses, keeps the capacity
+    void clear();
+};
+
+enum class PulseLayout : uint32_t
+{
+    RowMajor = 0,   // one 80-byte row per pulse
+    ColumnMajor = 1 // one array per field in each block
+};
+
+/**
+ * @brief Binary pulse file.
+ *
+ * The file starts with a self-describing header:
+ *   char[8]  magic "PTRPULSE"
+ *   uint32   version
+ *   uint32   layout, see PulseLayout
+ *   uint32   number of columns
+ *   uint32   size of a row in bytes
+ *   then for each column: char[16] name, char type ('d' float64 or
+ *   'q' int64), char[7] padding
+ * followed by blocks of pulses:
+ *   uint64   number of pulses n in the block
+ *   n rows, or one array of n values per column.
+ * All numbers are little-endian. Columns are x1 y1 z1 x2 y2 z2 (cm),
+ * energy (MeV), time (shakes) and nps, like pulses.txt, then the detector
+ * cell.
+ */
+class BinaryPulseWriter : public PulseWriter
+{
+public:
+    /**
+     * @param[in] writeHeader false to append blocks to a file that already has its header.
+     */
+    BinaryPulseWriter(std::ostream& os, PulseLayout layout = PulseLayout::ColumnMajor,
+                      std::size_t blockSize = 1 << 16, bool writeHeader = true);
+    void write(const Pulse& p);
+    void flush();
+
+private:
+    std::ostream& os;
+    PulseLayout layout;
+    std::size_t blockSize;
+    std::size_t nbPulses;
+    std::vector<char> block;
+};
+
+class BinaryPulseReader
+{
+public:
+    /**
+     * Reads the header, throws std::runtime_error if it is not a binary
+     * pulse file.
+     */
+    BinaryPulseReader(std::istream& is);
+
+    /**
+     * @returns false at the end of the file.
+     */
+    bool read(Pulse& p);
+
+    PulseLayout getLayout() const { return layout; }
+
+private:
+    std::istream& is;
+    PulseLayout layout;
+    std::size_t nbPulses;
+    std::size_t next;
+    std::vector<char> block;
+};
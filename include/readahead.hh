@@ -0,0 +1,106 @@
+/**
+ * @file readahead.hh
+ * @brief Stream buffer that reads a file in large blocks ahead of the decoder
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+
+struct ReadAheadOptions {
+  std::size_t blockSize = std::size_t(8) << 20; // bytes per read, rounded up to a multiple of 4 KB
+  bool direct = false;                          // bypass the page cache with O_DIRECT where supported
+};
+
+/**
+ * @brief Input stream buffer over a file, filled by a background thread.
+ *
+ * The thread reads the file sequentially into two aligned blocks: while the
+ * stream consumes one block, the next one is read from disk. Small reads,
+ * such as the record markers of a PTRAC file, are then plain copies out of
+ * memory. Seeking is not supported.
+ *
+ * With the direct option the file is opened with O_DIRECT, for files larger
+ * than the page cache; file systems that refuse O_DIRECT, when the file is
+ * opened or at the first read, fall back to buffered reads.
+ */
+class ReadAheadBuffer : public std::streambuf
+{
+public:
+  ReadAheadBuffer(std::string const &path, ReadAheadOptions const &options = ReadAheadOptions());
+
+  /**
+   * Reads ahead of another stream buffer instead of a file, so that the work
+   * done by source, decompression for instance, overlaps with the work of
+   * the consumer. Errors thrown by source are rethrown to the consumer.
+   * The direct option does not apply.
+   */
+  ReadAheadBuffer(std::streambuf &source, ReadAheadOptions const &options = ReadAheadOptions());
+  ~ReadAheadBuffer();
+
+  ReadAheadBuffer(ReadAheadBuffer const &) = delete;
+  ReadAheadBuffer &operator=(ReadAheadBuffer const &) = delete;
+
+  bool is_open() const { return fd >= 0 || source != nullptr; }
+
+  /**
+   * Copies up to n bytes from the start of the data not yet consumed, without
+   * consuming them. Fewer bytes are copied when fewer are left in the block.
+   *
+   * @returns number of bytes copied.
+   */
+  std::size_t peek(char *bytes, std::size_t n);
+
+  /// whether the file is read with O_DIRECT
+  bool isDirect() const { return direct; }
+
+  std::size_t getBlockSize() const { return blockSize; }
+
+protected:
+  int_type underflow();
+
+private:
+  struct Block
+  {
+    char *data = nullptr;
+    std::size_t size = 0;
+    bool full = false;
+  };
+
+  static constexpr std::size_t alignment = 4096;
+  static constexpr int nbBlocks = 2;
+
+  std::string path;
+  int fd;
+  std::streambuf *source;
+  // cleared by the reading thread if the file system rejects direct reads
+  std::atomic<bool> direct;
+  std::size_t blockSize;
+  Block blocks[nbBlocks];
+  // block being consumed, -1 before the first underflow
+  int current;
+  // error of the read that ended the stream early
+  std::exception_ptr error;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable filled;
+  std::condition_variable emptied;
+  // declared last so that it starts once everything else is set up
+  std::thread reader;
+
+  /// end of the stream, throws if it ended on a failed read
+  int_type fail();
+  void start();
+  void readBlocks();
+  /// reads the next block from the file or the source, returns its size
+  std::size_t fill(char *data, off_t offset);
+  /// replaces the O_DIRECT descriptor with a buffered one, false if it cannot
+  bool reopenBuffered();
+};
@@ -0,0 +1,78 @@
+/**
+ * @file ringbuffer.hh
+ * @brief FIFO ring buffer that grows only when it is full
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Sliding window storage: items are pushed at the back and dropped
+ * at the front. The capacity is a power of two and doubles when the buffer
+ * is full, so it ends up as large as the largest window, not the stream.
+ */
+template <typename T>
+class RingBuffer
+{
+public:
+  explicit RingBuffer(std::size_t capacity = 64) : items(roundUp(capacity)), head(0), count(0) {}
+
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  std::size_t capacity() const { return items.size(); }
+
+  /// i-th item from the oldest one
+  T const &operator[](std::size_t i) const { return items[(head + i) & (items.size() - 1)]; }
+  T const &front() const { return items[head]; }
+  T const &back() const { return (*this)[count - 1]; }
+
+  void push_back(T const &item)
+  {
+    if (count == items.size())
+    {
+      grow();
+    }
+    items[(head + count) & (items.size() - 1)] = item;
+    count++;
+  }
+
+  void pop_front()
+  {
+    head = (head + 1) & (items.size() - 1);
+    count--;
+  }
+
+  void clear()
+  {
+    head = 0;
+    count = 0;
+  }
+
+private:
+  std::vector<T> items;
+  std::size_t head;
+  std::size_t count;
+
+  static std::size_t roundUp(std::size_t n)
+  {
+    std::size_t power = 1;
+    while (power < n)
+    {
+      power <<= 1;
+    }
+    return power;
+  }
+
+  void grow()
+  {
+    std::vector<T> larger(items.size() * 2);
+    for (std::size_t i = 0; i < count; i++)
+    {
+      larger[i] = (*this)[i];
+    }
+    items.swap(larger);
+    head = 0;
+  }
+};
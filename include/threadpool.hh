@@ -0,0 +1,96 @@
+/**
+ * @file threadpool.hh
+ * @brief Fixed-size pool of worker threads
+ * @date 2026-10-17
+ */
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+  /**
+   * @param[in] nbThreads number of workers, 0 for one per hardware thread.
+   */
+  explicit ThreadPool(unsigned nbThreads = 0)
+  {
+    if (nbThreads == 0)
+    {
+      nbThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < nbThreads; i++)
+    {
+      workers.emplace_back([this] { work(); });
+    }
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool &operator=(ThreadPool const &) = delete;
+
+  std::size_t size() const { return workers.size(); }
+
+  /**
+   * Queues a task. Exceptions thrown by the task are rethrown by get() on
+   * the returned future.
+   */
+  template <typename F>
+  std::future<void> submit(F &&task)
+  {
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+    std::future<void> result = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace([packaged] { (*packaged)(); });
+    }
+    wakeup.notify_one();
+    return result;
+  }
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  bool stopping = false;
+
+  void work()
+  {
+    while (true)
+    {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (stopping && tasks.empty())
+        {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+    }
+  }
+};
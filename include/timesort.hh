@@ -0,0 +1,115 @@
+/**
+ * @file timesort.hh
+ * @brief Time-sorted pulse trains: external merge sort and source timeline
+ * @date 2026-10-17
+ */
+#pragma once
+#include "pulseio.hh"
+#include <random>
+
+/**
+ * @brief Arrival times of the source histories on a single timeline, for a
+ * Poisson source: the gaps between histories are exponential.
+ *
+ */
+class SourceTimeline
+{
+public:
+    /**
+     * @param[in] rate histories per second.
+     * @param[in] seed of the random gaps, the same seed gives the same timeline.
+     */
+    SourceTimeline(double rate, unsigned long seed = 1);
+
+    /**
+     * @returns start of history nps, in shakes. nps must not decrease from
+     * one call to the next; the histories skipped in between still take up
+     * their share of the timeline.
+     */
+    double offset(long nps);
+
+    static constexpr double shakesPerSecond = 1e8;
+
+private:
+    double meanGap; // shakes
+    std::mt19937_64 generator;
+    long lastNPS;
+    double lastOffset;
+};
+
+/**
+ * @brief Moves each pulse to the start time of its history before passing it
+ * on to another writer.
+ *
+ */
+class TimeOffsetWriter : public PulseWriter
+{
+public:
+    TimeOffsetWriter(PulseWriter& out, SourceTimeline const& timeline);
+    void write(const Pulse& p);
+    void flush();
+
+private:
+    PulseWriter& out;
+    SourceTimeline timeline;
+};
+
+struct TimeSortOptions {
+    std::size_t memoryBudget = std::size_t(1) << 30; // bytes of pulses sorted in memory
+    std::string runDirectory = ".";                  // where sorted runs are spilled
+};
+
+/**
+ * @brief Writes the pulses to another writer in increasing time, pulses with
+ * the same time in the order they were written.
+ *
+ * Pulses are sorted in memory up to the memory budget. Beyond that, each
+ * sorted run is spilled to a temporary binary pulse file and the runs are
+ * merged when the writer is flushed. The runs are removed once merged or
+ * when the writer is destroyed.
+ */
+class TimeSortingWriter : public PulseWriter
+{
+public:
+    TimeSortingWriter(PulseWriter& out, TimeSortOptions const& options = TimeSortOptions());
+    ~TimeSortingWriter();
+
+    TimeSortingWriter(TimeSortingWriter const&) = delete;
+    TimeSortingWriter& operator=(TimeSortingWriter const&) = delete;
+
+    void write(const Pulse& p);
+
+    /**
+     * Writes all the pulses written so far to the output writer, sorted,
+     * and flushes it.
+     */
+    void flush();
+
+    /// number of runs spilled to disk so far
+    std::size_t getNbRuns() const { return nbRuns; }
+
+private:
+    /// the fields of a pulse without its heap-allocated vectors
+    struct Record
+    {
+        double startPos[3];
+        double endPos[3];
+        double energy;
+        double time;
+        long nps;
+        long cellID;
+    };
+
+    PulseWriter& out;
+    TimeSortOptions options;
+    std::size_t maxRecords;
+    std::vector<Record> records;
+    std::vector<std::string> runs;
+    std::size_t nbRuns;
+
+    static Pulse toPulse(Record const& record);
+    void sortRecords();
+    void spillRun();
+    void mergeRuns();
+    void removeRuns();
+};
@@ -0,0 +1,35 @@
+/**
+ * @file columnsdump.cc
+ * @brief Prints the EventColumns of a PTRAC file, the reference the Python module is tested against
+ * @date 2026-10-17
+ */
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "historyvisitor.hh"
+#include "mmapparser.hh"
+int main(int argc, char** argv)
+{
+    // usage: columnsdump ptrac
+    if (argc != 2)
+    {
+        throw std::invalid_argument("Usage: columnsdump ptrac");
+    }
+    MCNPPTRACMmap ptrac(argv[1]);
+    EventColumns columns;
+    ptrac.visit(columns);
+    // one line per event, then the particle offsets; %.17g reads back exactly
+    for (std::size_t i = 0; i < columns.nbEvents(); i++)
+    {
+        std::printf("%ld %ld %ld %.17g %.17g %.17g %.17g %.17g %.17g\n", columns.nps[i], columns.eventID[i],
+                    columns.cellID[i], columns.x[i], columns.y[i], columns.z[i], columns.energy[i],
+                    columns.weight[i], columns.time[i]);
+    }
+    for (std::size_t offset : columns.particleOffsets)
+    {
+        std::printf("%zu ", offset);
+    }
+    std::printf("\n");
+    return 0;
+}
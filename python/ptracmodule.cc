@@ -0,0 +1,282 @@
+/**
+ * @file ptracmodule.cc
+ * @brief Python module: chunks of PTRAC events and pulses as NumPy arrays
+ * @date 2026-10-17
+ */
+#include "historyvisitor.hh"
+#include "multireader.hh"
+#include "mmapparser.hh"
+#include "pulsebuilder.hh"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <unistd.h>
+
+namespace py = pybind11;
+
+namespace
+{
+/**
+ * Hands the buffer of column over to a NumPy array, which frees it when it is
+ * collected. The data is not copied; column is left empty.
+ */
+template <typename T>
+py::array_t<T> toArray(std::vector<T> &column, std::vector<py::ssize_t> shape = {})
+{
+    auto *owner = new std::vector<T>();
+    owner->swap(column);
+    if (shape.empty())
+    {
+        shape = {static_cast<py::ssize_t>(owner->size())};
+    }
+    py::capsule base(owner, [](void *buffer) { delete static_cast<std::vector<T> *>(buffer); });
+    return py::array_t<T>(shape, owner->data(), base);
+}
+
+py::dict toDict(EventColumns &columns)
+{
+    py::dict chunk;
+    chunk["nps"] = toArray(columns.nps);
+    chunk["event_id"] = toArray(columns.eventID);
+    chunk["cell"] = toArray(columns.cellID);
+    chunk["x"] = toArray(columns.x);
+    chunk["y"] = toArray(columns.y);
+    chunk["z"] = toArray(columns.z);
+    chunk["energy"] = toArray(columns.energy);
+    chunk["weight"] = toArray(columns.weight);
+    chunk["time"] = toArray(columns.time);
+    chunk["particle_offsets"] = toArray(columns.particleOffsets);
+    columns.clear();
+    return chunk;
+}
+
+py::dict toDict(ColumnPulseWriter &columns)
+{
+    const py::ssize_t n = static_cast<py::ssize_t>(columns.size());
+    py::dict chunk;
+    chunk["start"] = toArray(columns.startPos, {n, 3});
+    chunk["end"] = toArray(columns.endPos, {n, 3});
+    chunk["energy"] = toArray(columns.energy);
+    chunk["time"] = toArray(columns.time);
+    chunk["nps"] = toArray(columns.nps);
+    chunk["cell"] = toArray(columns.cellID);
+    columns.clear();
+    return chunk;
+}
+
+/**
+ * @brief One PTRAC file, read straight from the memory map, or several
+ * files or a compressed one, read through their NPSHistory.
+ */
+class Reader
+{
+public:
+    Reader(std::vector<std::string> const &patterns, unsigned nbThreads) : mapped(nullptr)
+    {
+        const std::vector<std::string> paths = expandPTRACPaths(patterns);
+        if (paths.empty())
+        {
+            throw std::invalid_argument("no PTRAC file");
+        }
+        for (auto const &path : paths)
+        {
+            // a pattern that matches nothing is passed on as it is
+            if (access(path.c_str(), R_OK) != 0)
+            {
+                throw std::invalid_argument("PTRAC file " + path + " not found.");
+            }
+        }
+        if (paths.size() > 1)
+        {
+            ptrac.reset(new MCNPPTRACMulti(paths, nbThreads));
+        }
+        else if (detectCompression(paths.front()) != Compression::None)
+        {
+            ptrac = openPTRAC(paths.front());
+        }
+        else
+        {
+            mapped = new MCNPPTRACMmap(paths.front());
+            ptrac.reset(mapped);
+        }
+    }
+
+    void setProjection(EventProjection const &projection) { ptrac->setProjection(projection); }
+
+    bool setNPSRange(long npsBegin, long npsEnd)
+    {
+        if (mapped == nullptr)
+        {
+            throw std::invalid_argument("NPS ranges need a single uncompressed PTRAC file");
+        }
+        return mapped->setNPSRange(npsBegin, npsEnd);
+    }
+
+    long getNPSRead() { return ptrac->getNPSRead(); }
+
+    /**
+     * Visits up to nbHistories histories without the GIL.
+     *
+     * @returns number of histories read, 0 at the end.
+     */
+    template <typename Visitor>
+    long visit(Visitor &visitor, long nbHistories)
+    {
+        if (nbHistories <= 0)
+        {
+            throw std::invalid_argument("chunks need at least one history");
+        }
+        py::gil_scoped_release release;
+        const long last = ptrac->getNPSRead() + nbHistories - 1;
+        return mapped != nullptr ? mapped->visit(visitor, last) : visitHistories(*ptrac, visitor, last);
+    }
+
+private:
+    std::unique_ptr<MCNPPTRAC> ptrac;
+    MCNPPTRACMmap *mapped;
+};
+
+/// iterator over the events of chunks of histories
+class EventChunks
+{
+public:
+    EventChunks(Reader &reader, long nbHistories) : reader(reader), nbHistories(nbHistories) {}
+
+    py::dict next()
+    {
+        if (reader.visit(columns, nbHistories) == 0)
+        {
+            throw py::stop_iteration();
+        }
+        return toDict(columns);
+    }
+
+private:
+    Reader &reader;
+    long nbHistories;
+    EventColumns columns;
+};
+
+/// iterator over the pulses of chunks of histories
+class PulseChunks
+{
+public:
+    PulseChunks(Reader &reader, std::vector<long> const &cells, long nbHistories)
+        : reader(reader), nbHistories(nbHistories), visitor(DetectorCells(cells), columns)
+    {
+        // pulses need neither weights nor the particles that miss every detector cell
+        reader.setProjection(EventProjection::pulses(cells));
+    }
+
+    py::dict next()
+    {
+        if (reader.visit(visitor, nbHistories) == 0)
+        {
+            throw py::stop_iteration();
+        }
+        return toDict(columns);
+    }
+
+private:
+    Reader &reader;
+    long nbHistories;
+    ColumnPulseWriter columns;
+    PulseVisitor visitor;
+};
+
+/// all the pulses of a binary pulse file written by main --format binary
+py::dict loadPulses(std::string const &path)
+{
+    ColumnPulseWriter columns;
+    {
+        py::gil_scoped_release release;
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.good())
+        {
+            throw std::invalid_argument("Cannot open file: " + path);
+        }
+        BinaryPulseReader reader(file);
+        Pulse pulse;
+        while (reader.read(pulse))
+        {
+            columns.write(pulse);
+        }
+    }
+    return toDict(columns);
+}
+} // namespace
+
+PYBIND11_MODULE(ptrac, m)
+{
+    m.doc() = "Binary MCNP PTRAC files as chunks of NumPy arrays. The arrays own the "
+              "buffers the parser filled, nothing is copied.";
+
+    m.attr("CELL") = static_cast<unsigned>(EventProjection::Cell);
+    m.attr("POSITION") = static_cast<unsigned>(EventProjection::Position);
+    m.attr("ENERGY") = static_cast<unsigned>(EventProjection::Energy);
+    m.attr("WEIGHT") = static_cast<unsigned>(EventProjection::Weight);
+    m.attr("TIME") = static_cast<unsigned>(EventProjection::Time);
+    m.attr("ALL_FIELDS") = static_cast<unsigned>(EventProjection::AllFields);
+    m.attr("SRC") = 1u << SrcEvent;
+    m.attr("BNK") = 1u << BnkEvent;
+    m.attr("SUF") = 1u << SufEvent;
+    m.attr("COL") = 1u << ColEvent;
+    m.attr("TER") = 1u << TerEvent;
+    m.attr("ALL_EVENT_TYPES") = (1u << NbEventTypes) - 1;
+
+    py::class_<EventChunks>(m, "EventChunks")
+        .def("__iter__", [](EventChunks &chunks) -> EventChunks & { return chunks; })
+        .def("__next__", &EventChunks::next);
+
+    py::class_<PulseChunks>(m, "PulseChunks")
+        .def("__iter__", [](PulseChunks &chunks) -> PulseChunks & { return chunks; })
+        .def("__next__", &PulseChunks::next);
+
+    py::class_<Reader>(m, "Reader")
+        .def(py::init([](py::object paths, unsigned threads) {
+                 if (py::isinstance<py::str>(paths))
+                 {
+                     return new Reader({paths.cast<std::string>()}, threads);
+                 }
+                 return new Reader(paths.cast<std::vector<std::string>>(), threads);
+             }),
+             py::arg("paths"), py::arg("threads") = 0,
+             "Opens a PTRAC file, a list of files or a pattern like 'job.*/ptrac'. Several "
+             "files are parsed on up to threads threads, 0 for one per core.")
+        .def(
+            "set_projection",
+            [](Reader &reader, unsigned fields, unsigned eventTypes, std::vector<long> const &cells) {
+                EventProjection projection;
+                projection.fields = fields;
+                projection.eventTypes = eventTypes;
+                projection.cells = cells;
+                reader.setProjection(projection);
+            },
+            py::arg("fields") = static_cast<unsigned>(EventProjection::AllFields),
+            py::arg("event_types") = (1u << NbEventTypes) - 1, py::arg("cells") = std::vector<long>(),
+            "Decodes only these fields and event types, and only the particles with an "
+            "event in one of the cells if any are given.")
+        .def("set_nps_range", &Reader::setNPSRange, py::arg("begin"), py::arg("end"),
+             "Reads only the histories with begin <= NPS < end.")
+        .def_property_readonly("nps_read", &Reader::getNPSRead)
+        .def(
+            "events", [](Reader &reader, long histories) { return new EventChunks(reader, histories); },
+            py::arg("histories") = 65536, py::keep_alive<0, 1>(),
+            "Iterates over the events of chunks of histories. Each chunk is a dict of "
+            "columns: nps, event_id, cell, x, y, z, energy, weight, time, and "
+            "particle_offsets where particle i owns the events "
+            "[particle_offsets[i], particle_offsets[i + 1]).")
+        .def(
+            "pulses",
+            [](Reader &reader, std::vector<long> const &cells, long histories) {
+                return new PulseChunks(reader, cells, histories);
+            },
+            py::arg("cells") = std::vector<long>{defaultDetectorCell}, py::arg("histories") = 65536,
+            py::keep_alive<0, 1>(),
+            "Iterates over the pulses built from chunks of histories, with the pulse "
+            "projection. Each chunk is a dict of columns: start and end (n x 3, cm), "
+            "energy (MeV), time (shakes), nps and cell.");
+
+    m.def("load_pulses", &loadPulses, py::arg("path"),
+          "Reads a binary pulse file into a dict of columns, like the pulse chunks.");
+}
@@ -0,0 +1,55 @@
+"""Checks the arrays of the ptrac module against the EventColumns of the C++ reader.
+
+usage: ptracmodule_test.py ptracgen columnsdump, with the module on PYTHONPATH
+"""
+import os
+import subprocess
+import sys
+import tempfile
+import unittest
+
+import numpy as np
+import ptrac
+
+PTRACGEN, COLUMNSDUMP = sys.argv[1], sys.argv[2]
+FIELDS = ["nps", "event_id", "cell", "x", "y", "z", "energy", "weight", "time"]
+
+
+class PtracModuleTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.directory = tempfile.TemporaryDirectory()
+        cls.path = os.path.join(cls.directory.name, "module_test.ptrac")
+        subprocess.run([PTRACGEN, cls.path, "--histories", "500"], check=True, stdout=subprocess.DEVNULL)
+        lines = subprocess.run([COLUMNSDUMP, cls.path], check=True, stdout=subprocess.PIPE,
+                               universal_newlines=True).stdout.splitlines()
+        events = [line.split() for line in lines[:-1]]
+        cls.expected = {}
+        for i, field in enumerate(FIELDS):
+            kind = int if i < 3 else float
+            cls.expected[field] = np.array([kind(event[i]) for event in events])
+        cls.expectedOffsets = np.array([int(offset) for offset in lines[-1].split()])
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.directory.cleanup()
+
+    def test_events_match_event_columns(self):
+        # chunks smaller than the file, their columns put back together
+        chunks = list(ptrac.Reader(self.path).events(histories=64))
+        self.assertEqual(len(chunks), 8)
+        for field in FIELDS:
+            np.testing.assert_array_equal(np.concatenate([chunk[field] for chunk in chunks]),
+                                          self.expected[field], err_msg=field)
+        offsets = [chunks[0]["particle_offsets"]]
+        for chunk in chunks[1:]:
+            offsets.append(chunk["particle_offsets"][1:] + offsets[-1][-1])
+        np.testing.assert_array_equal(np.concatenate(offsets), self.expectedOffsets)
+
+    def test_missing_file_raises(self):
+        with self.assertRaises(ValueError):
+            ptrac.Reader(os.path.join(self.directory.name, "typo.ptrac"))
+
+
+if __name__ == "__main__":
+    unittest.main(argv=sys.argv[:1])
@@ -0,0 +1,91 @@
+/**
+ * @file allocationcounter.cc
+ * @brief Counts heap allocations, to check that steady-state parsing makes none
+ * @date 2026-10-17
+ */
+#include "allocationcounter.hh"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<uint64_t> nbAllocations(0);
+thread_local uint64_t nbThreadAllocations = 0;
+
+void *allocate(std::size_t size)
+{
+    nbAllocations.fetch_add(1, std::memory_order_relaxed);
+    nbThreadAllocations++;
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+} // namespace
+
+uint64_t AllocationCounter::count()
+{
+    return nbAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::threadCount()
+{
+    return nbThreadAllocations;
+}
+
+void *operator new(std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, std::nothrow_t const &) noexcept
+{
+    try
+    {
+        return allocate(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
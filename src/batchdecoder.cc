@@ -0,0 +1,159 @@
+/**
+ * @file batchdecoder.cc
+ * @brief Extracts the fields of many data lines at once into event columns
+ * @date 2026-10-17
+ */
+#include "batchdecoder.hh"
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PTRAC_AVX2_EXTRACTOR
+#include <immintrin.h>
+#endif
+
+/******************************************
+*                                         *
+*  methods of the BatchFieldTable struct  *
+*                                         *
+******************************************/
+
+BatchFieldTable::BatchFieldTable(PTRACSchema const &schema)
+{
+    for (int type = 0; type < 8; type++)
+    {
+        const std::size_t absent = EventSchema::absent;
+        std::size_t fields[NbFields] = {absent, absent, absent, absent, absent, absent, absent};
+        if (type < NbEventTypes)
+        {
+            EventSchema const &event = schema.events[type];
+            const std::size_t known[NbFields] = {event.cell, event.x, event.y, event.z,
+                                                 event.erg, event.wt, event.tme};
+            std::copy(known, known + NbFields, fields);
+        }
+        for (int f = 0; f < NbFields; f++)
+        {
+            offsets[f][type] = fields[f] == absent ? -1 : static_cast<int64_t>(fields[f]);
+        }
+    }
+    for (int f = 0; f < NbFields; f++)
+    {
+        extracted[f] = std::any_of(offsets[f], offsets[f] + NbEventTypes, [](int64_t offset) { return offset >= 0; });
+    }
+}
+
+namespace
+{
+inline void extractOne(const char *base, RecordBatch const &batch, BatchFieldTable const &table,
+                       NPSHistory &history, std::size_t i, std::size_t event)
+{
+    const char *record = base + batch.offsets[i];
+    const int64_t category = batch.categories[i];
+    auto field = [&](int f, double absent) {
+        const int64_t offset = table.offsets[f][category];
+        return offset < 0 ? absent : loadBinary<double>(record + offset);
+    };
+    if (table.extracted[BatchFieldTable::Cell])
+        history.cellID[event] = static_cast<long>(field(BatchFieldTable::Cell, -1));
+    if (table.extracted[BatchFieldTable::X])
+        history.x[event] = field(BatchFieldTable::X, 0);
+    if (table.extracted[BatchFieldTable::Y])
+        history.y[event] = field(BatchFieldTable::Y, 0);
+    if (table.extracted[BatchFieldTable::Z])
+        history.z[event] = field(BatchFieldTable::Z, 0);
+    if (table.extracted[BatchFieldTable::Energy])
+        history.energy[event] = field(BatchFieldTable::Energy, 0);
+    if (table.extracted[BatchFieldTable::Weight])
+        history.weight[event] = field(BatchFieldTable::Weight, 0);
+    if (table.extracted[BatchFieldTable::Time])
+        history.time[event] = field(BatchFieldTable::Time, 0);
+}
+} // namespace
+
+void extractEventsScalar(const char *base, RecordBatch const &batch, BatchFieldTable const &table,
+                         NPSHistory &history, std::size_t first)
+{
+    for (std::size_t i = 0; i < batch.size(); i++)
+    {
+        extractOne(base, batch, table, history, i, first + i);
+    }
+}
+
+#ifdef PTRAC_AVX2_EXTRACTOR
+
+__attribute__((target("avx2")))
+void extractEventsAVX2(const char *base, RecordBatch const &batch, BatchFieldTable const &table,
+                       NPSHistory &history, std::size_t first)
+{
+    double *columns[BatchFieldTable::NbFields] = {nullptr,
+                                                  history.x.data() + first, history.y.data() + first,
+                                                  history.z.data() + first, history.energy.data() + first,
+                                                  history.weight.data() + first, history.time.data() + first};
+    long *cells = history.cellID.data() + first;
+    const double *origin = reinterpret_cast<const double *>(base);
+    const __m256i missing = _mm256_set1_epi64x(-1);
+    // adding 2^52 + 2^51 moves an integer valued double into the low mantissa bits
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+
+    const std::size_t n = batch.size();
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256i records = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(batch.offsets.data() + i));
+        const __m256i categories = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(batch.categories.data() + i));
+        for (int f = 0; f < BatchFieldTable::NbFields; f++)
+        {
+            if (!table.extracted[f])
+            {
+                continue;
+            }
+            // offset of the field in each of the four data lines
+            const __m256i offsets = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(table.offsets[f]),
+                                                           categories, 8);
+            const __m256d present = _mm256_castsi256_pd(_mm256_cmpgt_epi64(offsets, missing));
+            const __m256d absent = _mm256_set1_pd(f == BatchFieldTable::Cell ? -1 : 0);
+            const __m256d values = _mm256_mask_i64gather_pd(absent, origin, _mm256_add_epi64(records, offsets),
+                                                            present, 1);
+            if (f == BatchFieldTable::Cell)
+            {
+                const __m256d truncated = _mm256_round_pd(values, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+                const __m256i ids = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(truncated, magic)),
+                                                     _mm256_castpd_si256(magic));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(cells + i), ids);
+            }
+            else
+            {
+                _mm256_storeu_pd(columns[f] + i, values);
+            }
+        }
+    }
+    for (; i < n; i++)
+    {
+        extractOne(base, batch, table, history, i, first + i);
+    }
+}
+
+bool hasAVX2Extractor()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+void extractEventsAVX2(const char *base, RecordBatch const &batch, BatchFieldTable const &table,
+                       NPSHistory &history, std::size_t first)
+{
+    extractEventsScalar(base, batch, table, history, first);
+}
+
+bool hasAVX2Extractor()
+{
+    return false;
+}
+
+#endif
+
+BatchExtractor selectBatchExtractor()
+{
+    static const BatchExtractor extractor = hasAVX2Extractor() ? &extractEventsAVX2 : &extractEventsScalar;
+    return extractor;
+}
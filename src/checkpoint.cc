@@ -0,0 +1,179 @@
+/**
+ * @file checkpoint.cc
+ * @brief Checkpoints of a pulse extraction, to resume it after it was killed
+ * @date 2026-10-17
+ */
+#include "checkpoint.hh"
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace
+{
+const char *checkpointMagic = "PTRACCKPT";
+const long checkpointVersion = 1;
+
+/// writes the data of the file at path to disk
+bool syncFile(std::string const &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/// the whole of text as a number, throws std::invalid_argument otherwise
+long toLong(std::string const &text)
+{
+    std::size_t length;
+    const long value = std::stol(text, &length);
+    if (length != text.size())
+    {
+        throw std::invalid_argument("not a number: " + text);
+    }
+    return value;
+}
+
+std::string directoryOf(std::string const &path)
+{
+    const std::size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+}
+} // namespace
+
+/************************************
+*                                   *
+*  methods of the Checkpoint class  *
+*                                   *
+************************************/
+
+std::string Checkpoint::defaultPath(std::string const &outputPath)
+{
+    return outputPath + ".ckpt";
+}
+
+bool Checkpoint::save(std::string const &path) const
+{
+    // the pulses the checkpoint counts must be on disk before it is
+    if (!syncFile(outputPath))
+    {
+        return false;
+    }
+    const std::string tmpPath = path + ".tmp";
+    {
+        // one key and its value per line, the value is the rest of the line
+        std::ofstream file(tmpPath, std::ios::trunc);
+        file << checkpointMagic << " " << checkpointVersion << "\n"
+             << "ptrac " << ptracPath << "\n"
+             << "ptrac_size " << ptracStamp.size << "\n"
+             << "ptrac_mtime_sec " << ptracStamp.mtimeSec << "\n"
+             << "ptrac_mtime_nsec " << ptracStamp.mtimeNsec << "\n"
+             << "offset " << offset << "\n"
+             << "nps_read " << npsRead << "\n"
+             << "pulses " << nbPulses << "\n"
+             << "output " << outputPath << "\n"
+             << "output_position " << outputPosition << "\n"
+             << "settings " << settings << "\n"
+             << "end\n";
+        file.close();
+        if (!file.good() || !syncFile(tmpPath))
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        return false;
+    }
+    // makes the rename itself survive a crash
+    syncFile(directoryOf(path));
+    return true;
+}
+
+bool Checkpoint::load(std::string const &path)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!std::getline(file, line) || line != checkpointMagic + (" " + std::to_string(checkpointVersion)))
+    {
+        return false;
+    }
+    std::map<std::string, std::string> values;
+    bool ended = false;
+    while (std::getline(file, line))
+    {
+        if (line == "end")
+        {
+            ended = true;
+            break;
+        }
+        const std::size_t space = line.find(' ');
+        if (space == std::string::npos)
+        {
+            return false;
+        }
+        values[line.substr(0, space)] = line.substr(space + 1);
+    }
+    // a checkpoint without its last line was not written by save
+    if (!ended)
+    {
+        return false;
+    }
+    try
+    {
+        Checkpoint loaded;
+        loaded.ptracPath = values.at("ptrac");
+        loaded.ptracStamp = FileStamp{toLong(values.at("ptrac_size")), toLong(values.at("ptrac_mtime_sec")),
+                                      toLong(values.at("ptrac_mtime_nsec"))};
+        loaded.offset = toLong(values.at("offset"));
+        loaded.npsRead = toLong(values.at("nps_read"));
+        loaded.nbPulses = toLong(values.at("pulses"));
+        loaded.outputPath = values.at("output");
+        loaded.outputPosition = toLong(values.at("output_position"));
+        loaded.settings = values.at("settings");
+        if (loaded.offset < 0 || loaded.npsRead < 0 || loaded.nbPulses < 0 || loaded.outputPosition < 0)
+        {
+            return false;
+        }
+        *this = loaded;
+    }
+    catch (std::logic_error const &)
+    {
+        // a missing key or a value that is not a number
+        return false;
+    }
+    return true;
+}
+
+void Checkpoint::validate(std::string const &ptracPath, std::string const &settings) const
+{
+    if (ptracPath != this->ptracPath)
+    {
+        throw std::runtime_error("Checkpoint is of " + this->ptracPath + ", not " + ptracPath);
+    }
+    if (!(FileStamp::of(ptracPath) == ptracStamp))
+    {
+        throw std::runtime_error("PTRAC file changed since the checkpoint: " + ptracPath);
+    }
+    if (settings != this->settings)
+    {
+        throw std::runtime_error("Checkpoint was taken with other settings: " + this->settings);
+    }
+    if (FileStamp::of(outputPath).size < outputPosition)
+    {
+        throw std::runtime_error("Pulse file is shorter than at the checkpoint: " + outputPath);
+    }
+}
+
+bool Checkpoint::truncateOutput() const
+{
+    return ::truncate(outputPath.c_str(), outputPosition) == 0;
+}
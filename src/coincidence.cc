@@ -0,0 +1,163 @@
+/**
+ * @file coincidence.cc
+ * @brief Streaming coincidence analysis of a time-ordered pulse train
+ * @date 2026-10-17
+ */
+#include "coincidence.hh"
+#include <cmath>
+#include <iomanip>
+#include <stdexcept>
+
+/********************************************
+*                                           *
+*  methods of the CoincidenceCounter class  *
+*                                           *
+********************************************/
+
+CoincidenceCounter::CoincidenceCounter(CoincidenceOptions const& options)
+    : options(options), rossiRange(options.rossiBinWidth * options.rossiNbBins),
+      started(false), origin(0), last(0), nbPulses(0), nbPairs(0), gateStart(0), gateCount(0),
+      rossiAlpha(options.rossiNbBins, 0)
+{
+    if (!(options.window > 0) || !(options.rossiBinWidth > 0))
+    {
+        throw std::invalid_argument("coincidence window and bin width must be positive");
+    }
+    for (double width : options.feynmanGates)
+    {
+        if (!(width > 0))
+        {
+            throw std::invalid_argument("Feynman gate widths must be positive");
+        }
+        feynman.push_back(FeynmanGate{width, 0, 0, {}});
+    }
+}
+
+void CoincidenceCounter::write(const Pulse& p)
+{
+    const double t = p.time;
+    if (!started)
+    {
+        started = true;
+        origin = last = gateStart = t;
+    }
+    if (t < last)
+    {
+        throw std::logic_error("pulses are not sorted by time");
+    }
+    last = t;
+    nbPulses++;
+
+    // multiplicity
+    if (gateCount > 0 && t - gateStart < options.window)
+    {
+        gateCount++;
+    }
+    else
+    {
+        if (gateCount > 0)
+        {
+            increment(multiplicity, gateCount);
+        }
+        gateStart = t;
+        gateCount = 1;
+    }
+
+    // Rossi-alpha, against the earlier pulses still in range
+    while (!window.empty() && t - window.front() >= rossiRange)
+    {
+        window.pop_front();
+    }
+    for (std::size_t i = 0; i < window.size(); i++)
+    {
+        const std::size_t bin = static_cast<std::size_t>((t - window[i]) / options.rossiBinWidth);
+        if (bin < rossiAlpha.size())
+        {
+            rossiAlpha[bin]++;
+            nbPairs++;
+        }
+    }
+    window.push_back(t);
+
+    // Feynman-Y
+    for (auto& gate : feynman)
+    {
+        const long index = static_cast<long>((t - origin) / gate.width);
+        if (index != gate.current)
+        {
+            increment(gate.counts, gate.count);
+            // gates without any pulse
+            increment(gate.counts, 0, index - gate.current - 1);
+            gate.current = index;
+            gate.count = 0;
+        }
+        gate.count++;
+    }
+}
+
+void CoincidenceCounter::flush()
+{
+    if (gateCount > 0)
+    {
+        increment(multiplicity, gateCount);
+        gateCount = 0;
+    }
+}
+
+double CoincidenceCounter::feynmanY(std::size_t g) const
+{
+    std::vector<uint64_t> const& counts = feynman[g].counts;
+    double n = 0, sum = 0, sum2 = 0;
+    for (std::size_t k = 0; k < counts.size(); k++)
+    {
+        n += counts[k];
+        sum += static_cast<double>(k) * counts[k];
+        sum2 += static_cast<double>(k) * k * counts[k];
+    }
+    if (n == 0 || sum == 0)
+    {
+        return 0;
+    }
+    const double mean = sum / n;
+    const double variance = sum2 / n - mean * mean;
+    return variance / mean - 1;
+}
+
+void CoincidenceCounter::report(std::ostream& os) const
+{
+    os << "# pulses " << nbPulses << ", pairs " << nbPairs << "\n";
+    os << "# multiplicity, window " << options.window << " shakes\n";
+    os << "#  multiplicity          events\n";
+    for (std::size_t m = 1; m < multiplicity.size(); m++)
+    {
+        os << std::setw(15) << m << std::setw(16) << multiplicity[m] << '\n';
+    }
+    os << "# Rossi-alpha, bin width " << options.rossiBinWidth << " shakes\n";
+    os << "#      dt(shakes)           pairs\n";
+    for (std::size_t i = 0; i < rossiAlpha.size(); i++)
+    {
+        os << std::setw(17) << i * options.rossiBinWidth << std::setw(16) << rossiAlpha[i] << '\n';
+    }
+    for (std::size_t g = 0; g < feynman.size(); g++)
+    {
+        os << "# Feynman-Y, gate " << feynman[g].width << " shakes, Y = " << feynmanY(g) << '\n';
+        os << "#         pulses           gates\n";
+        for (std::size_t k = 0; k < feynman[g].counts.size(); k++)
+        {
+            os << std::setw(16) << k << std::setw(16) << feynman[g].counts[k] << '\n';
+        }
+    }
+}
+
+void CoincidenceCounter::increment(std::vector<uint64_t>& histogram, std::size_t bin, uint64_t n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+    if (bin >= histogram.size())
+    {
+        histogram.resize(bin + 1, 0);
+    }
+    histogram[bin] += n;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file deadtime.cc
+ * @brief Pile-up and dead time of each detector cell
+ * @date 2026-10-17
+ */
+#include "deadtime.hh"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+/****************************************
+*                                       *
+*  methods of the DeadTimeWriter class  *
+*                                       *
+****************************************/
+
+DeadTimeWriter::DeadTimeWriter(PulseWriter& out, DetectorCells const& cells, DeadTimeOptions const& options)
+    : out(out), cells(cells), options(options),
+      states(cells.size(), CellState{false, -std::numeric_limits<double>::infinity(), 0, 0, {0, 0, 0}, {0, 0, 0}, 0}),
+      last(-std::numeric_limits<double>::infinity()), nbPiledUp(0), nbLost(0), nbRecorded(0)
+{
+    if (options.resolvingTime < 0 || options.deadTime < 0)
+    {
+        throw std::invalid_argument("resolving time and dead time cannot be negative");
+    }
+}
+
+void DeadTimeWriter::write(const Pulse& p)
+{
+    const double t = p.time;
+    if (t < last)
+    {
+        throw std::logic_error("pulses are not sorted by time");
+    }
+    last = t;
+    const int cell = cells.index(p.cellID);
+    if (cell < 0)
+    {
+        throw std::logic_error("pulse in cell " + std::to_string(p.cellID) + " which is not a detector cell");
+    }
+    close(t);
+
+    CellState& state = states[cell];
+    const bool paralyzable = options.model == DeadTimeModel::Paralyzable;
+    if (state.open && t < state.time + options.resolvingTime)
+    {
+        // pile-up
+        state.energy += p.energy;
+        std::copy(p.endPos.begin(), p.endPos.end(), state.endPos);
+        if (paralyzable)
+        {
+            state.deadUntil = t + options.deadTime;
+        }
+        nbPiledUp++;
+    }
+    else if (options.model != DeadTimeModel::None && t < state.deadUntil)
+    {
+        if (paralyzable)
+        {
+            state.deadUntil = t + options.deadTime;
+        }
+        nbLost++;
+    }
+    else
+    {
+        state.open = true;
+        state.time = t;
+        state.energy = p.energy;
+        std::copy(p.startPos.begin(), p.startPos.end(), state.startPos);
+        std::copy(p.endPos.begin(), p.endPos.end(), state.endPos);
+        state.nps = p.nps;
+        state.deadUntil = t + options.deadTime;
+        openCells.push_back(cell);
+    }
+}
+
+void DeadTimeWriter::flush()
+{
+    close(std::numeric_limits<double>::infinity());
+    out.flush();
+}
+
+void DeadTimeWriter::close(double t)
+{
+    // pulses are opened in time order and all have the same resolving time,
+    // so they close in the same order
+    while (!openCells.empty())
+    {
+        const int cell = openCells.front();
+        CellState& state = states[cell];
+        if (t < state.time + options.resolvingTime)
+        {
+            break;
+        }
+        pulse.nps = state.nps;
+        pulse.cellID = cells[cell];
+        pulse.time = state.time;
+        pulse.energy = state.energy;
+        pulse.startPos.assign(state.startPos, state.startPos + 3);
+        pulse.endPos.assign(state.endPos, state.endPos + 3);
+        pulse.pos.resize(3);
+        for (int i = 0; i < 3; i++)
+        {
+            pulse.pos[i] = (state.startPos[i] + state.endPos[i]) * 0.5;
+        }
+        out.write(pulse);
+        state.open = false;
+        nbRecorded++;
+        openCells.pop_front();
+    }
+}
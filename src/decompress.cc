@@ -0,0 +1,209 @@
+/**
+ * @file decompress.cc
+ * @brief Streaming decompression of gzip and zstd compressed PTRAC files
+ * @date 2026-10-17
+ */
+#include "decompress.hh"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef PTRAC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+Compression detectCompression(const char *bytes, std::size_t n)
+{
+    const unsigned char *magic = reinterpret_cast<const unsigned char *>(bytes);
+    if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    {
+        return Compression::Gzip;
+    }
+    if (n >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+    {
+        return Compression::Zstd;
+    }
+    return Compression::None;
+}
+
+Compression detectCompression(std::string const &path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    char bytes[4];
+    file.read(bytes, sizeof(bytes));
+    return detectCompression(bytes, file.gcount());
+}
+
+bool hasZstd()
+{
+#ifdef PTRAC_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+/************************************
+*                                   *
+*  methods of the GzipBuffer class  *
+*                                   *
+************************************/
+
+GzipBuffer::GzipBuffer(std::streambuf &source, std::size_t bufferSize)
+    : source(source), stream(), input(bufferSize), output(bufferSize), finished(false), inMember(false)
+{
+    // 16 + MAX_WBITS: gzip header and trailer
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    {
+        throw std::runtime_error("Cannot initialize gzip decompression");
+    }
+}
+
+GzipBuffer::~GzipBuffer()
+{
+    inflateEnd(&stream);
+}
+
+GzipBuffer::int_type GzipBuffer::underflow()
+{
+    if (gptr() < egptr())
+    {
+        return traits_type::to_int_type(*gptr());
+    }
+    stream.next_out = reinterpret_cast<Bytef *>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    while (!finished && stream.avail_out == output.size())
+    {
+        if (stream.avail_in == 0)
+        {
+            const std::streamsize n = source.sgetn(input.data(), input.size());
+            if (n <= 0)
+            {
+                if (inMember)
+                {
+                    // a truncated file would otherwise read as a shorter one
+                    throw std::runtime_error("Truncated gzip stream");
+                }
+                finished = true;
+                break;
+            }
+            stream.next_in = reinterpret_cast<Bytef *>(input.data());
+            stream.avail_in = static_cast<uInt>(n);
+        }
+        inMember = true;
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END)
+        {
+            // another member may follow
+            inflateReset(&stream);
+            inMember = false;
+        }
+        else if (status != Z_OK && status != Z_BUF_ERROR)
+        {
+            throw std::runtime_error(std::string("Corrupt gzip stream: ") + (stream.msg ? stream.msg : "unknown error"));
+        }
+    }
+    const std::size_t size = output.size() - stream.avail_out;
+    setg(output.data(), output.data(), output.data() + size);
+    return size == 0 ? traits_type::eof() : traits_type::to_int_type(*gptr());
+}
+
+#ifdef PTRAC_HAVE_ZSTD
+
+namespace
+{
+/**
+ * @brief Decompresses a zstd stream, possibly made of several frames, read
+ * from another stream buffer.
+ */
+class ZstdBuffer : public std::streambuf
+{
+public:
+    explicit ZstdBuffer(std::streambuf &source)
+        : source(source), stream(ZSTD_createDStream()), input(ZSTD_DStreamInSize()),
+          output(ZSTD_DStreamOutSize()), inBuffer{input.data(), 0, 0}, finished(false), inFrame(false)
+    {
+        if (stream == nullptr)
+        {
+            throw std::runtime_error("Cannot initialize zstd decompression");
+        }
+        ZSTD_initDStream(stream);
+    }
+
+    ~ZstdBuffer()
+    {
+        ZSTD_freeDStream(stream);
+    }
+
+protected:
+    int_type underflow()
+    {
+        if (gptr() < egptr())
+        {
+            return traits_type::to_int_type(*gptr());
+        }
+        ZSTD_outBuffer outBuffer{output.data(), output.size(), 0};
+        while (!finished && outBuffer.pos == 0)
+        {
+            bool atEnd = false;
+            if (inBuffer.pos == inBuffer.size)
+            {
+                const std::streamsize n = source.sgetn(input.data(), input.size());
+                if (n <= 0 && !inFrame)
+                {
+                    finished = true;
+                    break;
+                }
+                // at the end of the input, the frame may still have output to flush
+                atEnd = n <= 0;
+                inBuffer.size = static_cast<std::size_t>(std::max<std::streamsize>(n, 0));
+                inBuffer.pos = 0;
+            }
+            // frames follow each other, the stream carries on to the next one
+            const std::size_t status = ZSTD_decompressStream(stream, &outBuffer, &inBuffer);
+            if (ZSTD_isError(status))
+            {
+                throw std::runtime_error(std::string("Corrupt zstd stream: ") + ZSTD_getErrorName(status));
+            }
+            // 0 once a frame is complete and flushed
+            inFrame = status != 0;
+            if (atEnd && inFrame && outBuffer.pos == 0)
+            {
+                // a truncated file would otherwise read as a shorter one
+                throw std::runtime_error("Truncated zstd stream");
+            }
+        }
+        setg(output.data(), output.data(), output.data() + outBuffer.pos);
+        return outBuffer.pos == 0 ? traits_type::eof() : traits_type::to_int_type(*gptr());
+    }
+
+private:
+    std::streambuf &source;
+    ZSTD_DStream *stream;
+    std::vector<char> input;
+    std::vector<char> output;
+    ZSTD_inBuffer inBuffer;
+    bool finished;
+    // a frame was started and its end not reached yet
+    bool inFrame;
+};
+} // namespace
+
+#endif
+
+std::unique_ptr<std::streambuf> makeDecompressor(Compression compression, std::streambuf &source)
+{
+    switch (compression)
+    {
+    case Compression::Gzip:
+        return std::unique_ptr<std::streambuf>(new GzipBuffer(source));
+    case Compression::Zstd:
+#ifdef PTRAC_HAVE_ZSTD
+        return std::unique_ptr<std::streambuf>(new ZstdBuffer(source));
+#else
+        throw std::runtime_error("zstd compressed PTRAC file, but this build has no zstd support");
+#endif
+    default:
+        return nullptr;
+    }
+}
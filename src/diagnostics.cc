@@ -0,0 +1,170 @@
+/**
+ * @file diagnostics.cc
+ * @brief Counts and samples of the anomalies met while parsing, reported at
+ * the end instead of printed as they happen
+ * @date 2026-10-17
+ */
+#include "diagnostics.hh"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace Diagnostics
+{
+namespace
+{
+/// counters of one thread, folded into the totals when the thread ends
+struct alignas(64) ThreadCounters
+{
+    std::atomic<uint64_t> counts[NbAnomalies];
+    std::atomic<std::size_t> sampled[NbAnomalies];
+
+    ThreadCounters();
+    ~ThreadCounters();
+};
+
+// guards the list of live threads, the totals of the threads that ended and
+// the samples
+std::mutex mutex;
+std::vector<ThreadCounters *> threads;
+uint64_t ended[NbAnomalies] = {};
+std::vector<Sample> kept[NbAnomalies];
+
+ThreadCounters::ThreadCounters()
+{
+    for (int a = 0; a < NbAnomalies; a++)
+    {
+        counts[a].store(0, std::memory_order_relaxed);
+        sampled[a].store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int a = 0; a < NbAnomalies; a++)
+    {
+        ended[a] += counts[a].load(std::memory_order_relaxed);
+    }
+    threads.erase(std::find(threads.begin(), threads.end(), this));
+}
+
+ThreadCounters &local()
+{
+    thread_local ThreadCounters counters;
+    return counters;
+}
+} // namespace
+
+const char *name(Anomaly anomaly)
+{
+    static const char *names[NbAnomalies] = {"unusual_bank_event", "missing_termination", "corrupt_region"};
+    return names[anomaly];
+}
+
+const char *description(Anomaly anomaly)
+{
+    static const char *descriptions[NbAnomalies] = {
+        "bank events with an unusual event number",
+        "particles that do not end with eventID 5000 after a detector event",
+        "corrupt regions skipped"};
+    return descriptions[anomaly];
+}
+
+void record(Anomaly anomaly, long value, long nps)
+{
+    ThreadCounters &counters = local();
+    // only this thread writes its counters
+    counters.counts[anomaly].store(counters.counts[anomaly].load(std::memory_order_relaxed) + 1,
+                                   std::memory_order_relaxed);
+    if (counters.sampled[anomaly].load(std::memory_order_relaxed) < maxSamples)
+    {
+        counters.sampled[anomaly].fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (kept[anomaly].size() < maxSamples)
+        {
+            kept[anomaly].push_back(Sample{value, nps});
+        }
+    }
+}
+
+uint64_t count(Anomaly anomaly)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t total = ended[anomaly];
+    for (auto counters : threads)
+    {
+        total += counters->counts[anomaly].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::vector<Sample> samples(Anomaly anomaly)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return kept[anomaly];
+}
+
+bool empty()
+{
+    for (int a = 0; a < NbAnomalies; a++)
+    {
+        if (count(static_cast<Anomaly>(a)) > 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int a = 0; a < NbAnomalies; a++)
+    {
+        ended[a] = 0;
+        kept[a].clear();
+        for (auto counters : threads)
+        {
+            counters->counts[a].store(0, std::memory_order_relaxed);
+            counters->sampled[a].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void report(std::ostream &out)
+{
+    for (int a = 0; a < NbAnomalies; a++)
+    {
+        const Anomaly anomaly = static_cast<Anomaly>(a);
+        const uint64_t n = count(anomaly);
+        if (n == 0)
+        {
+            continue;
+        }
+        out << n << " " << description(anomaly) << ", e.g.";
+        for (auto const &sample : samples(anomaly))
+        {
+            out << " " << sample.value;
+            if (sample.nps >= 0)
+            {
+                out << " (NPS " << sample.nps << ")";
+            }
+        }
+        out << "\n";
+    }
+    out.flush();
+}
+
+void writeJSON(std::ostream &out)
+{
+    out << "{";
+    for (int a = 0; a < NbAnomalies; a++)
+    {
+        out << (a ? ", " : "") << "\"" << name(static_cast<Anomaly>(a)) << "\": " << count(static_cast<Anomaly>(a));
+    }
+    out << "}";
+}
+} // namespace Diagnostics
@@ -0,0 +1,110 @@
+/**
+ * @file instrumentation.cc
+ * @brief Counters and stage timers of the hot paths, compiled out unless
+ * PTRAC_INSTRUMENTATION is defined
+ * @date 2026-10-17
+ */
+#include "instrumentation.hh"
+#include "diagnostics.hh"
+#include <atomic>
+#include <iomanip>
+
+namespace Instrumentation
+{
+const char *name(Counter counter)
+{
+    static const char *names[NbCounters] = {"bytes", "records", "events", "particles", "histories", "pulses"};
+    return names[counter];
+}
+
+const char *name(Stage stage)
+{
+    static const char *names[NbStages] = {"read", "read_wait", "decode", "build", "write", "checkpoint"};
+    return names[stage];
+}
+
+#ifdef PTRAC_INSTRUMENTATION
+
+namespace
+{
+// one cache line each, the decoding threads update them concurrently
+struct alignas(64) Slot
+{
+    std::atomic<uint64_t> value{0};
+};
+Slot counters[NbCounters];
+Slot timers[NbStages];
+} // namespace
+
+void add(Counter counter, uint64_t n)
+{
+    counters[counter].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+void addTime(Stage stage, uint64_t nanoseconds)
+{
+    timers[stage].value.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+uint64_t get(Counter counter)
+{
+    return counters[counter].value.load(std::memory_order_relaxed);
+}
+
+uint64_t nanoseconds(Stage stage)
+{
+    return timers[stage].value.load(std::memory_order_relaxed);
+}
+
+void reset()
+{
+    for (auto &slot : counters)
+    {
+        slot.value.store(0, std::memory_order_relaxed);
+    }
+    for (auto &slot : timers)
+    {
+        slot.value.store(0, std::memory_order_relaxed);
+    }
+}
+
+#endif
+
+void writeJSON(std::ostream &out, double wallSeconds, uint64_t allocations)
+{
+    const double seconds = wallSeconds > 0 ? wallSeconds : 1;
+    out << "{\n  \"instrumented\": " << (enabled ? "true" : "false") << ",\n";
+    out << "  \"wall_seconds\": " << wallSeconds << ",\n";
+    out << "  \"allocations\": " << allocations << ",\n";
+    out << "  \"counters\": {";
+    for (int c = 0; c < NbCounters; c++)
+    {
+        out << (c ? ", " : "") << '"' << name(Counter(c)) << "\": " << get(Counter(c));
+    }
+    out << "},\n  \"seconds\": {";
+    for (int s = 0; s < NbStages; s++)
+    {
+        out << (s ? ", " : "") << '"' << name(Stage(s)) << "\": " << nanoseconds(Stage(s)) * 1e-9;
+    }
+    out << "},\n  \"rates\": {\"mb_per_second\": " << get(Bytes) / seconds / (1 << 20)
+        << ", \"histories_per_second\": " << get(Histories) / seconds
+        << ", \"pulses_per_second\": " << get(Pulses) / seconds << "},\n  \"anomalies\": ";
+    Diagnostics::writeJSON(out);
+    out << "\n}\n";
+}
+
+void writeThroughput(std::ostream &out, long nps, double seconds)
+{
+    out << "NPS = " << nps;
+    if (enabled && seconds > 0)
+    {
+        const std::ios::fmtflags flags = out.flags();
+        const std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(1) << ", " << get(Bytes) / seconds / (1 << 20) << " MB/s, "
+            << std::setprecision(0) << get(Histories) / seconds << " histories/s";
+        out.flags(flags);
+        out.precision(precision);
+    }
+    out << '\n';
+}
+} // namespace Instrumentation
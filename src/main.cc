@@ -8,61 +8,408 @@
 #include <fstream>
 #include <string>
 #include <chrono>
+#include <climits>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "allocationcounter.hh"
+#include "checkpoint.hh"
+#include "diagnostics.hh"
+#include "instrumentation.hh"
+#include "multireader.hh"
+#include "parallelparser.hh"
+#include "coincidence.hh"
+#include "deadtime.hh"
+#include "pipeline.hh"
+#include "timesort.hh"
+
+/// cell numbers of a list like 601,602,610-620
+std::vector<long> parseCells(std::string const& list)
+{
+    std::vector<long> cells;
+    std::istringstream items(list);
+    std::string item;
+    while (std::getline(items, item, ','))
+    {
+        const std::size_t dash = item.find('-', 1);
+        const long first = std::stol(item.substr(0, dash));
+        const long last = dash == std::string::npos ? first : std::stol(item.substr(dash + 1));
+        for (long cell = first; cell <= last; cell++)
+            cells.push_back(cell);
+    }
+    return cells;
+}
+
+/// gate widths of a list like 10,100,1000
+std::vector<double> parseGates(std::string const& list)
+{
+    std::vector<double> gates;
+    std::istringstream items(list);
+    std::string item;
+    while (std::getline(items, item, ','))
+        gates.push_back(std::stod(item));
+    return gates;
+}
 
-#include "parser.hh"
-#include "pulse.hh"
 int main(int argc, char** argv)
 {
     auto startTime = std::chrono::high_resolution_clock::now();
 
-    const std::string outpath("pulses.txt");
+    // usage: main ptrac... [--nps-begin N] [--nps-end N]
+    //                   [--format text|binary] [--layout row|column]
+    //                   [--cells 601,602,610-620]
+    //                   [--sort-time] [--sort-memory MB] [--tmpdir DIR]
+    //                   [--source-rate HISTORIES_PER_SECOND] [--seed S]
+    //                   [--coincidence REPORT] [--coincidence-window SHAKES]
+    //                   [--rossi-bin SHAKES] [--rossi-bins N] [--feynman-gates 10,100,...]
+    //                   [--resolving-time SHAKES] [--dead-time SHAKES]
+    //                   [--dead-time-model paralyzable|non-paralyzable]
+    //                   [--report REPORT.json] [--single-pass] [--recover]
+    //                   [--checkpoint SECONDS] [--resume]
+    std::vector<std::string> ptracPatterns;
+    long npsBegin(0), npsEnd(LONG_MAX);
+    bool binary(false);
+    PulseLayout layout(PulseLayout::ColumnMajor);
+    PipelineOptions options;
+    bool sortTime(false);
+    TimeSortOptions sortOptions;
+    double sourceRate(0);
+    unsigned long seed(1);
+    std::string coincidencePath;
+    std::string reportPath;
+    bool singlePass(false);
+    bool recover(false);
+    bool checkpointing(false);
+    bool resume(false);
+    CoincidenceOptions coincidenceOptions;
+    DeadTimeOptions deadTimeOptions;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--nps-begin" && i + 1 < argc)
+            npsBegin = std::stol(argv[++i]);
+        else if (arg == "--nps-end" && i + 1 < argc)
+            npsEnd = std::stol(argv[++i]);
+        else if (arg == "--format" && i + 1 < argc)
+            binary = std::string(argv[++i]) == "binary";
+        else if (arg == "--layout" && i + 1 < argc)
+            layout = std::string(argv[++i]) == "row" ? PulseLayout::RowMajor : PulseLayout::ColumnMajor;
+        else if (arg == "--cells" && i + 1 < argc)
+            options.detectorCells = parseCells(argv[++i]);
+        else if (arg == "--sort-time")
+            sortTime = true;
+        else if (arg == "--sort-memory" && i + 1 < argc)
+            sortOptions.memoryBudget = static_cast<std::size_t>(std::stod(argv[++i]) * (1 << 20));
+        else if (arg == "--tmpdir" && i + 1 < argc)
+            sortOptions.runDirectory = argv[++i];
+        else if (arg == "--source-rate" && i + 1 < argc)
+            sourceRate = std::stod(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = std::stoul(argv[++i]);
+        else if (arg == "--coincidence" && i + 1 < argc)
+            coincidencePath = argv[++i];
+        else if (arg == "--coincidence-window" && i + 1 < argc)
+            coincidenceOptions.window = std::stod(argv[++i]);
+        else if (arg == "--rossi-bin" && i + 1 < argc)
+            coincidenceOptions.rossiBinWidth = std::stod(argv[++i]);
+        else if (arg == "--rossi-bins" && i + 1 < argc)
+            coincidenceOptions.rossiNbBins = std::stoul(argv[++i]);
+        else if (arg == "--feynman-gates" && i + 1 < argc)
+            coincidenceOptions.feynmanGates = parseGates(argv[++i]);
+        else if (arg == "--resolving-time" && i + 1 < argc)
+            deadTimeOptions.resolvingTime = std::stod(argv[++i]);
+        else if (arg == "--dead-time" && i + 1 < argc)
+        {
+            deadTimeOptions.deadTime = std::stod(argv[++i]);
+            if (deadTimeOptions.model == DeadTimeModel::None)
+                deadTimeOptions.model = DeadTimeModel::NonParalyzable;
+        }
+        else if (arg == "--report" && i + 1 < argc)
+            reportPath = argv[++i];
+        else if (arg == "--single-pass")
+            singlePass = true;
+        else if (arg == "--recover")
+            recover = true;
+        else if (arg == "--checkpoint" && i + 1 < argc)
+        {
+            options.checkpointInterval = std::stod(argv[++i]);
+            checkpointing = true;
+        }
+        else if (arg == "--resume")
+            resume = checkpointing = true;
+        else if (arg == "--dead-time-model" && i + 1 < argc)
+            deadTimeOptions.model = std::string(argv[++i]) == "paralyzable" ? DeadTimeModel::Paralyzable
+                                                                            : DeadTimeModel::NonParalyzable;
+        else
+            ptracPatterns.push_back(arg);
+    }
+    // several jobs, given as a list or as a quoted pattern like 'job.*/ptrac'
+    const std::vector<std::string> ptracPaths = expandPTRACPaths(ptracPatterns);
+    if (ptracPaths.empty())
+    {
+        throw std::invalid_argument("Usage: main ptrac... [--nps-begin N] [--nps-end N] "
+                                    "[--format text|binary] [--layout row|column] "
+                                    "[--cells 601,602,610-620] [--sort-time] [--sort-memory MB] "
+                                    "[--tmpdir DIR] [--source-rate HISTORIES_PER_SECOND] [--seed S] "
+                                    "[--coincidence REPORT] [--coincidence-window SHAKES] "
+                                    "[--rossi-bin SHAKES] [--rossi-bins N] [--feynman-gates 10,100,...] "
+                                    "[--resolving-time SHAKES] [--dead-time SHAKES] "
+                                    "[--dead-time-model paralyzable|non-paralyzable] "
+                                    "[--report REPORT.json] [--single-pass] [--recover] "
+                                    "[--checkpoint SECONDS] [--resume]");
+    }
+    const std::string& ptracFilePath = ptracPaths.front();
+    std::unique_ptr<MCNPPTRAC> ptracFile;
+    MCNPPTRACParallel* mapped = nullptr;
+    if (singlePass && (ptracPaths.size() > 1 || detectCompression(ptracFilePath) != Compression::None))
+    {
+        throw std::invalid_argument("--single-pass needs a single uncompressed PTRAC file");
+    }
+    if (ptracPaths.size() > 1)
+    {
+        // one reader per file, NPS renumbered after the files before
+        if (npsBegin > 0 || npsEnd != LONG_MAX)
+        {
+            throw std::invalid_argument("--nps-begin and --nps-end need a single PTRAC file");
+        }
+        ptracFile.reset(new MCNPPTRACMulti(ptracPaths));
+    }
+    else if (detectCompression(ptracFilePath) != Compression::None)
+    {
+        // compressed files cannot be mapped, they are decompressed while streaming
+        if (npsBegin > 0 || npsEnd != LONG_MAX)
+        {
+            throw std::invalid_argument("--nps-begin and --nps-end need an uncompressed PTRAC file");
+        }
+        ptracFile.reset(new MCNPPTRACBinary(ptracFilePath));
+    }
+    else
+    {
+        std::unique_ptr<MCNPPTRACParallel> parallel(new MCNPPTRACParallel(ptracFilePath));
+        if (npsBegin > 0 || npsEnd != LONG_MAX)
+        {
+            // jump straight to the slice using the NPS index sidecar
+            parallel->setNPSRange(npsBegin, npsEnd);
+        }
+        mapped = parallel.get();
+        ptracFile = std::move(parallel);
+    }
+    if (checkpointing)
+    {
+        // the pulse file only depends on the histories read so far if no
+        // writer keeps pulses or state across histories
+        if (mapped == nullptr)
+        {
+            throw std::invalid_argument("--checkpoint and --resume need a single uncompressed PTRAC file");
+        }
+        if (sortTime || sourceRate > 0 || !coincidencePath.empty() || deadTimeOptions.resolvingTime > 0 ||
+            deadTimeOptions.model != DeadTimeModel::None)
+        {
+            throw std::invalid_argument("--checkpoint and --resume cannot be used with time sorting, "
+                                        "--source-rate, --coincidence or dead time");
+        }
+    }
+
+    // pulses need neither weights nor the particles that miss every detector cell
+    ptracFile->setProjection(EventProjection::pulses(options.detectorCells));
+    if (recover)
+    {
+        // skip what a killed job left corrupt or truncated instead of stopping
+        ptracFile->setRecovery(true);
+    }
+
+    const std::string outpath(binary ? "pulses.bin" : "pulses.txt");
+    const std::string checkpointPath(Checkpoint::defaultPath(outpath));
+    Checkpoint checkpoint;
+    checkpoint.ptracPath = ptracFilePath;
+    checkpoint.ptracStamp = FileStamp::of(ptracFilePath);
+    checkpoint.outputPath = outpath;
+    // everything the pulse file depends on besides the histories
+    std::ostringstream settings;
+    settings << "format=" << (binary ? "binary" : "text") << " layout=" << static_cast<uint32_t>(layout)
+             << " nps-begin=" << npsBegin << " nps-end=" << npsEnd << " cells=";
+    for (std::size_t c = 0; c < options.detectorCells.size(); c++)
+        settings << (c ? "," : "") << options.detectorCells[c];
+    checkpoint.settings = settings.str();
+
+    std::ios::openmode mode = binary ? std::ios::out | std::ios::binary : std::ios::out;
+    long resumedPulses = 0;
+    if (resume)
+    {
+        Checkpoint saved;
+        if (!saved.load(checkpointPath))
+        {
+            throw std::invalid_argument("No valid checkpoint to resume from: " + checkpointPath);
+        }
+        saved.validate(ptracFilePath, checkpoint.settings);
+        // the pulses written after the checkpoint are written again
+        if (!saved.truncateOutput() || !mapped->resume(saved.offset, saved.npsRead))
+        {
+            throw std::runtime_error("Cannot resume from checkpoint: " + checkpointPath);
+        }
+        resumedPulses = saved.nbPulses;
+        mode |= std::ios::in;
+        std::cout << "Resuming after " << saved.npsRead << " histories and " << saved.nbPulses
+                  << " pulses written" << std::endl;
+    }
     std::ofstream outfile;
-    outfile.open(outpath, std::ios::out);
+    outfile.open(outpath, mode);
     if (!outfile.good())
     {
         throw std::invalid_argument("Cannot create file: " + outpath);
     }
+    outfile.seekp(0, std::ios::end);
+    std::unique_ptr<PulseWriter> writer;
+    if (binary)
+        writer.reset(new BinaryPulseWriter(outfile, layout, 1 << 16, !resume));
+    else
+        writer.reset(new TextPulseWriter(outfile, !resume, 16 << 20, options.detectorCells.size() > 1));
+    if (checkpointing)
+    {
+        // called by the writing thread once the writer is flushed
+        options.checkpoint = [&](PipelineProgress const& progress) {
+            checkpoint.offset = progress.offset;
+            checkpoint.npsRead = progress.npsRead;
+            checkpoint.nbPulses = resumedPulses + progress.nbPulses;
+            checkpoint.outputPosition = static_cast<long>(outfile.tellp());
+            if (!checkpoint.save(checkpointPath))
+            {
+                // the pulse file is still fine, only a restart would redo more
+                std::cerr << "Cannot write checkpoint: " << checkpointPath << std::endl;
+            }
+        };
+    }
+
+    // optionally count coincidences, which needs the pulses sorted by time
+    std::unique_ptr<CoincidenceCounter> coincidences;
+    std::unique_ptr<PulseWriter> tee;
+    PulseWriter* output = writer.get();
+    if (!coincidencePath.empty())
+    {
+        coincidences.reset(new CoincidenceCounter(coincidenceOptions));
+        tee.reset(new TeePulseWriter(*output, *coincidences));
+        output = tee.get();
+        sortTime = true;
+    }
+
+    // optionally pile up and drop pulses in each cell, also on sorted pulses
+    std::unique_ptr<DeadTimeWriter> deadTime;
+    if (deadTimeOptions.resolvingTime > 0 || deadTimeOptions.model != DeadTimeModel::None)
+    {
+        deadTime.reset(new DeadTimeWriter(*output, DetectorCells(options.detectorCells), deadTimeOptions));
+        output = deadTime.get();
+        sortTime = true;
+    }
+
+    // optionally place the histories on one timeline and sort the pulses by time
+    std::unique_ptr<PulseWriter> sorter, shifter;
+    if (sortTime)
+    {
+        sorter.reset(new TimeSortingWriter(*output, sortOptions));
+        output = sorter.get();
+    }
+    if (sourceRate > 0)
+    {
+        shifter.reset(new TimeOffsetWriter(*output, SourceTimeline(sourceRate, seed)));
+        output = shifter.get();
+    }
 
-    const std::string ptracFilePath(argv[1]);
-    MCNPPTRACBinary ptracFile(ptracFilePath);
-    const long maxNum(1e9);
-    long pulseIdx(0);
-    std::vector<Pulse> pulses;
-    // read pulses from file
-    // int nps(0);
-    while (ptracFile.readNextNPS(maxNum))
-    {
-        if (ptracFile.getNPSRead() % 1000000 == 0)
+    long pulseNum;
+    if (singlePass)
+    {
+        // build the pulses while the events are decoded, on this thread,
+        // without storing any history
+        PulseVisitor visitor(DetectorCells(options.detectorCells), *output);
+        if (checkpointing)
         {
-            std::cout << "NPS = " << ptracFile.getNPSRead() << '\n';
+            // visit chunks of histories, so that a checkpoint can be taken between two
+            const long chunk = 1 << 16;
+            auto lastCheckpoint = std::chrono::steady_clock::now();
+            while (mapped->visit(visitor, mapped->getNPSRead() + chunk - 1) > 0)
+            {
+                const auto now = std::chrono::steady_clock::now();
+                if (std::chrono::duration<double>(now - lastCheckpoint).count() >= options.checkpointInterval)
+                {
+                    Instrumentation::ScopedTimer timer(Instrumentation::Checkpoint);
+                    output->flush();
+                    options.checkpoint(PipelineProgress{mapped->getNPSRead(), mapped->tell(),
+                                                        static_cast<long>(visitor.getNbPulses())});
+                    lastCheckpoint = now;
+                }
+            }
         }
-        const NPSHistory record = ptracFile.getNPSHistory();
-        for (auto iter = record.begin(); iter != record.end(); iter++)
+        else
         {
-            Pulse newPulse(*iter);
-            if (newPulse.energy <= 0)
-                continue;
-            // else, it is a vaild pulse
-            pulses.push_back(newPulse);
-            pulseIdx++;
-            if (pulseIdx >= maxNum)
-                break;
+            mapped->visit(visitor);
         }
-        if (pulseIdx >= maxNum)
-            break;
+        output->flush();
+        pulseNum = visitor.getNbPulses();
+        Instrumentation::add(Instrumentation::Pulses, pulseNum);
     }
-
-    // write header
-    outfile << "#    x1(cm)      y1(cm)      z1(cm)      x2(cm)      y2(cm)      z2(cm)    energy(MeV)        time(shakes)           nps\n";
-    // write pulses to file
-    for (int i = 0; i < pulses.size(); i++)
+    else
     {
-        outfile << pulses[i] << '\n';
+        // parse, build pulses and write them on separate threads
+        PulsePipeline pipeline(*ptracFile, *output, options);
+        pulseNum = pipeline.run();
     }
     outfile.close();
+    pulseNum += resumedPulses;
+    if (checkpointing)
+    {
+        // the job is done, a later --resume would have nothing to do
+        std::remove(checkpointPath.c_str());
+    }
+    if (deadTime)
+    {
+        std::cout << pulseNum << " pulses built, " << deadTime->getNbPiledUp() << " piled up, "
+                  << deadTime->getNbLost() << " lost in dead time" << std::endl;
+        std::cout << deadTime->getNbRecorded() << " pulses written to " << outpath << std::endl;
+    }
+    else
+    {
+        std::cout << pulseNum << " pulses written to " << outpath << std::endl;
+    }
+    if (recover)
+    {
+        std::size_t bytes = 0;
+        for (auto const& region : ptracFile->getSkippedRegions())
+        {
+            std::cout << "Skipped " << region.length << " bytes at offset " << region.offset << " of "
+                      << region.path << " after NPS " << region.lastNPS << ": " << region.reason << std::endl;
+            bytes += region.length;
+        }
+        std::cout << ptracFile->getSkippedRegions().size() << " corrupt regions skipped, " << bytes << " bytes"
+                  << std::endl;
+    }
+    // anomalies are counted while parsing and only reported here
+    Diagnostics::report(std::cout);
+    if (coincidences)
+    {
+        std::ofstream report(coincidencePath);
+        if (!report.good())
+        {
+            throw std::invalid_argument("Cannot create file: " + coincidencePath);
+        }
+        coincidences->report(report);
+        std::cout << coincidences->getNbPairs() << " pairs written to " << coincidencePath << std::endl;
+    }
 
     auto endTime = std::chrono::high_resolution_clock::now();
     std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count() << "ms" << std::endl; 
+    if (AllocationCounter::enabled)
+        std::cout << AllocationCounter::count() << " heap allocations" << std::endl;
+    if (!reportPath.empty())
+    {
+        std::ofstream report(reportPath);
+        if (!report.good())
+        {
+            throw std::invalid_argument("Cannot create file: " + reportPath);
+        }
+        const std::chrono::duration<double> wall = endTime - startTime;
+        Instrumentation::writeJSON(report, wall.count(), AllocationCounter::count());
+        std::cout << "Report written to " << reportPath << std::endl;
+    }
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,431 @@
+/**
+ * @file mmapparser.cc
+ * @brief Memory-mapped binary PTRAC file parser
+ * @date 2026-10-17
+ */
+#include "mmapparser.hh"
+#include "instrumentation.hh"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*************************************
+*                                   *
+*  methods of the MappedFile class  *
+*                                   *
+*************************************/
+
+MappedFile::MappedFile(std::string const &path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        void *addr = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            // records are consumed front to back
+            madvise(addr, status.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(addr);
+            length = status.st_size;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data)
+    {
+        munmap(const_cast<char *>(data), length);
+    }
+}
+
+/***************************************
+*                                      *
+*  methods of the MCNPPTRACMmap class  *
+*                                      *
+****************************************/
+
+MCNPPTRACMmap::MCNPPTRACMmap(std::string const &ptracPath)
+    : path(ptracPath), ptracFile(ptracPath), npsEnd(LONG_MAX), extractor(selectBatchExtractor()),
+      npsLineLength(2 * sizeof(long)), lastValidNPS(0)
+{
+    if (!ptracFile.isOpen())
+    {
+        throw std::invalid_argument("PTRAC file " + ptracPath + " not found.");
+    }
+    cursor = ptracFile.begin();
+    parseHeader();
+    firstHistory = cursor;
+    if (ptracFile.end() - cursor >= static_cast<std::ptrdiff_t>(sizeof(int)))
+    {
+        npsLineLength = static_cast<std::size_t>(std::max(loadBinary<int>(cursor), 0));
+    }
+}
+
+bool MCNPPTRACMmap::readNextNPS(long maxReadHist)
+{
+    while (npsRead <= maxReadHist)
+    {
+        try
+        {
+            if (atRangeEnd(cursor))
+            {
+                return false;
+            }
+            parsePTRACRecord();
+        }
+        catch (std::logic_error const &error)
+        {
+            if (!recovery)
+            {
+                throw;
+            }
+            // the cursor only moves once the whole history is decoded
+            skipCorruptRegion(error);
+            continue;
+        }
+        lastValidNPS = npsHistory.historyNPS;
+        incrementNPSRead();
+        return true;
+    }
+    return false;
+}
+
+NPSIndex const &MCNPPTRACMmap::loadIndex(long stride)
+{
+    if (!index.empty())
+    {
+        return index;
+    }
+    const std::string sidecar = NPSIndex::sidecarPath(path);
+    const FileStamp stamp = FileStamp::of(path);
+    if (index.load(sidecar, stamp, firstHistory - ptracFile.begin()))
+    {
+        return index;
+    }
+
+    NPSIndex scanned(stride);
+    long nps;
+    for (const char *position = firstHistory; position < ptracFile.end();)
+    {
+        const char *next = skipHistory(position, nps);
+        scanned.add(nps, position - ptracFile.begin());
+        position = next;
+    }
+    index = std::move(scanned);
+    if (!index.save(sidecar, stamp))
+    {
+        std::cerr << "Cannot write NPS index " << sidecar << std::endl;
+    }
+    return index;
+}
+
+bool MCNPPTRACMmap::seekToNPS(long nps)
+{
+    loadIndex();
+    NPSIndex::Entry const *entry = index.floor(nps);
+    const char *position = entry ? ptracFile.begin() + entry->offset : firstHistory;
+    long skipped;
+    while (position < ptracFile.end() && peekNPS(position) < nps)
+    {
+        position = skipHistory(position, skipped);
+    }
+    cursor = position;
+    return !atRangeEnd(cursor);
+}
+
+void MCNPPTRACMmap::setProjection(EventProjection const &projection)
+{
+    checkProjection(schema, projection);
+    MCNPPTRAC::setProjection(projection);
+    fields = BatchFieldTable(projectSchema(schema, this->projection));
+}
+
+void MCNPPTRACMmap::setRecovery(bool recover)
+{
+    recovery = recover;
+}
+
+long MCNPPTRACMmap::tell() const
+{
+    return cursor - ptracFile.begin();
+}
+
+bool MCNPPTRACMmap::resume(long offset, long nbRead)
+{
+    if (offset < firstHistory - ptracFile.begin() || offset > static_cast<long>(ptracFile.size()))
+    {
+        return false;
+    }
+    const char *position = ptracFile.begin() + offset;
+    if (position < ptracFile.end())
+    {
+        try
+        {
+            long nps;
+            skipHistory(position, nps);
+        }
+        catch (std::logic_error const &)
+        {
+            return false;
+        }
+    }
+    cursor = position;
+    npsRead = nbRead;
+    return true;
+}
+
+void MCNPPTRACMmap::skipCorruptRegion(std::logic_error const &error)
+{
+    const char *next = resync(cursor + 1);
+    const SkippedRegion region{path, static_cast<std::size_t>(cursor - ptracFile.begin()),
+                               static_cast<std::size_t>(next - cursor), lastValidNPS, error.what()};
+    Diagnostics::record(Diagnostics::CorruptRegion, static_cast<long>(region.length), region.lastNPS);
+    skipped.push_back(region);
+    cursor = next;
+}
+
+const char *MCNPPTRACMmap::resync(const char *from) const
+{
+    const std::ptrdiff_t npsRecord = 2 * sizeof(int) + npsLineLength;
+    for (const char *position = from; ptracFile.end() - position >= npsRecord; position++)
+    {
+        // an NPS line has both record markers and a later NPS, the rest of
+        // the history is then checked record by record
+        if (loadBinary<int>(position) != static_cast<int>(npsLineLength) ||
+            loadBinary<int>(position + sizeof(int) + npsLineLength) != static_cast<int>(npsLineLength) ||
+            loadBinary<long>(position + sizeof(int)) <= lastValidNPS)
+        {
+            continue;
+        }
+        try
+        {
+            long nps;
+            skipHistory(position, nps);
+            return position;
+        }
+        catch (std::logic_error const &)
+        {
+        }
+    }
+    return ptracFile.end();
+}
+
+bool MCNPPTRACMmap::setNPSRange(long npsBegin, long npsEnd)
+{
+    this->npsEnd = npsEnd;
+    return seekToNPS(npsBegin);
+}
+
+long MCNPPTRACMmap::peekNPS(const char *position) const
+{
+    std::size_t length;
+    const char *buffer = ::nextRecord(position, ptracFile.end(), length); // NPS line
+    if (length < sizeof(long))
+    {
+        throw std::logic_error("NPS line is too short");
+    }
+    return loadBinary<long>(buffer);
+}
+
+const char *MCNPPTRACMmap::nextRecord(std::size_t &length)
+{
+    return ::nextRecord(cursor, ptracFile.end(), length);
+}
+
+void MCNPPTRACMmap::parseHeader()
+{
+    skipHeader();
+    skipPtracInputData();
+    parseVariableIDs();
+}
+
+void MCNPPTRACMmap::skipHeader()
+{
+    std::size_t length;
+    nextRecord(length); // header
+    nextRecord(length); // code, version, dates
+    nextRecord(length); // calculation title
+}
+
+void MCNPPTRACMmap::skipPtracInputData()
+{
+    std::size_t length;
+    const char *buffer = nextRecord(length);
+    const char *bufferEnd = buffer + length;
+    int n_fields_total = (int)loadBinary<double>(buffer);
+    buffer += sizeof(double);
+    int n_fields_read = 0;
+    int n_desc = 0;
+
+    while (n_fields_read < n_fields_total)
+    {
+        if (buffer + sizeof(double) > bufferEnd)
+        {
+            buffer = nextRecord(length);
+            bufferEnd = buffer + length;
+        }
+        if (n_desc == 0)
+        {
+            n_desc = (int)loadBinary<double>(buffer);
+            ++n_fields_read;
+        }
+        else
+        {
+            --n_desc; // throw away field descriptor
+        }
+        buffer += sizeof(double);
+    }
+}
+
+void MCNPPTRACMmap::parseVariableIDs()
+{
+    std::size_t length6, length7;
+    const char *line6 = nextRecord(length6); // number of variables
+    const char *line7 = nextRecord(length7); // variable ids
+    schema = parseSchema(line6, length6, line7, length7);
+    fields = BatchFieldTable(schema);
+}
+
+void MCNPPTRACMmap::parsePTRACRecord()
+{
+    cursor = decodeHistory(cursor, npsHistory);
+}
+
+const char *MCNPPTRACMmap::decodeHistory(const char *begin, NPSHistory &history) const
+{
+    history.clear();
+    const char *const start = begin;
+    std::size_t nbRecords = 1;
+
+    long nps = -1;
+    long event = -1;
+    constexpr long lastEvent = 9000;
+
+    std::size_t length;
+    const char *buffer = ::nextRecord(begin, ptracFile.end(), length); // NPS line
+    if (length < 2 * sizeof(long))
+    {
+        throw std::logic_error("NPS line is too short");
+    }
+    nps = loadBinary<long>(buffer);
+    event = loadBinary<long>(buffer + sizeof(long));
+    if (!isBnkEvent(event))
+    {
+        throw std::logic_error("expected bank event at the start of the history, got event " + std::to_string(event));
+    }
+    recordBnkEvent(event);
+    history.historyNPS = nps;
+
+    // histories are decoded on several threads, each keeps its own list
+    thread_local RecordBatch batch;
+    batch.clear();
+    const bool filterCells = !projection.cells.empty();
+    bool inCells = false;
+    std::size_t particleBegin = 0;
+    while (event != lastEvent)
+    {
+        const int type = eventType(event);
+        if (type < 0 || schema.events[type].next == EventSchema::absent)
+        {
+            throw std::logic_error("unknown event type " + std::to_string(event));
+        }
+        EventSchema const &layout = schema.events[type];
+        buffer = ::nextRecord(begin, ptracFile.end(), length); // data line
+        if (length < layout.length || (layout.exactLength && length != layout.length))
+        {
+            throw std::logic_error("data line length does not match the event type");
+        }
+        nbRecords++;
+        if (filterCells && !inCells && layout.cell != EventSchema::absent)
+        {
+            inCells = projection.keepsCell(static_cast<long>(loadBinary<double>(buffer + layout.cell)));
+        }
+        if (projection.keepsType(type))
+        {
+            history.nps.push_back(nps);
+            history.eventID.push_back(event);
+            batch.add(buffer - ptracFile.begin(), type);
+        }
+        event = static_cast<long>(loadBinary<double>(buffer + layout.next));
+        if (isBnkEvent(event) || event == lastEvent)
+        {
+            if (event != lastEvent)
+            {
+                recordBnkEvent(event);
+            }
+            if (filterCells && !inCells)
+            {
+                // dropped before any of its fields is extracted
+                history.discardParticle();
+                batch.truncate(particleBegin);
+            }
+            if (history.openEvents() > 0)
+            {
+                history.endParticle();
+            }
+            inCells = false;
+            particleBegin = batch.size();
+        }
+    }
+
+    // columns of the fields that are not extracted keep these values
+    const std::size_t nbEvents = history.nbEvents();
+    history.cellID.resize(nbEvents, -1);
+    for (auto column : {&history.x, &history.y, &history.z, &history.energy, &history.weight, &history.time})
+    {
+        column->resize(nbEvents);
+    }
+    extractor(ptracFile.begin(), batch, fields, history, 0);
+
+    Instrumentation::add(Instrumentation::Bytes, begin - start);
+    Instrumentation::add(Instrumentation::Records, nbRecords);
+    Instrumentation::add(Instrumentation::Events, nbEvents);
+    Instrumentation::add(Instrumentation::Particles, history.size());
+    Instrumentation::add(Instrumentation::Histories, 1);
+    return begin;
+}
+
+const char *MCNPPTRACMmap::skipHistory(const char *begin, long &nps) const
+{
+    constexpr long lastEvent = 9000;
+
+    std::size_t length;
+    const char *buffer = ::nextRecord(begin, ptracFile.end(), length); // NPS line
+    if (length < 2 * sizeof(long))
+    {
+        throw std::logic_error("NPS line is too short");
+    }
+    nps = loadBinary<long>(buffer);
+
+    // only the type of the next event is needed to find the end of the history
+    long event = loadBinary<long>(buffer + sizeof(long));
+    if (!isBnkEvent(event))
+    {
+        throw std::logic_error("expected bank event at the start of the history, got event " + std::to_string(event));
+    }
+    while (event != lastEvent)
+    {
+        const int type = eventType(event);
+        if (type < 0 || schema.events[type].next == EventSchema::absent)
+        {
+            throw std::logic_error("unknown event type " + std::to_string(event));
+        }
+        EventSchema const &layout = schema.events[type];
+        buffer = ::nextRecord(begin, ptracFile.end(), length);
+        if (length < layout.length || (layout.exactLength && length != layout.length))
+        {
+            throw std::logic_error("data line length does not match the event type");
+        }
+        event = static_cast<long>(loadBinary<double>(buffer + layout.next));
+    }
+    return begin;
+}
@@ -0,0 +1,234 @@
+/**
+ * @file multireader.cc
+ * @brief Reads the PTRAC files of several MCNP jobs as a single file
+ * @date 2026-10-17
+ */
+#include "multireader.hh"
+#include "mmapparser.hh"
+#include <climits>
+#include <glob.h>
+#include <stdexcept>
+#include <unistd.h>
+
+std::unique_ptr<MCNPPTRAC> openPTRAC(std::string const &path)
+{
+    if (detectCompression(path) != Compression::None)
+    {
+        return std::unique_ptr<MCNPPTRAC>(new MCNPPTRACBinary(path));
+    }
+    return std::unique_ptr<MCNPPTRAC>(new MCNPPTRACMmap(path));
+}
+
+std::vector<std::string> expandPTRACPaths(std::vector<std::string> const &patterns)
+{
+    std::vector<std::string> paths;
+    for (auto const &pattern : patterns)
+    {
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+        {
+            // glob sorts the matches
+            paths.insert(paths.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+        }
+        else
+        {
+            paths.push_back(pattern);
+        }
+        globfree(&matches);
+    }
+    return paths;
+}
+
+/****************************************
+*                                       *
+*  methods of the MCNPPTRACMulti class  *
+*                                       *
+****************************************/
+
+MCNPPTRACMulti::MCNPPTRACMulti(std::vector<std::string> const &paths, unsigned nbThreads,
+                               std::size_t batchSize, std::size_t nbBatches)
+    : batchSize(std::max<std::size_t>(1, batchSize)), started(false), current(0), position(0), offset(0),
+      lastNPS(0),
+      pool(nbThreads == 0 ? static_cast<unsigned>(std::min<std::size_t>(
+                                std::max(1u, std::thread::hardware_concurrency()), std::max<std::size_t>(1, paths.size())))
+                          : nbThreads)
+{
+    if (paths.empty())
+    {
+        throw std::invalid_argument("No PTRAC file to read");
+    }
+    for (auto const &path : paths)
+    {
+        // fail here rather than on a worker thread
+        if (access(path.c_str(), R_OK) != 0)
+        {
+            throw std::invalid_argument("PTRAC file " + path + " not found.");
+        }
+    }
+    nbBatches = std::max<std::size_t>(1, nbBatches);
+    for (auto const &path : paths)
+    {
+        files.emplace_back(new File(path, nbBatches));
+        for (std::size_t i = 0; i < nbBatches; i++)
+        {
+            files.back()->free.push(Batch());
+        }
+    }
+}
+
+void MCNPPTRACMulti::setProjection(EventProjection const &projection)
+{
+    if (started)
+    {
+        throw std::logic_error("the projection must be set before reading");
+    }
+    MCNPPTRAC::setProjection(projection);
+}
+
+void MCNPPTRACMulti::setRecovery(bool recover)
+{
+    if (started)
+    {
+        throw std::logic_error("recovery must be set before reading");
+    }
+    // compressed files are streamed and cannot skip, fail before any is read
+    for (auto const &file : files)
+    {
+        if (recover && detectCompression(file->path) != Compression::None)
+        {
+            throw std::invalid_argument("cannot skip corrupt regions of compressed PTRAC file " + file->path);
+        }
+    }
+    recovery = recover;
+}
+
+void MCNPPTRACMulti::start()
+{
+    // the pool starts the files in order, so the file being consumed is
+    // always one of those being parsed
+    for (auto &file : files)
+    {
+        File *parsed = file.get();
+        file->task = pool.submit([this, parsed] { parseFile(*parsed); });
+    }
+    started = true;
+}
+
+MCNPPTRACMulti::~MCNPPTRACMulti()
+{
+    for (auto &file : files)
+    {
+        file->free.close();
+        file->filled.close();
+    }
+    for (auto &file : files)
+    {
+        if (file->task.valid())
+        {
+            file->task.wait();
+        }
+    }
+}
+
+bool MCNPPTRACMulti::readNextNPS(long maxReadHist)
+{
+    if (npsRead > maxReadHist)
+    {
+        return false;
+    }
+    if (!started)
+    {
+        start();
+    }
+    if (position == batch.size && !nextBatch())
+    {
+        return false;
+    }
+    npsHistory.swap(batch.histories[position]);
+    ++position;
+    // from the NPS line, so that the renumbering does not depend on the projection
+    lastNPS = npsHistory.historyNPS;
+    npsHistory.historyNPS += offset;
+    for (auto &nps : npsHistory.nps)
+    {
+        nps += offset;
+    }
+    incrementNPSRead();
+    return true;
+}
+
+bool MCNPPTRACMulti::nextBatch()
+{
+    if (position > 0)
+    {
+        files[current]->free.push(std::move(batch));
+        batch = Batch();
+    }
+    position = 0;
+    while (current < files.size())
+    {
+        File &file = *files[current];
+        if (file.filled.pop(batch))
+        {
+            return true;
+        }
+        // the file is exhausted, or its task failed
+        file.free.close();
+        file.task.get();
+        for (auto region : file.skipped)
+        {
+            region.lastNPS += offset;
+            skipped.push_back(region);
+        }
+        offset += lastNPS;
+        lastNPS = 0;
+        current++;
+    }
+    batch = Batch();
+    return false;
+}
+
+void MCNPPTRACMulti::parseFile(File &file)
+{
+    try
+    {
+        std::unique_ptr<MCNPPTRAC> reader = openPTRAC(file.path);
+        reader->setProjection(projection);
+        if (recovery)
+        {
+            reader->setRecovery(true);
+        }
+        Batch parsed;
+        bool more = true;
+        while (more && file.free.pop(parsed))
+        {
+            parsed.size = 0;
+            while (parsed.size < batchSize)
+            {
+                more = reader->readNextNPS(LONG_MAX);
+                if (!more)
+                {
+                    break;
+                }
+                if (parsed.size == parsed.histories.size())
+                {
+                    parsed.histories.emplace_back();
+                }
+                // take over the buffers of the history instead of copying it
+                reader->swapNPSHistory(parsed.histories[parsed.size]);
+                parsed.size++;
+            }
+            if (parsed.size > 0 && !file.filled.push(std::move(parsed)))
+            {
+                break;
+            }
+        }
+        file.skipped = reader->getSkippedRegions();
+    }
+    catch (...)
+    {
+        file.filled.close();
+        throw;
+    }
+    file.filled.close();
+}
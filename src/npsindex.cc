@@ -0,0 +1,150 @@
+/**
+ * @file npsindex.cc
+ * @brief Sparse NPS number to file offset index of a PTRAC file
+ * @date 2026-10-17
+ */
+#include "npsindex.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+namespace
+{
+const char indexMagic[8] = {'P', 'T', 'R', 'A', 'C', 'I', 'D', 'X'};
+const int64_t indexVersion = 1;
+
+struct IndexHeader {
+  char magic[8];
+  int64_t version;
+  int64_t size;
+  int64_t mtimeSec;
+  int64_t mtimeNsec;
+  int64_t stride;
+  int64_t nbHistories;
+  int64_t lastNPS;
+  int64_t nbEntries;
+};
+} // namespace
+
+FileStamp FileStamp::of(std::string const &path)
+{
+    struct stat status;
+    if (stat(path.c_str(), &status) != 0)
+    {
+        return FileStamp{-1, -1, -1};
+    }
+    return FileStamp{static_cast<long>(status.st_size),
+                     static_cast<long>(status.st_mtim.tv_sec),
+                     static_cast<long>(status.st_mtim.tv_nsec)};
+}
+
+/**********************************
+*                                 *
+*  methods of the NPSIndex class  *
+*                                 *
+**********************************/
+
+NPSIndex::NPSIndex(long stride) : stride(std::max(1L, stride)), nbHistories(0), lastNPS(-1)
+{
+}
+
+std::string NPSIndex::sidecarPath(std::string const &ptracPath)
+{
+    return ptracPath + ".npsidx";
+}
+
+void NPSIndex::add(long nps, long offset)
+{
+    if (nbHistories % stride == 0)
+    {
+        entries.push_back(Entry{nps, offset});
+    }
+    ++nbHistories;
+    lastNPS = nps;
+}
+
+bool NPSIndex::load(std::string const &path, FileStamp const &stamp, long firstOffset)
+{
+    std::ifstream file(path, std::ios::binary);
+    IndexHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    // the entries fill the rest of the file, one per stride histories
+    const long sidecarSize = FileStamp::of(path).size;
+    if (std::memcmp(header.magic, indexMagic, sizeof(indexMagic)) != 0 ||
+        header.version != indexVersion ||
+        !(FileStamp{header.size, header.mtimeSec, header.mtimeNsec} == stamp) ||
+        header.stride < 1 || header.nbHistories < 0 || header.nbEntries < 0 ||
+        (sidecarSize - sizeof(header)) % sizeof(Entry) != 0 ||
+        header.nbEntries != static_cast<int64_t>((sidecarSize - sizeof(header)) / sizeof(Entry)) ||
+        header.nbEntries != header.nbHistories / header.stride + (header.nbHistories % header.stride != 0))
+    {
+        return false;
+    }
+    std::vector<Entry> loaded(header.nbEntries);
+    if (!file.read(reinterpret_cast<char *>(loaded.data()), loaded.size() * sizeof(Entry)))
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < loaded.size(); i++)
+    {
+        if (loaded[i].offset < firstOffset || loaded[i].offset >= stamp.size ||
+            loaded[i].nps > header.lastNPS ||
+            (i > 0 && (loaded[i].offset <= loaded[i - 1].offset || loaded[i].nps <= loaded[i - 1].nps)))
+        {
+            return false;
+        }
+    }
+    stride = header.stride;
+    nbHistories = header.nbHistories;
+    lastNPS = header.lastNPS;
+    entries.swap(loaded);
+    return true;
+}
+
+bool NPSIndex::save(std::string const &path, FileStamp const &stamp) const
+{
+    static_assert(sizeof(Entry) == 2 * sizeof(int64_t), "index entries are two 64-bit integers");
+    IndexHeader header;
+    std::memcpy(header.magic, indexMagic, sizeof(indexMagic));
+    header.version = indexVersion;
+    header.size = stamp.size;
+    header.mtimeSec = stamp.mtimeSec;
+    header.mtimeNsec = stamp.mtimeNsec;
+    header.stride = stride;
+    header.nbHistories = nbHistories;
+    header.lastNPS = lastNPS;
+    header.nbEntries = entries.size();
+
+    // write to a temporary file and rename it, so that readers never see a
+    // partially written index
+    const std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+        if (!file.good())
+        {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+NPSIndex::Entry const *NPSIndex::floor(long nps) const
+{
+    auto after = std::upper_bound(entries.begin(), entries.end(), nps,
+                                  [](long value, Entry const &entry) { return value < entry.nps; });
+    if (after == entries.begin())
+    {
+        return nullptr;
+    }
+    return &*(after - 1);
+}
@@ -0,0 +1,187 @@
+/**
+ * @file parallelparser.cc
+ * @brief Multi-threaded binary PTRAC file parser
+ * @date 2026-10-17
+ */
+#include "parallelparser.hh"
+
+/*******************************************
+*                                          *
+*  methods of the MCNPPTRACParallel class  *
+*                                          *
+********************************************/
+
+MCNPPTRACParallel::MCNPPTRACParallel(std::string const &ptracPath, unsigned nbThreads,
+                                     std::size_t batchSize)
+    : MCNPPTRACMmap(ptracPath), batchSize(std::max<std::size_t>(1, batchSize)),
+      started(false), active(0), position(0), pool(nbThreads)
+{
+}
+
+bool MCNPPTRACParallel::readNextNPS(long maxReadHist)
+{
+    if (npsRead > maxReadHist)
+    {
+        return false;
+    }
+    if (!started)
+    {
+        // decoding starts here, once the range and the projection are set
+        restartBatches();
+    }
+    if (position == batches[active].histories.size())
+    {
+        if (batches[active].histories.empty())
+        {
+            // end of file
+            return false;
+        }
+        // refill the drained batch while the other one is consumed
+        scheduleBatch(batches[active]);
+        active ^= 1;
+        position = 0;
+        waitBatch(batches[active]);
+        if (batches[active].histories.empty())
+        {
+            return false;
+        }
+    }
+    npsHistory.swap(batches[active].histories[position]);
+    ++position;
+    incrementNPSRead();
+    return true;
+}
+
+bool MCNPPTRACParallel::seekToNPS(long nps)
+{
+    cancelBatches();
+    started = false;
+    return MCNPPTRACMmap::seekToNPS(nps);
+}
+
+bool MCNPPTRACParallel::resume(long offset, long nbRead)
+{
+    cancelBatches();
+    started = false;
+    return MCNPPTRACMmap::resume(offset, nbRead);
+}
+
+long MCNPPTRACParallel::tell() const
+{
+    return nextHistory() - ptracFile.begin();
+}
+
+void MCNPPTRACParallel::setProjection(EventProjection const &projection)
+{
+    // the batches decoded ahead are decoded again from the next history
+    stopBatches();
+    MCNPPTRACMmap::setProjection(projection);
+}
+
+const char *MCNPPTRACParallel::nextHistory() const
+{
+    if (!started)
+    {
+        return cursor;
+    }
+    // the starts are only changed by the thread that reads
+    Batch const &current = batches[active];
+    Batch const &next = batches[active ^ 1];
+    if (position < current.starts.size())
+    {
+        return current.starts[position];
+    }
+    if (!next.starts.empty())
+    {
+        return next.starts.front();
+    }
+    return cursor;
+}
+
+void MCNPPTRACParallel::stopBatches()
+{
+    if (!started)
+    {
+        return;
+    }
+    cancelBatches();
+    cursor = nextHistory();
+    started = false;
+}
+
+void MCNPPTRACParallel::cancelBatches()
+{
+    for (auto &batch : batches)
+    {
+        for (auto &task : batch.tasks)
+        {
+            task.wait();
+        }
+    }
+}
+
+void MCNPPTRACParallel::restartBatches()
+{
+    started = true;
+    active = 0;
+    position = 0;
+    scheduleBatch(batches[0]);
+    scheduleBatch(batches[1]);
+    waitBatch(batches[0]);
+}
+
+void MCNPPTRACParallel::scheduleBatch(Batch &batch)
+{
+    batch.starts.clear();
+    batch.tasks.clear();
+    long nps;
+    while (batch.starts.size() < batchSize)
+    {
+        const char *next;
+        try
+        {
+            if (atRangeEnd(cursor))
+            {
+                break;
+            }
+            next = skipHistory(cursor, nps);
+        }
+        catch (std::logic_error const &error)
+        {
+            if (!recovery)
+            {
+                throw;
+            }
+            // only histories that read to their end are decoded
+            skipCorruptRegion(error);
+            continue;
+        }
+        lastValidNPS = nps;
+        batch.starts.push_back(cursor);
+        cursor = next;
+    }
+    batch.histories.resize(batch.starts.size());
+
+    // contiguous chunks of whole histories, one or a few per thread
+    const std::size_t nbHistories = batch.starts.size();
+    const std::size_t chunkSize = (nbHistories + pool.size() - 1) / pool.size();
+    for (std::size_t first = 0; first < nbHistories; first += chunkSize)
+    {
+        const std::size_t last = std::min(first + chunkSize, nbHistories);
+        batch.tasks.push_back(pool.submit([this, &batch, first, last] {
+            for (std::size_t i = first; i < last; i++)
+            {
+                decodeHistory(batch.starts[i], batch.histories[i]);
+            }
+        }));
+    }
+}
+
+void MCNPPTRACParallel::waitBatch(Batch &batch)
+{
+    for (auto &task : batch.tasks)
+    {
+        task.get();
+    }
+    batch.tasks.clear();
+}
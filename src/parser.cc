@@ -9,18 +9,95 @@
 */
 
 #include "parser.hh"
+#include "eventlayouts.hh"
+#include "instrumentation.hh"
 #include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <unistd.h>
 
+/*************************************
+*                                   *
+*  methods of the NPSHistory class  *
+*                                   *
+*************************************/
+
+void NPSHistory::clear()
+{
+    nps.clear();
+    eventID.clear();
+    cellID.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+    energy.clear();
+    weight.clear();
+    time.clear();
+    historyNPS = -1;
+    particleOffsets.resize(1);
+}
+
+void NPSHistory::discardParticle()
+{
+    const std::size_t begin = particleOffsets.back();
+    for (auto column : {&nps, &eventID, &cellID})
+    {
+        if (column->size() > begin)
+        {
+            column->resize(begin);
+        }
+    }
+    for (auto column : {&x, &y, &z, &energy, &weight, &time})
+    {
+        if (column->size() > begin)
+        {
+            column->resize(begin);
+        }
+    }
+}
+
+void NPSHistory::swap(NPSHistory &other)
+{
+    nps.swap(other.nps);
+    eventID.swap(other.eventID);
+    cellID.swap(other.cellID);
+    x.swap(other.x);
+    y.swap(other.y);
+    z.swap(other.z);
+    energy.swap(other.energy);
+    weight.swap(other.weight);
+    time.swap(other.time);
+    std::swap(historyNPS, other.historyNPS);
+    particleOffsets.swap(other.particleOffsets);
+}
+
+/******************************************
+*                                         *
+*  methods of the EventProjection struct  *
+*                                         *
+******************************************/
+
+EventProjection EventProjection::pulses(std::vector<long> const &cells)
+{
+    EventProjection projection;
+    projection.fields = Cell | Position | Energy | Time;
+    projection.cells = cells;
+    std::sort(projection.cells.begin(), projection.cells.end());
+    return projection;
+}
+
+bool EventProjection::keepsCell(long cell) const
+{
+    return std::binary_search(cells.begin(), cells.end(), cell);
+}
+
 /************************************
 *                                  *
 *  methods of the MCNPPTRAC class  *
 *                                  *
 ************************************/
 
-MCNPPTRAC::MCNPPTRAC() : npsRead(0)
+MCNPPTRAC::MCNPPTRAC() : npsRead(0), recovery(false)
 {
 }
 
@@ -39,20 +116,65 @@ NPSHistory const &MCNPPTRAC::getNPSHistory() const
     return npsHistory;
 }
 
+void MCNPPTRAC::swapNPSHistory(NPSHistory &history)
+{
+    npsHistory.swap(history);
+}
+
+void MCNPPTRAC::setProjection(EventProjection const &projection)
+{
+    this->projection = projection;
+    std::vector<long> &cells = this->projection.cells;
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+}
+
+void MCNPPTRAC::setRecovery(bool recover)
+{
+    if (recover)
+    {
+        throw std::invalid_argument("this reader cannot skip corrupt regions");
+    }
+}
+
 /*****************************************
 *                                        *
 *  methods of the MCNPPTRACBinary class  *
 *                                        *
 ******************************************/
 
-MCNPPTRACBinary::MCNPPTRACBinary(std::string const &ptracPath) : ptracFile(ptracPath, std::ios_base::binary)
+MCNPPTRACBinary::MCNPPTRACBinary(std::string const &ptracPath, ReadAheadOptions const &options)
+    : readAhead(ptracPath, options), ptracFile(openInput(options))
 {
-    if (ptracFile.fail())
+    if (!readAhead.is_open())
     {
         std::cerr << "PTRAC file " << ptracPath << " not found." << std::endl;
         exit(EXIT_FAILURE);
     }
+    // report read and decompression errors as they are, not as a bad stream
+    ptracFile.exceptions(std::ios::badbit);
     parseHeader();
+    projected = schema;
+}
+
+void MCNPPTRACBinary::setProjection(EventProjection const &projection)
+{
+    checkProjection(schema, projection);
+    MCNPPTRAC::setProjection(projection);
+    projected = projectSchema(schema, this->projection);
+}
+
+std::streambuf *MCNPPTRACBinary::openInput(ReadAheadOptions const &options)
+{
+    char magic[4];
+    const Compression compression = detectCompression(magic, readAhead.peek(magic, sizeof(magic)));
+    decompressor = makeDecompressor(compression, readAhead);
+    if (!decompressor)
+    {
+        return &readAhead;
+    }
+    decompressAhead.reset(new ReadAheadBuffer(*decompressor, options));
+    return decompressAhead.get();
 }
 
 bool MCNPPTRACBinary::readNextNPS(long maxReadHist)
@@ -111,156 +233,289 @@ void MCNPPTRACBinary::skipPtracInputData()
 
 void MCNPPTRACBinary::parseVariableIDs()
 {
-    std::string buffer = readRecord(ptracFile); // line 6
-    std::stringstream bufferStream(buffer);
-    //   auto const fields = reinterpretBuffer<int, long, long>(buffer);
-    // number of variables on NPS line
-    const int nbDataNPS = readBinary<int>(bufferStream);
-    // number of variable on first line for an src event
-    const long nbDataSrcLong = readBinary<long>(bufferStream);
-    // number of variable on second line for an src event
-    const long nbDataSrcDouble = readBinary<long>(bufferStream);
-    // number of variable on first line for an bank event
-    const long nbDataBnkLong = readBinary<long>(bufferStream);
-    // number of variable on second line for an bank event
-    const long nbDataBnkDouble = readBinary<long>(bufferStream);
-    // number of variable on first line for an suf event
-    const long nbDataSufLong = readBinary<long>(bufferStream);
-    // number of variable on second line for an suf event
-    const long nbDataSufDouble = readBinary<long>(bufferStream);
-    // number of variable on first line for an col event
-    const long nbDataColLong = readBinary<long>(bufferStream);
-    // number of variable on second line for an col event
-    const long nbDataColDouble = readBinary<long>(bufferStream);
-    // number of variable on first line for an ter event
-    const long nbDataTerLong = readBinary<long>(bufferStream);
-    // number of variable on second line for an ter event
-    const long nbDataTerDouble = readBinary<long>(bufferStream);
-    VariableIDNum idnum = VariableIDNum{nbDataNPS, nbDataSrcLong, nbDataSrcDouble,
-                                        nbDataBnkLong, nbDataBnkDouble,
-                                        nbDataSufLong, nbDataSufDouble,
-                                        nbDataColLong, nbDataColDouble,
-                                        nbDataTerLong, nbDataTerDouble};
-
-    buffer = readRecord(ptracFile); // line 7
-    bufferStream.str(buffer);
-    bufferStream.clear();
-
-    // Skip over the NPS data line. For some reason these fields are written as
-    // longs.
-    for (int i = 0; i < nbDataNPS; ++i)
-    {
-        reinterpretBuffer<long>(bufferStream); // variable ids on NPS lines
-    }
-
-    // throw away variable id on event lines, int
-
-    indices = EventIndices{ 0, // event type
-                            5, // cell num
-                            0, // x
-                            1, // y
-                            2, // z
-                            6, // energy
-                            7, // weight
-                            8, // time
-                            idnum
-                            };
+    const std::string line6 = readRecord(ptracFile); // number of variables
+    const std::string line7 = readRecord(ptracFile); // variable ids
+    schema = parseSchema(line6.data(), line6.size(), line7.data(), line7.size());
 }
 
 void MCNPPTRACBinary::parsePTRACRecord()
 {
-    npsHistory = NPSHistory(0);
-    
+    npsHistory.clear();
+
     long nps = -1;
     long event = -1, oldEvent = -1;
     constexpr long lastEvent = 9000;
-    long cell = -1;
 
-    double px = 0.;
-    double py = 0.;
-    double pz = 0.;
-    double erg = 0;
-    double wt = 0;
-    double tme = 0;
-
-    std::string buffer = readRecord(ptracFile); // NPS line
-    std::tie(nps, event) = reinterpretBuffer<long, long>(buffer);
+    readRecord(ptracFile, record); // NPS line
+    std::size_t nbRecords = 1, nbBytes = record.size() + 2 * sizeof(int);
+    if (record.size() < 2 * sizeof(long))
+    {
+        throw std::logic_error("NPS line is too short");
+    }
+    nps = loadBinary<long>(record.data());
+    npsHistory.historyNPS = nps;
+    event = loadBinary<long>(record.data() + sizeof(long));
     if (!isBnkEvent(event))
     {
-        std::cout << "Event number: " << event << std::endl;
-        throw std::logic_error("expected bank event at the start of the history");
+        throw std::logic_error("expected bank event at the start of the history, got event " + std::to_string(event));
     }
+    recordBnkEvent(event);
 
-    ParticleHistory parHist = ParticleHistory();
+    const bool filterCells = !projection.cells.empty();
+    bool inCells = false;
     while (event != lastEvent)
     {
-        buffer = readRecord(ptracFile); // data line (all doubles, even though the
-                                        // first group are actually longs)
-        std::stringstream bufferStream(buffer);
-        for (int i = 0; i < indices.idNum.nbDataBnkLong; ++i)
+        readRecord(ptracFile, record); // data line
+        nbRecords++;
+        nbBytes += record.size() + 2 * sizeof(int);
+        oldEvent = event;
+        const int type = eventType(oldEvent);
+        if (type >= 0 && (filterCells || !projection.keepsType(type)))
         {
-            const auto someLong = static_cast<long>(std::get<0>(reinterpretBuffer<double>(bufferStream)));
-            if (i == indices.event)
+            EventSchema const &layout = schema.events[type];
+            if (layout.next == EventSchema::absent || record.size() < layout.length)
             {
-                oldEvent = event;
-                event = someLong;
+                throw std::logic_error("data line length does not match the event type");
             }
-            else if (i == indices.cell)
+            if (filterCells && !inCells && layout.cell != EventSchema::absent)
             {
-                cell = someLong;
+                inCells = projection.keepsCell(static_cast<long>(loadBinary<double>(record.data() + layout.cell)));
             }
-            // throw away the others
-        }
-        for (int i = 0; i < indices.idNum.nbDataSrcDouble; ++i)
-        {
-            const auto someDouble = std::get<0>(reinterpretBuffer<double>(bufferStream));
-            if (i == indices.px)
+            if (!projection.keepsType(type))
             {
-                px = someDouble;
+                // skipped, only the type of the next event is read
+                event = static_cast<long>(loadBinary<double>(record.data() + layout.next));
             }
-            else if (i == indices.py)
+            else
             {
-                py = someDouble;
+                event = decodeEvent(record.data(), record.size(), projected, nps, oldEvent, npsHistory);
             }
-            else if (i == indices.pz)
+        }
+        else
+        {
+            event = decodeEvent(record.data(), record.size(), projected, nps, oldEvent, npsHistory);
+        }
+        if (isBnkEvent(event) || event == lastEvent)
+        {
+            if (event != lastEvent)
             {
-                pz = someDouble;
+                recordBnkEvent(event);
             }
-            else if (i == indices.erg)
+            if (filterCells && !inCells)
             {
-                erg = someDouble;
+                npsHistory.discardParticle();
             }
-            else if (i == indices.wt)
+            if (npsHistory.openEvents() > 0)
             {
-                wt = someDouble;
+                npsHistory.endParticle();
             }
-            else if (i == indices.tme)
+            inCells = false;
+        }
+    }
+
+    Instrumentation::add(Instrumentation::Bytes, nbBytes);
+    Instrumentation::add(Instrumentation::Records, nbRecords);
+    Instrumentation::add(Instrumentation::Events, npsHistory.nbEvents());
+    Instrumentation::add(Instrumentation::Particles, npsHistory.size());
+    Instrumentation::add(Instrumentation::Histories, 1);
+}
+
+/**********************************************
+*  decoding of the layout of the data lines   *
+**********************************************/
+
+namespace
+{
+/// historical layout: bank event counts and fixed field positions for all types
+PTRACSchema legacySchema(VariableIDNum const &idNum)
+{
+    const std::size_t nbLong = idNum.nbDataBnkLong;
+    const std::size_t doubles = nbLong * sizeof(double);
+    EventSchema event{idNum.nbDataBnkLong, idNum.nbDataSrcDouble,
+                      (idNum.nbDataBnkLong + idNum.nbDataSrcDouble) * sizeof(double),
+                      false,
+                      0,                  // event type
+                      5 * sizeof(double), // cell num
+                      doubles,            // x
+                      doubles + 8,        // y
+                      doubles + 16,       // z
+                      doubles + 6 * 8,    // energy
+                      doubles + 7 * 8,    // weight
+                      doubles + 8 * 8};   // time
+    PTRACSchema schema;
+    schema.idNum = idNum;
+    for (auto &e : schema.events)
+    {
+        e = event;
+    }
+    selectDecoders(schema);
+    return schema;
+}
+} // namespace
+
+PTRACSchema parseSchema(const char *line6, std::size_t length6, const char *line7, std::size_t length7)
+{
+    if (length6 < sizeof(int) + 10 * sizeof(long))
+    {
+        throw std::logic_error("variable count line is too short");
+    }
+    // number of variables on NPS line
+    const int nbDataNPS = loadBinary<int>(line6);
+    // number of variables on the first (long) and second (double) line of
+    // src, bnk, suf, col and ter events
+    long nbData[2 * NbEventTypes];
+    long nbEventIDs = 0;
+    for (int i = 0; i < 2 * NbEventTypes; i++)
+    {
+        nbData[i] = loadBinary<long>(line6 + sizeof(int) + i * sizeof(long));
+        if (nbData[i] < 0)
+        {
+            throw std::logic_error("negative number of variables");
+        }
+        nbEventIDs += nbData[i];
+    }
+    const VariableIDNum idNum{nbDataNPS, nbData[0], nbData[1],
+                              nbData[2], nbData[3],
+                              nbData[4], nbData[5],
+                              nbData[6], nbData[7],
+                              nbData[8], nbData[9]};
+
+    // The ids on the NPS line are written as longs, the ids on the event lines
+    // as ints, at least by MCNP6.2. Tell from the length of the line.
+    std::size_t idSize, idStart;
+    if (length7 == nbDataNPS * sizeof(long) + nbEventIDs * sizeof(int))
+    {
+        idSize = sizeof(int), idStart = nbDataNPS * sizeof(long);
+    }
+    else if (length7 == (nbDataNPS + nbEventIDs) * sizeof(long))
+    {
+        idSize = sizeof(long), idStart = nbDataNPS * sizeof(long);
+    }
+    else if (length7 == (nbDataNPS + nbEventIDs) * sizeof(int))
+    {
+        idSize = sizeof(int), idStart = nbDataNPS * sizeof(int);
+    }
+    else
+    {
+        std::cerr << "Cannot decode the PTRAC variable ids, "
+                  << "assuming the historical bank event layout for all events." << std::endl;
+        return legacySchema(idNum);
+    }
+
+    PTRACSchema schema;
+    schema.idNum = idNum;
+    const char *ids = line7 + idStart;
+    for (int type = 0; type < NbEventTypes; type++)
+    {
+        const long nbFields = nbData[2 * type] + nbData[2 * type + 1];
+        EventSchema &event = schema.events[type];
+        event = EventSchema{nbData[2 * type], nbData[2 * type + 1],
+                            nbFields * sizeof(double), true,
+                            EventSchema::absent, EventSchema::absent,
+                            EventSchema::absent, EventSchema::absent, EventSchema::absent,
+                            EventSchema::absent, EventSchema::absent, EventSchema::absent};
+        for (long i = 0; i < nbFields; i++, ids += idSize)
+        {
+            const long id = idSize == sizeof(int) ? loadBinary<int>(ids) : loadBinary<long>(ids);
+            const std::size_t offset = i * sizeof(double);
+            switch (id)
             {
-                tme = someDouble;
+            case NextEventID: event.next = offset; break;
+            case CellID: event.cell = offset; break;
+            case XID: event.x = offset; break;
+            case YID: event.y = offset; break;
+            case ZID: event.z = offset; break;
+            case EnergyID: event.erg = offset; break;
+            case WeightID: event.wt = offset; break;
+            case TimeID: event.tme = offset; break;
+            default: break; // not decoded
             }
-            // throw away the others
         }
-        parHist.push_back(Event{nps, oldEvent, cell, {px,py,pz}, erg, wt, tme});
-        if (isBnkEvent(event) || event == lastEvent)
+        if (nbFields > 0 && event.next == EventSchema::absent)
         {
-            npsHistory.push_back(parHist);
-            parHist = ParticleHistory();
+            throw std::logic_error("data lines without the type of the next event cannot be parsed");
         }
     }
+    selectDecoders(schema);
+    return schema;
 }
 
-bool isBnkEvent(const long& id)
-{   
-    if (std::abs(std::abs(id) - 2000) < 40 )
+void selectDecoders(PTRACSchema &schema)
+{
+    for (int type = 0; type < NbEventTypes; type++)
     {
-        // debugging
-        if (std::abs(std::abs(id) - 2000) != 30 && 
-            std::abs(std::abs(id) - 2000) != 33)
+        EventDecoder specialized = KnownLayouts::select(schema.events[type]);
+        schema.decoders[type] = specialized ? specialized : &decodeEventGeneric;
+    }
+}
+
+PTRACSchema projectSchema(PTRACSchema const &schema, EventProjection const &projection)
+{
+    PTRACSchema projected = schema;
+    const std::size_t absent = EventSchema::absent;
+    for (auto &event : projected.events)
+    {
+        if (!(projection.fields & EventProjection::Cell))
         {
-            std::cout << id << std::endl;
+            event.cell = absent;
+        }
+        if (!(projection.fields & EventProjection::Position))
+        {
+            event.x = event.y = event.z = absent;
+        }
+        if (!(projection.fields & EventProjection::Energy))
+        {
+            event.erg = absent;
+        }
+        if (!(projection.fields & EventProjection::Weight))
+        {
+            event.wt = absent;
+        }
+        if (!(projection.fields & EventProjection::Time))
+        {
+            event.tme = absent;
         }
-        
-        return true;
     }
-    return false;
-}
\ No newline at end of file
+    selectDecoders(projected);
+    return projected;
+}
+
+void checkProjection(PTRACSchema const &schema, EventProjection const &projection)
+{
+    if (projection.cells.empty())
+    {
+        return;
+    }
+    for (auto const &event : schema.events)
+    {
+        if (event.next != EventSchema::absent && event.cell != EventSchema::absent)
+        {
+            return;
+        }
+    }
+    throw std::invalid_argument("cannot keep particles by cell, the PTRAC file has no cell field");
+}
+
+namespace
+{
+constexpr EventTypeTable makeEventTypeTable()
+{
+    EventTypeTable table{};
+    for (long number = 0; number < maxEventNumber; number++)
+    {
+        // the thousands give the type, bank events are 2000 +- 39
+        const long category = number / 1000 - 1;
+        int8_t type = category >= 0 && category < NbEventTypes ? static_cast<int8_t>(category) : -1;
+        const bool bank = number > 2000 - 40 && number < 2000 + 40;
+        if (bank)
+        {
+            type = BnkEvent;
+        }
+        table.types[number] = type;
+        table.banks[number] = bank;
+    }
+    return table;
+}
+} // namespace
+
+constexpr EventTypeTable eventTypeTable = makeEventTypeTable();
\ No newline at end of file
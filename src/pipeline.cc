@@ -0,0 +1,202 @@
+/**
+ * @file pipeline.cc
+ * @brief Streaming parse -> pulse -> write pipeline with bounded memory
+ * @date 2026-10-17
+ */
+#include "pipeline.hh"
+#include "instrumentation.hh"
+#include <chrono>
+#include <exception>
+#include <thread>
+
+PulsePipeline::PulsePipeline(MCNPPTRAC &reader, PulseWriter &writer, PipelineOptions const &options)
+    : reader(reader), writer(writer), options(options),
+      histories(options.nbBatches), freeHistories(options.nbBatches),
+      pulses(options.nbBatches), freePulses(options.nbBatches)
+{
+    for (std::size_t i = 0; i < options.nbBatches; i++)
+    {
+        freeHistories.push(HistoryBatch());
+        freePulses.push(PulseBatch());
+    }
+}
+
+long PulsePipeline::run()
+{
+    std::exception_ptr parseError, buildError, writeError;
+    std::thread parser([this, &parseError] {
+        try
+        {
+            parse();
+        }
+        catch (...)
+        {
+            parseError = std::current_exception();
+            closeAll();
+        }
+    });
+    std::thread builder([this, &buildError] {
+        try
+        {
+            build();
+        }
+        catch (...)
+        {
+            buildError = std::current_exception();
+            closeAll();
+        }
+    });
+
+    long nbPulses = 0;
+    try
+    {
+        nbPulses = write();
+    }
+    catch (...)
+    {
+        writeError = std::current_exception();
+        closeAll();
+    }
+    parser.join();
+    builder.join();
+
+    for (auto error : {parseError, buildError, writeError})
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    return nbPulses;
+}
+
+void PulsePipeline::parse()
+{
+    const auto start = std::chrono::steady_clock::now();
+    HistoryBatch batch;
+    bool more = true;
+    while (more && freeHistories.pop(batch))
+    {
+        {
+            Instrumentation::ScopedTimer timer(Instrumentation::Decode);
+            batch.size = 0;
+            while (batch.size < options.batchSize)
+            {
+                more = reader.readNextNPS(options.maxNPS);
+                if (!more)
+                {
+                    break;
+                }
+                if (batch.size == batch.histories.size())
+                {
+                    batch.histories.emplace_back();
+                }
+                // take over the buffers of the history instead of copying it
+                reader.swapNPSHistory(batch.histories[batch.size++]);
+                if (reader.getNPSRead() % options.progressInterval == 0)
+                {
+                    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                    Instrumentation::writeThroughput(std::cout, reader.getNPSRead(), elapsed.count());
+                }
+            }
+        }
+        batch.npsRead = reader.getNPSRead();
+        batch.offset = reader.tell();
+        if (batch.size > 0 && !histories.push(std::move(batch)))
+        {
+            break;
+        }
+    }
+    histories.close();
+}
+
+void PulsePipeline::build()
+{
+    long nbPulses = 0;
+    bool done = nbPulses >= options.maxPulses;
+    HistoryBatch batch;
+    PulseBatch out;
+    PulseBuilder builder{DetectorCells(options.detectorCells)};
+    while (!done && histories.pop(batch))
+    {
+        if (!freePulses.pop(out))
+        {
+            break;
+        }
+        {
+            Instrumentation::ScopedTimer timer(Instrumentation::Build);
+            out.pulses.clear();
+            for (std::size_t i = 0; i < batch.size && !done; i++)
+            {
+                for (auto iter = batch.histories[i].begin(); iter != batch.histories[i].end(); iter++)
+                {
+                    // only pulses with deposited energy are built
+                    nbPulses += builder.build(*iter, out.pulses);
+                    if (nbPulses >= options.maxPulses)
+                    {
+                        // a particle can make several pulses, drop the extra ones
+                        out.pulses.resize(out.pulses.size() - (nbPulses - options.maxPulses));
+                        done = true;
+                        break;
+                    }
+                }
+            }
+        }
+        out.npsRead = batch.npsRead;
+        out.offset = done ? -1 : batch.offset;
+        freeHistories.push(std::move(batch));
+        if (!pulses.push(std::move(out)))
+        {
+            break;
+        }
+    }
+    // stops the parser if the pulse limit was reached first
+    freeHistories.close();
+    pulses.close();
+}
+
+long PulsePipeline::write()
+{
+    long nbPulses = 0;
+    PulseBatch batch;
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    while (pulses.pop(batch))
+    {
+        {
+            Instrumentation::ScopedTimer timer(Instrumentation::Write);
+            for (auto const &pulse : batch.pulses)
+            {
+                writer.write(pulse);
+            }
+            nbPulses += batch.pulses.size();
+            Instrumentation::add(Instrumentation::Pulses, batch.pulses.size());
+        }
+        if (options.checkpoint && batch.offset >= 0)
+        {
+            const auto now = std::chrono::steady_clock::now();
+            if (std::chrono::duration<double>(now - lastCheckpoint).count() >= options.checkpointInterval)
+            {
+                // every pulse of the histories before offset is in the output
+                Instrumentation::ScopedTimer timer(Instrumentation::Checkpoint);
+                writer.flush();
+                options.checkpoint(PipelineProgress{batch.npsRead, batch.offset, nbPulses});
+                lastCheckpoint = now;
+            }
+        }
+        freePulses.push(std::move(batch));
+    }
+    {
+        // the time sort and the merge of its runs happen here
+        Instrumentation::ScopedTimer timer(Instrumentation::Write);
+        writer.flush();
+    }
+    return nbPulses;
+}
+
+void PulsePipeline::closeAll()
+{
+    histories.close();
+    freeHistories.close();
+    pulses.close();
+    freePulses.close();
+}
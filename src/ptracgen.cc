@@ -0,0 +1,54 @@
+/**
+ * @file ptracgen.cc
+ * @brief Writes a synthetic binary PTRAC file of a given size and event mix
+ * @date 2026-10-17
+ */
+#include <climits>
+#include <string>
+
+#include "ptracwriter.hh"
+int main(int argc, char** argv)
+{
+    // usage: ptracgen out.ptrac [--histories N] [--size MB] [--particles MIN MAX]
+    //                 [--collisions MIN MAX] [--surface FRACTION] [--seed S]
+    std::string outpath;
+    long nbHistories(LONG_MAX);
+    std::size_t size(0);
+    SyntheticMix mix;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--histories" && i + 1 < argc)
+            nbHistories = std::stol(argv[++i]);
+        else if (arg == "--size" && i + 1 < argc)
+            size = static_cast<std::size_t>(std::stod(argv[++i]) * (1 << 20));
+        else if (arg == "--particles" && i + 2 < argc)
+        {
+            mix.minParticles = std::stoi(argv[++i]);
+            mix.maxParticles = std::stoi(argv[++i]);
+        }
+        else if (arg == "--collisions" && i + 2 < argc)
+        {
+            mix.minCollisions = std::stoi(argv[++i]);
+            mix.maxCollisions = std::stoi(argv[++i]);
+        }
+        else if (arg == "--surface" && i + 1 < argc)
+            mix.surfaceFraction = std::stod(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            mix.seed = std::stoul(argv[++i]);
+        else
+            outpath = arg;
+    }
+    if (outpath.empty() || (nbHistories == LONG_MAX && size == 0))
+    {
+        throw std::invalid_argument("Usage: ptracgen out.ptrac [--histories N] [--size MB] "
+                                    "[--particles MIN MAX] [--collisions MIN MAX] "
+                                    "[--surface FRACTION] [--seed S]");
+    }
+    if (size == 0)
+        size = SIZE_MAX;
+
+    const long written = writeSyntheticPTRAC(outpath, nbHistories, size, mix);
+    std::cout << written << " histories written to " << outpath << std::endl;
+    return 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file ptracwriter.cc
+ * @brief Writes synthetic binary PTRAC files for the tests and benchmarks
+ * @date 2026-10-17
+ */
+#include "ptracwriter.hh"
+
+/**********************************************
+*                                             *
+*  methods of the SyntheticPTRACWriter class  *
+*                                             *
+**********************************************/
+
+SyntheticPTRACWriter::SyntheticPTRACWriter(std::string const &path)
+    : SyntheticPTRACWriter(path, std::vector<SyntheticLayout>(NbEventTypes, SyntheticLayout::standard()))
+{
+}
+
+SyntheticPTRACWriter::SyntheticPTRACWriter(std::string const &path, std::vector<SyntheticLayout> const &layouts)
+    : file(path, std::ios::binary | std::ios::trunc), layouts(layouts)
+{
+    if (!file)
+    {
+        throw std::runtime_error("Cannot write " + path);
+    }
+    writeHeader();
+}
+
+void SyntheticPTRACWriter::writeHistory(SyntheticHistory const &history)
+{
+    // NPS line: nps number and type of the first event
+    const long first = history.particles.front().front().eventID;
+    std::string npsLine;
+    append<long>(npsLine, history.nps);
+    append<long>(npsLine, first);
+    writeRecord(npsLine);
+
+    for (std::size_t p = 0; p < history.particles.size(); p++)
+    {
+        SyntheticParticle const &particle = history.particles[p];
+        for (std::size_t e = 0; e < particle.size(); e++)
+        {
+            long next = 9000;
+            if (e + 1 < particle.size())
+                next = particle[e + 1].eventID;
+            else if (p + 1 < history.particles.size())
+                next = history.particles[p + 1].front().eventID;
+            writeDataLine(next, particle[e]);
+        }
+    }
+}
+
+SyntheticHistory SyntheticPTRACWriter::makeHistory(long nps, int nParticles)
+{
+    SyntheticHistory history{nps, {}};
+    for (int p = 0; p < nParticles; p++)
+    {
+        const double t0 = 1.0e6 * nps + 10.0 * p;
+        const double e0 = 1.0 + 0.1 * p;
+        history.particles.push_back({
+            Event{nps, 2030, 602, {1.0 * p, 2.0, 3.0}, e0, 1.0, t0},
+            Event{nps, 4000, 601, {1.5 * p, 2.5, 3.5}, e0 - 0.25, 1.0, t0 + 1.0},
+            Event{nps, 4000, 601, {2.0 * p, 3.0, 4.0}, e0 - 0.5, 1.0, t0 + 2.0},
+            Event{nps, 5000, 603, {2.5 * p, 3.5, 4.5}, 0.001, 1.0, t0 + 3.0}});
+    }
+    return history;
+}
+
+SyntheticHistory SyntheticPTRACWriter::randomHistory(long nps, SyntheticMix const &mix, std::mt19937_64 &generator)
+{
+    std::uniform_int_distribution<int> nbParticles(mix.minParticles, std::max(mix.minParticles, mix.maxParticles));
+    std::uniform_int_distribution<int> nbSteps(mix.minCollisions, std::max(mix.minCollisions, mix.maxCollisions));
+    std::uniform_real_distribution<double> uniform(0, 1);
+
+    SyntheticHistory history{nps, {}};
+    const int n = nbParticles(generator);
+    for (int p = 0; p < n; p++)
+    {
+        double t = 1.0e6 * nps + 10.0 * p;
+        double e = 0.5 + 10 * uniform(generator);
+        std::array<double, 3> pos = {20 * uniform(generator), 20 * uniform(generator), 20 * uniform(generator)};
+        SyntheticParticle particle;
+        particle.push_back(Event{nps, 2030, mix.detectorCell + 1, pos, e, 1.0, t});
+        const int steps = nbSteps(generator);
+        for (int s = 0; s < steps; s++)
+        {
+            for (auto &coordinate : pos)
+                coordinate += uniform(generator) - 0.5;
+            t += uniform(generator);
+            const bool surface = uniform(generator) < mix.surfaceFraction;
+            if (!surface)
+                e *= uniform(generator);
+            particle.push_back(Event{nps, surface ? 3000 : 4000, mix.detectorCell, pos, e, 1.0, t});
+        }
+        particle.push_back(Event{nps, 5000, mix.detectorCell + 2, pos, 0.001, 1.0, t + 1});
+        history.particles.push_back(std::move(particle));
+    }
+    return history;
+}
+
+void SyntheticPTRACWriter::writeRecord(std::string const &payload)
+{
+    const int32_t length = static_cast<int32_t>(payload.size());
+    file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    file.write(payload.data(), payload.size());
+    file.write(reinterpret_cast<const char *>(&length), sizeof(length));
+}
+
+void SyntheticPTRACWriter::writeHeader()
+{
+    std::string buffer;
+    append<int32_t>(buffer, -1);
+    writeRecord(buffer); // header
+    writeRecord(std::string("mcnp    6.2     01/01/26 00:00:00 ")); // code, version, dates
+    writeRecord(std::string("synthetic ptrac")); // calculation title
+
+    // ptrac input data: one keyword with two values
+    buffer.clear();
+    append<double>(buffer, 1);
+    append<double>(buffer, 2);
+    append<double>(buffer, 1);
+    append<double>(buffer, 2);
+    writeRecord(buffer);
+
+    // line 6: number of variables on each line
+    buffer.clear();
+    append<int32_t>(buffer, nbDataNPS);
+    for (auto const &layout : layouts)
+    {
+        append<long>(buffer, layout.longIDs.size());
+        append<long>(buffer, layout.doubleIDs.size());
+    }
+    writeRecord(buffer);
+
+    // line 7: variable ids, longs on the NPS line and ints on the event lines
+    buffer.clear();
+    append<long>(buffer, 1); // nps
+    append<long>(buffer, 2); // type of first event
+    for (auto const &layout : layouts)
+    {
+        for (auto id : layout.longIDs)
+            append<int32_t>(buffer, id);
+        for (auto id : layout.doubleIDs)
+            append<int32_t>(buffer, id);
+    }
+    writeRecord(buffer);
+}
+
+double SyntheticPTRACWriter::fieldValue(int32_t id, long next, Event const &event)
+{
+    switch (id)
+    {
+    case 7: return next;
+    case 17: return event.cellID;
+    case 20: return event.pos[0];
+    case 21: return event.pos[1];
+    case 22: return event.pos[2];
+    case 25: return 1;
+    case 26: return event.energy;
+    case 27: return event.weight;
+    case 28: return event.time;
+    default: return 0;
+    }
+}
+
+void SyntheticPTRACWriter::writeDataLine(long next, Event const &event)
+{
+    std::string buffer;
+    // all doubles, even though the first group are actually longs
+    SyntheticLayout const &layout = layouts[eventType(event.eventID)];
+    for (auto id : layout.longIDs)
+        append<double>(buffer, fieldValue(id, next, event));
+    for (auto id : layout.doubleIDs)
+        append<double>(buffer, fieldValue(id, next, event));
+    writeRecord(buffer);
+}
+
+long writeSyntheticPTRAC(std::string const &path, long nbHistories, std::size_t size,
+                         SyntheticMix const &mix, std::vector<SyntheticLayout> const &layouts)
+{
+    SyntheticPTRACWriter writer(path, layouts);
+    std::mt19937_64 generator(mix.seed);
+    long nps = 0;
+    while (nps < nbHistories && writer.size() < size)
+    {
+        writer.writeHistory(SyntheticPTRACWriter::randomHistory(++nps, mix, generator));
+    }
+    writer.close();
+    return nps;
+}
@@ -11,26 +11,27 @@ Pulse::Pulse(const ParticleHistory& parHist)
 {
     energy = 0;
     pos = std::vector<double>(3, 0);
-    for (auto iter = parHist.begin(); iter != parHist.end(); iter++)
+    const NPSHistory& events = parHist.events();
+    for (std::size_t i = parHist.first(); i < parHist.last(); i++)
     {
-        if (iter->cellID == 601 && iter->eventID != 5000)
+        if (events.cellID[i] == defaultDetectorCell && events.eventID[i] != 5000)
         {
             if (energy == 0)
             {
                 // first event in detector cell
-                nps = iter->nps;
-                startPos = iter->pos;
-                time = iter->time;
+                nps = events.nps[i];
+                startPos = {events.x[i], events.y[i], events.z[i]};
+                time = events.time[i];
             }
-            auto nextit = std::next(iter, 1);
-            if (nextit != parHist.end())
+            const std::size_t next = i + 1;
+            if (next != parHist.last())
             {
-                endPos = nextit->pos;
-                energy += iter->energy - nextit->energy;
+                endPos = {events.x[next], events.y[next], events.z[next]};
+                energy += events.energy[i] - events.energy[next];
             }
             else
             {
-                std::cout << "Record " << iter->nps << " does not end with eventID 5000.\n";
+                Diagnostics::record(Diagnostics::MissingTermination, events.eventID[i], events.nps[i]);
             }
         }
     }
@@ -0,0 +1,53 @@
+/**
+ * @file pulse2txt.cc
+ * @brief Converts a binary pulse file to the pulses.txt layout
+ * @date 2026-10-17
+ */
+#include <fstream>
+#include <string>
+
+#include "pulseio.hh"
+int main(int argc, char** argv)
+{
+    // usage: pulse2txt pulses.bin [pulses.txt] [--cells]
+    std::vector<std::string> paths;
+    bool writeCell(false);
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg(argv[i]);
+        if (arg == "--cells")
+            writeCell = true;
+        else
+            paths.push_back(arg);
+    }
+    if (paths.empty())
+    {
+        throw std::invalid_argument("Usage: pulse2txt pulses.bin [pulses.txt] [--cells]");
+    }
+    const std::string inpath(paths[0]);
+    const std::string outpath(paths.size() > 1 ? paths[1] : "pulses.txt");
+
+    std::ifstream infile(inpath, std::ios::in | std::ios::binary);
+    if (!infile.good())
+    {
+        throw std::invalid_argument("Cannot open file: " + inpath);
+    }
+    std::ofstream outfile(outpath, std::ios::out);
+    if (!outfile.good())
+    {
+        throw std::invalid_argument("Cannot create file: " + outpath);
+    }
+
+    BinaryPulseReader reader(infile);
+    TextPulseWriter writer(outfile, true, 16 << 20, writeCell);
+    Pulse pulse;
+    long pulseNum(0);
+    while (reader.read(pulse))
+    {
+        writer.write(pulse);
+        pulseNum++;
+    }
+    writer.flush();
+    std::cout << pulseNum << " pulses written to " << outpath << std::endl;
+    return 0;
+}
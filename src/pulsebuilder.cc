@@ -0,0 +1,171 @@
+/**
+ * @file pulsebuilder.cc
+ * @brief Pulses of a particle in any number of detector cells
+ * @date 2026-10-17
+ */
+#include "pulsebuilder.hh"
+#include <algorithm>
+#include <stdexcept>
+
+/***************************************
+*                                      *
+*  methods of the DetectorCells class  *
+*                                      *
+***************************************/
+
+DetectorCells::DetectorCells(std::vector<long> const& cells) : cells(cells)
+{
+    std::sort(this->cells.begin(), this->cells.end());
+    this->cells.erase(std::unique(this->cells.begin(), this->cells.end()), this->cells.end());
+    if (this->cells.empty())
+    {
+        throw std::invalid_argument("no detector cells");
+    }
+    minCell = this->cells.front();
+    const long span = this->cells.back() - minCell + 1;
+    if (span > maxSpan)
+    {
+        throw std::invalid_argument("detector cells " + std::to_string(minCell) + " to " +
+                                    std::to_string(this->cells.back()) + " are too far apart");
+    }
+    table.assign(span, -1);
+    for (std::size_t i = 0; i < this->cells.size(); i++)
+    {
+        table[this->cells[i] - minCell] = static_cast<int32_t>(i);
+    }
+}
+
+/*************************************
+*                                    *
+*  methods of the CellDeposit class  *
+*                                    *
+*************************************/
+
+Pulse CellDeposit::toPulse(long cell) const
+{
+    Pulse pulse;
+    pulse.nps = nps;
+    pulse.startPos.assign(startPos.begin(), startPos.end());
+    pulse.endPos.assign(endPos.begin(), endPos.end());
+    pulse.pos = {(startPos[0] + endPos[0]) * 0.5,
+                 (startPos[1] + endPos[1]) * 0.5,
+                 (startPos[2] + endPos[2]) * 0.5};
+    pulse.time = time;
+    pulse.energy = energy;
+    pulse.cellID = cell;
+    return pulse;
+}
+
+/**************************************
+*                                     *
+*  methods of the PulseBuilder class  *
+*                                     *
+**************************************/
+
+PulseBuilder::PulseBuilder(DetectorCells const& cells)
+    : cells(cells), deposits(cells.size(), CellDeposit::none())
+{
+}
+
+std::size_t PulseBuilder::build(const ParticleHistory& parHist, std::vector<Pulse>& pulses)
+{
+    const NPSHistory& events = parHist.events();
+    const std::size_t last = parHist.last();
+    for (std::size_t i = parHist.first(); i < last; i++)
+    {
+        const int cell = cells.index(events.cellID[i]);
+        if (cell < 0 || events.eventID[i] == 5000)
+        {
+            continue;
+        }
+        CellDeposit& deposit = deposits[cell];
+        if (!deposit.touched)
+        {
+            deposit.touched = true;
+            touched.push_back(cell);
+        }
+        if (deposit.energy == 0)
+        {
+            // first event in this detector cell
+            deposit.nps = events.nps[i];
+            deposit.startPos = {events.x[i], events.y[i], events.z[i]};
+            deposit.time = events.time[i];
+        }
+        const std::size_t next = i + 1;
+        if (next != last)
+        {
+            deposit.endPos = {events.x[next], events.y[next], events.z[next]};
+            deposit.energy += events.energy[i] - events.energy[next];
+        }
+        else
+        {
+            Diagnostics::record(Diagnostics::MissingTermination, events.eventID[i], events.nps[i]);
+        }
+    }
+
+    std::size_t nbPulses = 0;
+    for (int cell : touched)
+    {
+        CellDeposit& deposit = deposits[cell];
+        if (deposit.energy > 0)
+        {
+            pulses.push_back(deposit.toPulse(cells[cell]));
+            nbPulses++;
+        }
+        deposit = CellDeposit::none();
+    }
+    touched.clear();
+    return nbPulses;
+}
+
+/**************************************
+*                                     *
+*  methods of the PulseVisitor class  *
+*                                     *
+**************************************/
+
+PulseVisitor::PulseVisitor(DetectorCells const& cells, PulseWriter& out)
+    : cells(cells), out(out), deposits(cells.size(), CellDeposit::none()), pending(-1),
+      pendingEnergy(0), pendingNPS(0), pendingEventID(0), nbPulses(0)
+{
+}
+
+void PulseVisitor::onParticleEnd()
+{
+    if (pending >= 0)
+    {
+        Diagnostics::record(Diagnostics::MissingTermination, pendingEventID, pendingNPS);
+        pending = -1;
+    }
+    for (int cell : touched)
+    {
+        CellDeposit& deposit = deposits[cell];
+        if (deposit.energy > 0)
+        {
+            historyPulses.push_back(deposit.toPulse(cells[cell]));
+        }
+        deposit = CellDeposit::none();
+    }
+    touched.clear();
+}
+
+void PulseVisitor::onHistoryEnd(long /*nps*/)
+{
+    for (Pulse const& pulse : historyPulses)
+    {
+        out.write(pulse);
+    }
+    nbPulses += historyPulses.size();
+    historyPulses.clear();
+}
+
+void PulseVisitor::onHistoryAbort(long /*nps*/)
+{
+    for (int cell : touched)
+    {
+        deposits[cell] = CellDeposit::none();
+    }
+    touched.clear();
+    pending = -1;
+    historyPulses.clear();
+}
@@ -0,0 +1,330 @@
+/**
+ * @file pulseio.cc
+ * @brief Text and binary pulse file writers, and the binary pulse reader
+ * @date 2026-10-17
+ */
+#include "pulseio.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <stdexcept>
+
+namespace
+{
+const char pulseMagic[8] = {'P', 'T', 'R', 'P', 'U', 'L', 'S', 'E'};
+const uint32_t pulseVersion = 1;
+
+struct ColumnInfo
+{
+    const char* name;
+    char type;
+};
+const ColumnInfo pulseColumns[] = {{"x1", 'd'}, {"y1", 'd'}, {"z1", 'd'},
+                                   {"x2", 'd'}, {"y2", 'd'}, {"z2", 'd'},
+                                   {"energy", 'd'}, {"time", 'd'}, {"nps", 'q'},
+                                   {"cell", 'q'}};
+constexpr std::size_t nbColumns = sizeof(pulseColumns) / sizeof(ColumnInfo);
+constexpr std::size_t nbDoubleColumns = 8;
+constexpr std::size_t fieldSize = 8;
+constexpr std::size_t rowSize = nbColumns * fieldSize;
+// a block is read this many bytes at a time, so that its memory follows the
+// bytes actually in the file and not the count at its start
+constexpr std::size_t readChunkSize = std::size_t(1) << 20;
+
+bool hostIsLittleEndian()
+{
+    const uint16_t one = 1;
+    char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+/// copies the fields of a pulse, in column order
+void storeFields(const Pulse& p, char* fields[nbColumns])
+{
+    const double doubles[] = {p.startPos[0], p.startPos[1], p.startPos[2],
+                              p.endPos[0], p.endPos[1], p.endPos[2],
+                              p.energy, p.time};
+    for (std::size_t c = 0; c < nbDoubleColumns; c++)
+    {
+        std::memcpy(fields[c], &doubles[c], fieldSize);
+    }
+    const int64_t integers[] = {p.nps, p.cellID};
+    for (std::size_t c = nbDoubleColumns; c < nbColumns; c++)
+    {
+        std::memcpy(fields[c], &integers[c - nbDoubleColumns], fieldSize);
+    }
+}
+
+/// reads the fields of a pulse, in column order
+void loadFields(Pulse& p, const char* fields[nbColumns])
+{
+    double doubles[nbDoubleColumns];
+    for (std::size_t c = 0; c < nbDoubleColumns; c++)
+    {
+        std::memcpy(&doubles[c], fields[c], fieldSize);
+    }
+    int64_t nps, cell;
+    std::memcpy(&nps, fields[nbDoubleColumns], fieldSize);
+    std::memcpy(&cell, fields[nbDoubleColumns + 1], fieldSize);
+    p.startPos = {doubles[0], doubles[1], doubles[2]};
+    p.endPos = {doubles[3], doubles[4], doubles[5]};
+    p.pos = {(doubles[0] + doubles[3]) * 0.5, (doubles[1] + doubles[4]) * 0.5, (doubles[2] + doubles[5]) * 0.5};
+    p.energy = doubles[6];
+    p.time = doubles[7];
+    p.nps = nps;
+    p.cellID = cell;
+}
+
+template <typename T>
+void writeValue(std::ostream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+T readValue(std::istream& is)
+{
+    T value;
+    is.read(reinterpret_cast<char*>(&value), sizeof(T));
+    if (!is)
+    {
+        throw std::runtime_error("truncated pulse file");
+    }
+    return value;
+}
+} // namespace
+
+/*****************************************
+*                                        *
+*  methods of the TextPulseWriter class  *
+*                                        *
+*****************************************/
+
+const char* TextPulseWriter::header = "#    x1(cm)      y1(cm)      z1(cm)      x2(cm)      y2(cm)      z2(cm)    energy(MeV)        time(shakes)           nps\n";
+
+TextPulseWriter::TextPulseWriter(std::ostream& os, bool writeHeader, std::size_t bufferSize, bool writeCell)
+    : os(os), bufferSize(bufferSize), writeCell(writeCell)
+{
+    if (writeHeader)
+    {
+        text = header;
+        if (writeCell)
+        {
+            text.back() = ' ';
+            text += "      cell\n";
+        }
+    }
+}
+
+void TextPulseWriter::write(const Pulse& p)
+{
+    line.str("");
+    line << p;
+    if (writeCell)
+    {
+        line << std::setw(10) << p.cellID;
+    }
+    line << '\n';
+    text += line.str();
+    if (text.size() >= bufferSize)
+    {
+        flush();
+    }
+}
+
+void TextPulseWriter::flush()
+{
+    os.write(text.data(), text.size());
+    os.flush();
+    text.clear();
+    if (!os)
+    {
+        throw std::runtime_error("Cannot write pulses");
+    }
+}
+
+/*******************************************
+*                                          *
+*  methods of the BinaryPulseWriter class  *
+*                                          *
+*******************************************/
+
+BinaryPulseWriter::BinaryPulseWriter(std::ostream& os, PulseLayout layout, std::size_t blockSize,
+                                     bool writeHeader)
+    : os(os), layout(layout), blockSize(std::max<std::size_t>(1, blockSize)), nbPulses(0),
+      block(this->blockSize * rowSize)
+{
+    if (!hostIsLittleEndian())
+    {
+        throw std::runtime_error("binary pulse files are only written on little-endian hosts");
+    }
+    if (!writeHeader)
+    {
+        return;
+    }
+    os.write(pulseMagic, sizeof(pulseMagic));
+    writeValue<uint32_t>(os, pulseVersion);
+    writeValue<uint32_t>(os, static_cast<uint32_t>(layout));
+    writeValue<uint32_t>(os, nbColumns);
+    writeValue<uint32_t>(os, rowSize);
+    for (auto const& column : pulseColumns)
+    {
+        char description[24] = {0};
+        std::strncpy(description, column.name, 15);
+        description[16] = column.type;
+        os.write(description, sizeof(description));
+    }
+}
+
+void BinaryPulseWriter::write(const Pulse& p)
+{
+    char* fields[nbColumns];
+    for (std::size_t c = 0; c < nbColumns; c++)
+    {
+        fields[c] = layout == PulseLayout::RowMajor
+                        ? &block[nbPulses * rowSize + c * fieldSize]
+                        : &block[(c * blockSize + nbPulses) * fieldSize];
+    }
+    storeFields(p, fields);
+    if (++nbPulses == blockSize)
+    {
+        flush();
+    }
+}
+
+void BinaryPulseWriter::flush()
+{
+    if (nbPulses > 0)
+    {
+        writeValue<uint64_t>(os, nbPulses);
+        if (layout == PulseLayout::RowMajor)
+        {
+            os.write(block.data(), nbPulses * rowSize);
+        }
+        else
+        {
+            for (std::size_t c = 0; c < nbColumns; c++)
+            {
+                os.write(&block[c * blockSize * fieldSize], nbPulses * fieldSize);
+            }
+        }
+        nbPulses = 0;
+    }
+    os.flush();
+    if (!os)
+    {
+        throw std::runtime_error("Cannot write pulses");
+    }
+}
+
+/*******************************************
+*                                          *
+*  methods of the ColumnPulseWriter class  *
+*                                          *
+********************************************/
+
+void ColumnPulseWriter::write(const Pulse& p)
+{
+    startPos.insert(startPos.end(), p.startPos.begin(), p.startPos.end());
+    endPos.insert(endPos.end(), p.endPos.begin(), p.endPos.end());
+    energy.push_back(p.energy);
+    time.push_back(p.time);
+    nps.push_back(p.nps);
+    cellID.push_back(p.cellID);
+}
+
+void ColumnPulseWriter::clear()
+{
+    for (auto column : {&startPos, &endPos, &energy, &time})
+        column->clear();
+    nps.clear();
+    cellID.clear();
+}
+
+/*******************************************
+*                                          *
+*  methods of the BinaryPulseReader class  *
+*                                          *
+*******************************************/
+
+BinaryPulseReader::BinaryPulseReader(std::istream& is) : is(is), nbPulses(0), next(0)
+{
+    if (!hostIsLittleEndian())
+    {
+        throw std::runtime_error("binary pulse files are only read on little-endian hosts");
+    }
+    char magic[sizeof(pulseMagic)];
+    is.read(magic, sizeof(magic));
+    if (!is || std::memcmp(magic, pulseMagic, sizeof(magic)) != 0)
+    {
+        throw std::runtime_error("not a binary pulse file");
+    }
+    if (readValue<uint32_t>(is) != pulseVersion)
+    {
+        throw std::runtime_error("unsupported binary pulse file version");
+    }
+    const uint32_t layoutCode = readValue<uint32_t>(is);
+    if (layoutCode > static_cast<uint32_t>(PulseLayout::ColumnMajor))
+    {
+        throw std::runtime_error("unknown binary pulse file layout");
+    }
+    layout = static_cast<PulseLayout>(layoutCode);
+    if (readValue<uint32_t>(is) != nbColumns || readValue<uint32_t>(is) != rowSize)
+    {
+        throw std::runtime_error("unexpected columns in binary pulse file");
+    }
+    for (auto const& column : pulseColumns)
+    {
+        char description[24];
+        is.read(description, sizeof(description));
+        if (!is || std::strncmp(description, column.name, 16) != 0 || description[16] != column.type)
+        {
+            throw std::runtime_error("unexpected columns in binary pulse file");
+        }
+    }
+}
+
+bool BinaryPulseReader::read(Pulse& p)
+{
+    if (next == nbPulses)
+    {
+        uint64_t count;
+        if (!is.read(reinterpret_cast<char*>(&count), sizeof(count)))
+        {
+            return false;
+        }
+        if (count > SIZE_MAX / rowSize)
+        {
+            throw std::runtime_error("malformed pulse file: block of " + std::to_string(count) + " pulses");
+        }
+        const std::size_t size = static_cast<std::size_t>(count) * rowSize;
+        block.clear();
+        while (block.size() < size)
+        {
+            const std::size_t done = block.size();
+            block.resize(done + std::min(size - done, readChunkSize));
+            if (!is.read(&block[done], block.size() - done))
+            {
+                throw std::runtime_error("truncated pulse file");
+            }
+        }
+        nbPulses = count;
+        next = 0;
+        if (count == 0)
+        {
+            return read(p);
+        }
+    }
+    const char* fields[nbColumns];
+    for (std::size_t c = 0; c < nbColumns; c++)
+    {
+        fields[c] = layout == PulseLayout::RowMajor
+                        ? &block[next * rowSize + c * fieldSize]
+                        : &block[(c * nbPulses + next) * fieldSize];
+    }
+    loadFields(p, fields);
+    ++next;
+    return true;
+}
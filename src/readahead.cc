@@ -0,0 +1,255 @@
+/**
+ * @file readahead.cc
+ * @brief Stream buffer that reads a file in large blocks ahead of the decoder
+ * @date 2026-10-17
+ */
+#include "readahead.hh"
+#include "instrumentation.hh"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <unistd.h>
+
+/*****************************************
+*                                        *
+*  methods of the ReadAheadBuffer class  *
+*                                        *
+*****************************************/
+
+ReadAheadBuffer::ReadAheadBuffer(std::string const &path, ReadAheadOptions const &options)
+    : path(path), fd(-1), source(nullptr), direct(false),
+      blockSize((std::max<std::size_t>(options.blockSize, 1) + alignment - 1) / alignment * alignment),
+      current(-1), stopping(false)
+{
+#ifdef O_DIRECT
+    if (options.direct)
+    {
+        fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+        direct = fd >= 0;
+    }
+#endif
+    if (fd < 0)
+    {
+        fd = open(path.c_str(), O_RDONLY);
+    }
+    if (fd < 0)
+    {
+        return;
+    }
+    if (!direct)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    start();
+}
+
+ReadAheadBuffer::ReadAheadBuffer(std::streambuf &source, ReadAheadOptions const &options)
+    : fd(-1), source(&source), direct(false),
+      blockSize((std::max<std::size_t>(options.blockSize, 1) + alignment - 1) / alignment * alignment),
+      current(-1), stopping(false)
+{
+    start();
+}
+
+void ReadAheadBuffer::start()
+{
+    for (auto &block : blocks)
+    {
+        void *data = nullptr;
+        if (posix_memalign(&data, alignment, blockSize) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        block.data = static_cast<char *>(data);
+    }
+    reader = std::thread([this] { readBlocks(); });
+}
+
+ReadAheadBuffer::~ReadAheadBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    emptied.notify_all();
+    if (reader.joinable())
+    {
+        reader.join();
+    }
+    for (auto &block : blocks)
+    {
+        std::free(block.data);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+ReadAheadBuffer::int_type ReadAheadBuffer::underflow()
+{
+    if (gptr() < egptr())
+    {
+        return traits_type::to_int_type(*gptr());
+    }
+    if (!is_open())
+    {
+        return traits_type::eof();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    if (current >= 0)
+    {
+        Block &done = blocks[current];
+        if (done.size < blockSize)
+        {
+            // a short block is the end of the file, or where a read failed
+            return fail();
+        }
+        done.full = false;
+        emptied.notify_one();
+    }
+    current = (current + 1) % nbBlocks;
+    Block &next = blocks[current];
+    {
+        Instrumentation::ScopedTimer timer(Instrumentation::ReadWait);
+        filled.wait(lock, [&next] { return next.full; });
+    }
+    setg(next.data, next.data, next.data + next.size);
+    if (next.size == 0)
+    {
+        return fail();
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+ReadAheadBuffer::int_type ReadAheadBuffer::fail()
+{
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return traits_type::eof();
+}
+
+std::size_t ReadAheadBuffer::peek(char *bytes, std::size_t n)
+{
+    if (sgetc() == traits_type::eof())
+    {
+        return 0;
+    }
+    n = std::min<std::size_t>(n, egptr() - gptr());
+    std::memcpy(bytes, gptr(), n);
+    return n;
+}
+
+void ReadAheadBuffer::readBlocks()
+{
+    off_t offset = 0;
+    for (int i = 0;; i = (i + 1) % nbBlocks)
+    {
+        Block &block = blocks[i];
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            emptied.wait(lock, [this, &block] { return stopping || !block.full; });
+            if (stopping)
+            {
+                return;
+            }
+        }
+        // the block is ours until it is marked full
+        std::size_t size = 0;
+        std::exception_ptr status;
+        try
+        {
+            size = fill(block.data, offset);
+        }
+        catch (...)
+        {
+            status = std::current_exception();
+        }
+        offset += size;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            block.size = size;
+            block.full = true;
+            error = status;
+        }
+        filled.notify_one();
+        if (size < blockSize)
+        {
+            // end of file or error, the stream stops at this block
+            return;
+        }
+    }
+}
+
+std::size_t ReadAheadBuffer::fill(char *data, off_t offset)
+{
+    Instrumentation::ScopedTimer timer(Instrumentation::Read);
+    if (source != nullptr)
+    {
+        std::size_t size = 0;
+        while (size < blockSize)
+        {
+            const std::streamsize n = source->sgetn(data + size, blockSize - size);
+            if (n <= 0)
+            {
+                break;
+            }
+            size += n;
+        }
+        return size;
+    }
+    std::size_t size = 0;
+    while (size < blockSize)
+    {
+        const ssize_t n = pread(fd, data + size, blockSize - size, offset + size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        // some file systems accept O_DIRECT when opening but not when reading
+        if (n < 0 && errno == EINVAL && direct && reopenBuffered())
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            throw std::runtime_error(std::string("Cannot read file: ") + std::strerror(errno));
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        size += n;
+        if (direct && size % alignment != 0)
+        {
+            // the next O_DIRECT read would not be aligned, and a short
+            // read of a regular file only happens at its end anyway
+            break;
+        }
+    }
+    return size;
+}
+
+bool ReadAheadBuffer::reopenBuffered()
+{
+    const int buffered = open(path.c_str(), O_RDONLY);
+    if (buffered < 0)
+    {
+        return false;
+    }
+    // keeps the descriptor number, which the consumer may be reading
+    const bool replaced = dup2(buffered, fd) >= 0;
+    close(buffered);
+    if (replaced)
+    {
+        direct = false;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    return replaced;
+}
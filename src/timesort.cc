@@ -0,0 +1,216 @@
+/**
+ * @file timesort.cc
+ * @brief Time-sorted pulse trains: external merge sort and source timeline
+ * @date 2026-10-17
+ */
+#include "timesort.hh"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unistd.h>
+
+/****************************************
+*                                       *
+*  methods of the SourceTimeline class  *
+*                                       *
+****************************************/
+
+SourceTimeline::SourceTimeline(double rate, unsigned long seed)
+    : meanGap(shakesPerSecond / rate), generator(seed), lastNPS(0), lastOffset(0)
+{
+    if (!(rate > 0))
+    {
+        throw std::invalid_argument("source rate must be positive");
+    }
+}
+
+double SourceTimeline::offset(long nps)
+{
+    if (nps < lastNPS)
+    {
+        throw std::logic_error("histories must arrive in increasing NPS order");
+    }
+    if (nps > lastNPS)
+    {
+        // the sum of nps - lastNPS exponential gaps
+        std::gamma_distribution<double> gaps(static_cast<double>(nps - lastNPS), meanGap);
+        lastOffset += gaps(generator);
+        lastNPS = nps;
+    }
+    return lastOffset;
+}
+
+/******************************************
+*                                         *
+*  methods of the TimeOffsetWriter class  *
+*                                         *
+******************************************/
+
+TimeOffsetWriter::TimeOffsetWriter(PulseWriter& out, SourceTimeline const& timeline)
+    : out(out), timeline(timeline)
+{
+}
+
+void TimeOffsetWriter::write(const Pulse& p)
+{
+    Pulse shifted(p);
+    shifted.time += timeline.offset(p.nps);
+    out.write(shifted);
+}
+
+void TimeOffsetWriter::flush()
+{
+    out.flush();
+}
+
+/*******************************************
+*                                          *
+*  methods of the TimeSortingWriter class  *
+*                                          *
+*******************************************/
+
+TimeSortingWriter::TimeSortingWriter(PulseWriter& out, TimeSortOptions const& options)
+    : out(out), options(options),
+      maxRecords(std::max<std::size_t>(1, options.memoryBudget / sizeof(Record))), nbRuns(0)
+{
+    // the whole budget up front, so that growing the vector never doubles
+    // it past the budget; clear() keeps the capacity between the runs
+    records.reserve(maxRecords);
+}
+
+TimeSortingWriter::~TimeSortingWriter()
+{
+    removeRuns();
+}
+
+void TimeSortingWriter::write(const Pulse& p)
+{
+    records.push_back(Record{{p.startPos[0], p.startPos[1], p.startPos[2]},
+                             {p.endPos[0], p.endPos[1], p.endPos[2]},
+                             p.energy, p.time, p.nps, p.cellID});
+    if (records.size() >= maxRecords)
+    {
+        spillRun();
+    }
+}
+
+void TimeSortingWriter::flush()
+{
+    if (runs.empty())
+    {
+        // everything fit in memory
+        sortRecords();
+        for (auto const& record : records)
+        {
+            out.write(toPulse(record));
+        }
+        records.clear();
+    }
+    else
+    {
+        if (!records.empty())
+        {
+            spillRun();
+        }
+        mergeRuns();
+    }
+    out.flush();
+}
+
+Pulse TimeSortingWriter::toPulse(Record const& record)
+{
+    Pulse p;
+    p.startPos.assign(record.startPos, record.startPos + 3);
+    p.endPos.assign(record.endPos, record.endPos + 3);
+    p.pos = {(record.startPos[0] + record.endPos[0]) * 0.5,
+             (record.startPos[1] + record.endPos[1]) * 0.5,
+             (record.startPos[2] + record.endPos[2]) * 0.5};
+    p.energy = record.energy;
+    p.time = record.time;
+    p.nps = record.nps;
+    p.cellID = record.cellID;
+    return p;
+}
+
+void TimeSortingWriter::sortRecords()
+{
+    std::stable_sort(records.begin(), records.end(),
+                     [](Record const& a, Record const& b) { return a.time < b.time; });
+}
+
+void TimeSortingWriter::spillRun()
+{
+    sortRecords();
+    const std::string path = options.runDirectory + "/pulses." + std::to_string(getpid()) + "." +
+                             std::to_string(reinterpret_cast<std::uintptr_t>(this)) + ".run" +
+                             std::to_string(nbRuns);
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.good())
+    {
+        throw std::runtime_error("Cannot create sorted run: " + path);
+    }
+    runs.push_back(path);
+    nbRuns++;
+    BinaryPulseWriter writer(file, PulseLayout::RowMajor);
+    for (auto const& record : records)
+    {
+        writer.write(toPulse(record));
+    }
+    writer.flush();
+    records.clear();
+}
+
+void TimeSortingWriter::mergeRuns()
+{
+    const std::size_t k = runs.size();
+    std::vector<std::unique_ptr<std::ifstream>> files;
+    std::vector<std::unique_ptr<BinaryPulseReader>> readers;
+    std::vector<Pulse> heads(k);
+    for (auto const& path : runs)
+    {
+        files.emplace_back(new std::ifstream(path, std::ios::in | std::ios::binary));
+        if (!files.back()->good())
+        {
+            throw std::runtime_error("Cannot open sorted run: " + path);
+        }
+        readers.emplace_back(new BinaryPulseReader(*files.back()));
+    }
+
+    // earliest head first, the earlier run first for equal times so that
+    // the merge is stable
+    typedef std::pair<double, std::size_t> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (std::size_t run = 0; run < k; run++)
+    {
+        if (readers[run]->read(heads[run]))
+        {
+            queue.push(Entry(heads[run].time, run));
+        }
+    }
+    while (!queue.empty())
+    {
+        const std::size_t run = queue.top().second;
+        queue.pop();
+        out.write(heads[run]);
+        if (readers[run]->read(heads[run]))
+        {
+            queue.push(Entry(heads[run].time, run));
+        }
+    }
+    readers.clear();
+    files.clear();
+    removeRuns();
+}
+
+void TimeSortingWriter::removeRuns()
+{
+    for (auto const& path : runs)
+    {
+        std::remove(path.c_str());
+    }
+    runs.clear();
+}
@@ -0,0 +1,127 @@
+/**
+* @file allocation_test.cc
+*
+*
+* @brief Test that steady-state parsing makes no heap allocations
+*
+* @version 1.1
+*/
+#include "allocationcounter.hh"
+#include "parallelparser.hh"
+#include "ptracwriter.hh"
+#include "timesort.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <thread>
+
+class AllocationTest : public ::testing::Test
+{
+public:
+  const std::string path = "allocation_test.ptrac";
+  const long nbHistories = 2000;
+
+  void SetUp()
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3));
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+
+  /// allocations made on any thread, the reader's own included, while
+  /// reading the histories after the first warmUp ones, which size the buffers
+  template <typename Reader>
+  uint64_t steadyStateAllocations(Reader &ptrac, long warmUp = 10)
+  {
+    for (long i = 0; i < warmUp; i++)
+    {
+      EXPECT_TRUE(ptrac.readNextNPS(1e9));
+    }
+    const uint64_t before = AllocationCounter::count();
+    long nbEvents = 0;
+    while (ptrac.readNextNPS(1e9))
+    {
+      nbEvents += ptrac.getNPSHistory().nbEvents();
+    }
+    const uint64_t after = AllocationCounter::count();
+    EXPECT_EQ(ptrac.getNPSRead(), nbHistories);
+    EXPECT_GT(nbEvents, 0);
+    return after - before;
+  }
+};
+
+TEST_F(AllocationTest, CounterCounts)
+{
+  const uint64_t before = AllocationCounter::count();
+  const uint64_t threadBefore = AllocationCounter::threadCount();
+  std::unique_ptr<int> p(new int(1));
+  EXPECT_EQ(AllocationCounter::count() - before, 1);
+  EXPECT_EQ(AllocationCounter::threadCount() - threadBefore, 1);
+
+  // the allocation of the worker is in count() only
+  const uint64_t beforeWorker = AllocationCounter::count();
+  const uint64_t threadBeforeWorker = AllocationCounter::threadCount();
+  std::thread worker([] { std::unique_ptr<int> q(new int(2)); });
+  worker.join();
+  EXPECT_GT(AllocationCounter::count() - beforeWorker,
+            AllocationCounter::threadCount() - threadBeforeWorker);
+}
+
+TEST_F(AllocationTest, BinaryReader)
+{
+  MCNPPTRACBinary ptrac(path);
+  EXPECT_EQ(steadyStateAllocations(ptrac), 0);
+}
+
+TEST_F(AllocationTest, MmapReader)
+{
+  MCNPPTRACMmap ptrac(path);
+  EXPECT_EQ(steadyStateAllocations(ptrac), 0);
+}
+
+TEST_F(AllocationTest, ParallelReader)
+{
+  // the workers decode into the histories of the batches, which are
+  // swapped with the history of the reader instead of copied, so every
+  // buffer has grown once both batches went through the reader
+  const std::size_t batchSize = 64;
+  MCNPPTRACParallel ptrac(path, 2, batchSize);
+  for (std::size_t i = 0; i < 2 * batchSize; i++)
+  {
+    EXPECT_TRUE(ptrac.readNextNPS(1e9));
+  }
+  const uint64_t allocations = steadyStateAllocations(ptrac, 0);
+  // only the scheduling of the decoding tasks allocates, a few per batch
+  EXPECT_LT(allocations, nbHistories / 4);
+}
+
+TEST_F(AllocationTest, TimeSortingWriterReservesItsBudget)
+{
+  // the pulses of a run go into the buffer reserved by the constructor,
+  // which never grows past the memory budget
+  struct NullWriter : public PulseWriter
+  {
+    void write(const Pulse &) {}
+    void flush() {}
+  } out;
+  TimeSortOptions options;
+  options.memoryBudget = 1000 * 80;
+  TimeSortingWriter writer(out, options);
+  Pulse p;
+  p.startPos = {0, 0, 0};
+  p.endPos = {0, 0, 0};
+  const uint64_t before = AllocationCounter::count();
+  for (long i = 0; i < 900; i++)
+  {
+    p.nps = i;
+    writer.write(p);
+  }
+  EXPECT_EQ(AllocationCounter::count() - before, 0);
+}
@@ -0,0 +1,118 @@
+/**
+* @file batchdecoder_test.cc
+*
+*
+* @brief Test of the batch extraction of data line fields
+*
+* @version 1.1
+*/
+#include "batchdecoder.hh"
+#include "gtest/gtest.h"
+
+class BatchDecoderTest : public ::testing::Test
+{
+public:
+  PTRACSchema schema;
+  std::vector<char> buffer;
+  RecordBatch batch;
+  NPSHistory expected;
+
+  void SetUp()
+  {
+    const std::size_t d = sizeof(double);
+    const std::size_t absent = EventSchema::absent;
+    // a different layout for each event type, some with missing fields
+    schema.events[SrcEvent] = EventSchema{6, 9, 15 * d, true, 0, 5 * d, 6 * d, 7 * d, 8 * d, 12 * d, 13 * d, 14 * d};
+    schema.events[BnkEvent] = EventSchema{2, 6, 8 * d, true, 0, d, 2 * d, 3 * d, 4 * d, 5 * d, 6 * d, 7 * d};
+    schema.events[SufEvent] = EventSchema{2, 5, 7 * d, true, 0, absent, 2 * d, 3 * d, 4 * d, 5 * d, absent, 6 * d};
+    schema.events[ColEvent] = EventSchema{2, 5, 7 * d, true, d, 0, 6 * d, 5 * d, 4 * d, 3 * d, absent, 2 * d};
+    schema.events[TerEvent] = EventSchema{2, 6, 8 * d, true, 0, d, 2 * d, 3 * d, 4 * d, 5 * d, 6 * d, 7 * d};
+
+    // 4 groups of 4 and a tail of 3, with a few bytes before each data line
+    // so that the lines are not aligned
+    for (int i = 0; i < 19; i++)
+    {
+      const int type = (i * 3) % NbEventTypes;
+      EventSchema const &event = schema.events[type];
+      buffer.resize(buffer.size() + 4);
+      const std::size_t offset = buffer.size();
+      buffer.resize(offset + event.length);
+      for (std::size_t f = 0; f < event.length / d; f++)
+      {
+        const double value = 100 * i + f + 0.5;
+        std::memcpy(&buffer[offset + f * d], &value, d);
+      }
+      const double cell = -600 - i;
+      if (event.cell != absent)
+        std::memcpy(&buffer[offset + event.cell], &cell, d);
+      batch.add(offset, type);
+    }
+    for (std::size_t i = 0; i < batch.size(); i++)
+    {
+      decodeEventGeneric(&buffer[batch.offsets[i]], schema.events[batch.categories[i]].length,
+                         schema.events[batch.categories[i]], 1, 4000, expected);
+    }
+  }
+
+  void checkExtractor(BatchExtractor extractor)
+  {
+    NPSHistory history;
+    const std::size_t first = 2;
+    history.cellID.assign(first + batch.size(), 0);
+    for (auto column : {&history.x, &history.y, &history.z, &history.energy, &history.weight, &history.time})
+      column->assign(first + batch.size(), 0);
+    extractor(buffer.data(), batch, BatchFieldTable(schema), history, first);
+    for (std::size_t i = 0; i < batch.size(); i++)
+    {
+      EXPECT_EQ(history.cellID[first + i], expected.cellID[i]) << "event " << i;
+      EXPECT_EQ(history.x[first + i], expected.x[i]) << "event " << i;
+      EXPECT_EQ(history.y[first + i], expected.y[i]) << "event " << i;
+      EXPECT_EQ(history.z[first + i], expected.z[i]) << "event " << i;
+      EXPECT_EQ(history.energy[first + i], expected.energy[i]) << "event " << i;
+      EXPECT_EQ(history.weight[first + i], expected.weight[i]) << "event " << i;
+      EXPECT_EQ(history.time[first + i], expected.time[i]) << "event " << i;
+    }
+    // events before first are left alone
+    EXPECT_EQ(history.cellID[0], 0);
+    EXPECT_EQ(history.time[1], 0);
+  }
+};
+
+TEST_F(BatchDecoderTest, ScalarMatchesGenericDecoder)
+{
+  checkExtractor(&extractEventsScalar);
+}
+
+TEST_F(BatchDecoderTest, AVX2MatchesGenericDecoder)
+{
+  if (!hasAVX2Extractor())
+  {
+    GTEST_SKIP() << "no AVX2 on this CPU";
+  }
+  checkExtractor(&extractEventsAVX2);
+}
+
+TEST_F(BatchDecoderTest, AbsentFields)
+{
+  // surface crossings have no cell and no weight, collisions no weight
+  for (std::size_t i = 0; i < batch.size(); i++)
+  {
+    if (batch.categories[i] == SufEvent)
+    {
+      EXPECT_EQ(expected.cellID[i], -1);
+      EXPECT_EQ(expected.weight[i], 0);
+    }
+    else
+    {
+      EXPECT_EQ(expected.cellID[i], -600 - static_cast<long>(i));
+    }
+  }
+}
+
+TEST_F(BatchDecoderTest, EmptyBatch)
+{
+  NPSHistory history;
+  RecordBatch empty;
+  selectBatchExtractor()(buffer.data(), empty, BatchFieldTable(schema), history, 0);
+  EXPECT_EQ(history.nbEvents(), 0);
+}
@@ -0,0 +1,209 @@
+/**
+* @file checkpoint_test.cc
+*
+*
+* @brief Test checkpoints and resuming the pulse pipeline from them
+*
+* @version 1.1
+*/
+#include "checkpoint.hh"
+#include "parallelparser.hh"
+#include "pipeline.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class CheckpointTest : public ::testing::Test
+{
+public:
+  const std::string path = "checkpoint_test.ptrac";
+  const std::string outputPath = "checkpoint_test.txt";
+  const std::string checkpointPath = Checkpoint::defaultPath(outputPath);
+  const long nbHistories = 300;
+
+  void SetUp()
+  {
+    writeSyntheticPTRAC(path, nbHistories, std::size_t(1) << 30);
+  }
+
+  void TearDown()
+  {
+    for (auto const &file : {path, outputPath, checkpointPath, checkpointPath + ".tmp", NPSIndex::sidecarPath(path)})
+      std::remove(file.c_str());
+  }
+
+  Checkpoint makeCheckpoint()
+  {
+    std::ofstream(outputPath) << "0123456789";
+    Checkpoint checkpoint;
+    checkpoint.ptracPath = path;
+    checkpoint.ptracStamp = FileStamp::of(path);
+    checkpoint.offset = 1234;
+    checkpoint.npsRead = 56;
+    checkpoint.nbPulses = 78;
+    checkpoint.outputPath = outputPath;
+    checkpoint.outputPosition = 4;
+    checkpoint.settings = "format=text cells=601,602";
+    return checkpoint;
+  }
+
+  /// NPS of the histories left to read
+  std::vector<long> readAll(MCNPPTRAC &reader)
+  {
+    std::vector<long> npsList;
+    while (reader.readNextNPS(1e9))
+      npsList.push_back(reader.getNPSHistory().nps.front());
+    return npsList;
+  }
+
+  /// pulses of the whole file, written by the pipeline
+  std::string allPulses()
+  {
+    MCNPPTRACMmap ptrac(path);
+    std::ostringstream text;
+    TextPulseWriter writer(text, false);
+    PulsePipeline(ptrac, writer).run();
+    return text.str();
+  }
+};
+
+TEST_F(CheckpointTest, SavesAndLoads)
+{
+  const Checkpoint saved = makeCheckpoint();
+  ASSERT_TRUE(saved.save(checkpointPath));
+  std::ifstream tmp(checkpointPath + ".tmp");
+  EXPECT_FALSE(tmp.good());
+
+  Checkpoint loaded;
+  ASSERT_TRUE(loaded.load(checkpointPath));
+  EXPECT_EQ(loaded.ptracPath, path);
+  EXPECT_TRUE(loaded.ptracStamp == saved.ptracStamp);
+  EXPECT_EQ(loaded.offset, 1234);
+  EXPECT_EQ(loaded.npsRead, 56);
+  EXPECT_EQ(loaded.nbPulses, 78);
+  EXPECT_EQ(loaded.outputPath, outputPath);
+  EXPECT_EQ(loaded.outputPosition, 4);
+  EXPECT_EQ(loaded.settings, saved.settings);
+  EXPECT_NO_THROW(loaded.validate(path, saved.settings));
+
+  ASSERT_TRUE(loaded.truncateOutput());
+  EXPECT_EQ(FileStamp::of(outputPath).size, 4);
+}
+
+TEST_F(CheckpointTest, RejectsCorruptCheckpoints)
+{
+  Checkpoint checkpoint;
+  EXPECT_FALSE(checkpoint.load(checkpointPath));
+  ASSERT_TRUE(makeCheckpoint().save(checkpointPath));
+
+  // a checkpoint cut short, or with a field that is not a number
+  std::ifstream file(checkpointPath);
+  std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::ofstream(checkpointPath, std::ios::trunc) << text.substr(0, text.size() - 4);
+  EXPECT_FALSE(checkpoint.load(checkpointPath));
+  std::string bad = text;
+  bad.replace(bad.find("offset 1234"), 11, "offset 12x4");
+  std::ofstream(checkpointPath, std::ios::trunc) << bad;
+  EXPECT_FALSE(checkpoint.load(checkpointPath));
+  std::ofstream(checkpointPath, std::ios::trunc) << "PTRACCKPT 2\n" << text.substr(text.find('\n') + 1);
+  EXPECT_FALSE(checkpoint.load(checkpointPath));
+}
+
+TEST_F(CheckpointTest, ValidatesAgainstTheJob)
+{
+  const Checkpoint checkpoint = makeCheckpoint();
+  EXPECT_THROW(checkpoint.validate("other.ptrac", checkpoint.settings), std::runtime_error);
+  EXPECT_THROW(checkpoint.validate(path, "format=binary cells=601,602"), std::runtime_error);
+
+  Checkpoint longer = checkpoint;
+  longer.outputPosition = 11;
+  EXPECT_THROW(longer.validate(path, checkpoint.settings), std::runtime_error);
+
+  // the PTRAC file was written again since
+  std::ofstream(path, std::ios::app) << "x";
+  EXPECT_THROW(checkpoint.validate(path, checkpoint.settings), std::runtime_error);
+}
+
+TEST_F(CheckpointTest, ReadersResumeAtTheirOffset)
+{
+  MCNPPTRACMmap mmap(path);
+  MCNPPTRACParallel parallel(path, 2, 16);
+  for (MCNPPTRACMmap *reader : std::vector<MCNPPTRACMmap *>{&mmap, &parallel})
+  {
+    for (long n = 0; n < 100; n++)
+      ASSERT_TRUE(reader->readNextNPS(1e9));
+    const long offset = reader->tell();
+    const std::vector<long> rest = readAll(*reader);
+    ASSERT_EQ(rest.size(), static_cast<std::size_t>(nbHistories - 100));
+    EXPECT_EQ(reader->tell(), FileStamp::of(path).size);
+
+    MCNPPTRACParallel resumed(path, 2, 16);
+    ASSERT_TRUE(resumed.resume(offset, 100));
+    EXPECT_EQ(resumed.tell(), offset);
+    EXPECT_EQ(readAll(resumed), rest);
+    EXPECT_EQ(resumed.getNPSRead(), nbHistories);
+
+    EXPECT_FALSE(resumed.resume(offset + 1, 100));
+    EXPECT_FALSE(resumed.resume(0, 0));
+    EXPECT_FALSE(resumed.resume(FileStamp::of(path).size + 1, 0));
+    EXPECT_TRUE(resumed.resume(FileStamp::of(path).size, nbHistories));
+    EXPECT_TRUE(readAll(resumed).empty());
+  }
+  MCNPPTRACBinary streaming(path);
+  EXPECT_EQ(streaming.tell(), -1);
+}
+
+TEST_F(CheckpointTest, PipelineResumesFromAnyCheckpoint)
+{
+  const std::string expected = allPulses();
+  std::vector<PipelineProgress> progress;
+  std::vector<std::size_t> written;
+  {
+    MCNPPTRACParallel ptrac(path, 2, 16);
+    std::ostringstream text;
+    TextPulseWriter writer(text, false);
+    PipelineOptions options;
+    options.batchSize = 32;
+    options.nbBatches = 2;
+    options.checkpointInterval = 0;
+    options.checkpoint = [&](PipelineProgress const &p) {
+      progress.push_back(p);
+      written.push_back(text.str().size());
+    };
+    const long nbPulses = PulsePipeline(ptrac, writer, options).run();
+    EXPECT_EQ(text.str(), expected);
+    ASSERT_EQ(progress.size(), static_cast<std::size_t>((nbHistories + 31) / 32));
+    EXPECT_EQ(progress.back().nbPulses, nbPulses);
+  }
+  EXPECT_EQ(progress.back().npsRead, nbHistories);
+
+  // the output cut at a checkpoint and the pulses of the rest of the file
+  for (std::size_t c = 0; c < progress.size(); c++)
+  {
+    EXPECT_EQ(progress[c].npsRead, std::min<long>(32 * (c + 1), nbHistories));
+    MCNPPTRACParallel ptrac(path, 2, 16);
+    ASSERT_TRUE(ptrac.resume(progress[c].offset, progress[c].npsRead));
+    std::ostringstream text;
+    text << expected.substr(0, written[c]);
+    TextPulseWriter writer(text, false);
+    const long nbPulses = PulsePipeline(ptrac, writer).run();
+    EXPECT_EQ(progress[c].nbPulses + nbPulses, progress.back().nbPulses);
+    EXPECT_EQ(text.str(), expected);
+  }
+}
+
+TEST_F(CheckpointTest, NoCheckpointInsideTheLastBatchAtMaxPulses)
+{
+  MCNPPTRACMmap ptrac(path);
+  std::ostringstream text;
+  TextPulseWriter writer(text, false);
+  PipelineOptions options;
+  options.batchSize = 50;
+  options.nbBatches = 1;
+  options.maxPulses = 10;
+  options.checkpointInterval = 0;
+  long nbCheckpoints = 0;
+  options.checkpoint = [&](PipelineProgress const &) { nbCheckpoints++; };
+  EXPECT_EQ(PulsePipeline(ptrac, writer, options).run(), 10);
+  EXPECT_EQ(nbCheckpoints, 0);
+}
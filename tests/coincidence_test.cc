@@ -0,0 +1,133 @@
+/**
+* @file coincidence_test.cc
+*
+*
+* @brief Test of the streaming coincidence counter
+*
+* @version 1.1
+*/
+#include "coincidence.hh"
+#include "gtest/gtest.h"
+#include <random>
+
+TEST(RingBufferTest, KeepsOrderWhenGrowing)
+{
+  RingBuffer<int> ring(4);
+  EXPECT_EQ(ring.capacity(), 4);
+  for (int i = 0; i < 3; i++)
+    ring.push_back(i);
+  ring.pop_front();
+  ring.pop_front();
+  // wraps around, then grows
+  for (int i = 3; i < 10; i++)
+    ring.push_back(i);
+  EXPECT_EQ(ring.capacity(), 8);
+  ASSERT_EQ(ring.size(), 8);
+  for (std::size_t i = 0; i < ring.size(); i++)
+    EXPECT_EQ(ring[i], static_cast<int>(i) + 2);
+  EXPECT_EQ(ring.front(), 2);
+  EXPECT_EQ(ring.back(), 9);
+  ring.clear();
+  EXPECT_TRUE(ring.empty());
+}
+
+class CoincidenceTest : public ::testing::Test
+{
+public:
+  void writeTimes(CoincidenceCounter &counter, std::vector<double> const &times)
+  {
+    Pulse p;
+    p.startPos = p.endPos = {0, 0, 0};
+    for (double t : times)
+    {
+      p.time = t;
+      counter.write(p);
+    }
+    counter.flush();
+  }
+};
+
+TEST_F(CoincidenceTest, Multiplicity)
+{
+  CoincidenceOptions options;
+  options.window = 100;
+  CoincidenceCounter counter(options);
+  writeTimes(counter, {0, 1, 2, 200, 500, 599.5, 600});
+  EXPECT_EQ(counter.getNbPulses(), 7);
+  EXPECT_EQ(counter.getMultiplicity(), std::vector<uint64_t>({0, 2, 1, 1}));
+}
+
+TEST_F(CoincidenceTest, RossiAlpha)
+{
+  CoincidenceOptions options;
+  options.rossiBinWidth = 1;
+  options.rossiNbBins = 10;
+  CoincidenceCounter counter(options);
+  writeTimes(counter, {0, 1.5, 3, 20});
+  std::vector<uint64_t> expected(10, 0);
+  expected[1] = 2;
+  expected[3] = 1;
+  EXPECT_EQ(counter.getRossiAlpha(), expected);
+  EXPECT_EQ(counter.getNbPairs(), 3);
+}
+
+TEST_F(CoincidenceTest, FeynmanY)
+{
+  CoincidenceOptions options;
+  options.feynmanGates = {10};
+  CoincidenceCounter counter(options);
+  // gates [0,10) 3 pulses, [10,20) none, [20,30) 2, [30,40) none, [40,50) not complete
+  writeTimes(counter, {0, 1, 2, 25, 26, 40});
+  EXPECT_EQ(counter.getFeynmanHistogram(0), std::vector<uint64_t>({2, 0, 1, 1}));
+  EXPECT_DOUBLE_EQ(counter.feynmanY(0), (13.0 / 4 - 1.25 * 1.25) / 1.25 - 1);
+}
+
+TEST_F(CoincidenceTest, PoissonTrainIsUncorrelated)
+{
+  CoincidenceOptions options;
+  options.rossiBinWidth = 10;
+  options.rossiNbBins = 10;
+  options.feynmanGates = {50, 500};
+  CoincidenceCounter counter(options);
+  std::mt19937_64 generator(11);
+  std::exponential_distribution<double> gap(0.1); // one pulse every 10 shakes
+  std::vector<double> times;
+  double t = 0;
+  for (int i = 0; i < 200000; i++)
+    times.push_back(t += gap(generator));
+  writeTimes(counter, times);
+
+  EXPECT_NEAR(counter.feynmanY(0), 0, 0.03);
+  EXPECT_NEAR(counter.feynmanY(1), 0, 0.1);
+  // flat Rossi-alpha, one pair per bin per pulse on average
+  for (auto pairs : counter.getRossiAlpha())
+    EXPECT_NEAR(pairs / 200000.0, 1, 0.02);
+}
+
+TEST_F(CoincidenceTest, SlidingWindow)
+{
+  CoincidenceOptions options;
+  options.rossiBinWidth = 1;
+  options.rossiNbBins = 100;
+  CoincidenceCounter counter(options);
+  std::vector<double> times;
+  // one pulse per shake, 100 of them in range at any time
+  for (int i = 0; i < 100000; i++)
+    times.push_back(i);
+  writeTimes(counter, times);
+  EXPECT_EQ(counter.getNbPairs(), 99 * 100000 - 99 * 100 / 2);
+}
+
+TEST_F(CoincidenceTest, RejectsUnsortedPulses)
+{
+  CoincidenceCounter counter;
+  Pulse p;
+  p.time = 10;
+  counter.write(p);
+  p.time = 9;
+  EXPECT_THROW(counter.write(p), std::logic_error);
+
+  CoincidenceOptions options;
+  options.feynmanGates = {0};
+  EXPECT_THROW(CoincidenceCounter bad(options), std::invalid_argument);
+}
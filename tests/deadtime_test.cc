@@ -0,0 +1,147 @@
+/**
+* @file deadtime_test.cc
+*
+*
+* @brief Test of the pile-up and dead time stage
+*
+* @version 1.1
+*/
+#include "deadtime.hh"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <map>
+#include <random>
+
+class CollectingWriter : public PulseWriter
+{
+public:
+  std::vector<Pulse> pulses;
+  void write(const Pulse &p) { pulses.push_back(p); }
+  void flush() {}
+};
+
+class DeadTimeTest : public ::testing::Test
+{
+public:
+  CollectingWriter out;
+
+  static Pulse makePulse(double time, long cell, double energy = 1, double x = 0)
+  {
+    Pulse p;
+    p.nps = static_cast<long>(time);
+    p.time = time;
+    p.cellID = cell;
+    p.energy = energy;
+    p.startPos = {x, 0, 0};
+    p.endPos = {x + 1, 0, 0};
+    p.pos = {x + 0.5, 0, 0};
+    return p;
+  }
+
+  std::vector<double> times() const
+  {
+    std::vector<double> t;
+    for (auto const &p : out.pulses)
+      t.push_back(p.time);
+    return t;
+  }
+};
+
+TEST_F(DeadTimeTest, PileUp)
+{
+  DeadTimeOptions options;
+  options.resolvingTime = 10;
+  DeadTimeWriter stage(out, DetectorCells({601, 602}), options);
+  stage.write(makePulse(0, 601, 1, 0));
+  stage.write(makePulse(5, 602, 2));
+  stage.write(makePulse(9, 601, 3, 4));
+  // still open until the train reaches 10
+  EXPECT_TRUE(out.pulses.empty());
+  stage.write(makePulse(10, 601, 4));
+  EXPECT_EQ(out.pulses.size(), 1);
+  stage.flush();
+
+  ASSERT_EQ(out.pulses.size(), 3);
+  EXPECT_EQ(times(), std::vector<double>({0, 5, 10}));
+  EXPECT_EQ(out.pulses[0].energy, 1 + 3);
+  EXPECT_EQ(out.pulses[0].startPos, std::vector<double>({0, 0, 0}));
+  EXPECT_EQ(out.pulses[0].endPos, std::vector<double>({5, 0, 0}));
+  EXPECT_EQ(out.pulses[0].pos, std::vector<double>({2.5, 0, 0}));
+  EXPECT_EQ(out.pulses[1].cellID, 602);
+  EXPECT_EQ(stage.getNbPiledUp(), 1);
+  EXPECT_EQ(stage.getNbRecorded(), 3);
+}
+
+TEST_F(DeadTimeTest, NonParalyzable)
+{
+  DeadTimeOptions options;
+  options.deadTime = 10;
+  options.model = DeadTimeModel::NonParalyzable;
+  DeadTimeWriter stage(out, DetectorCells({601}), options);
+  for (double t : {0, 4, 8, 12, 16, 20, 24})
+    stage.write(makePulse(t, 601));
+  stage.flush();
+  EXPECT_EQ(times(), std::vector<double>({0, 12, 24}));
+  EXPECT_EQ(stage.getNbLost(), 4);
+}
+
+TEST_F(DeadTimeTest, Paralyzable)
+{
+  DeadTimeOptions options;
+  options.deadTime = 10;
+  options.model = DeadTimeModel::Paralyzable;
+  DeadTimeWriter stage(out, DetectorCells({601}), options);
+  // every lost pulse restarts the dead time, until the gap from 24 to 40
+  for (double t : {0, 4, 8, 12, 16, 20, 24, 40})
+    stage.write(makePulse(t, 601));
+  stage.flush();
+  EXPECT_EQ(times(), std::vector<double>({0, 40}));
+  EXPECT_EQ(stage.getNbLost(), 6);
+}
+
+TEST_F(DeadTimeTest, CellsAreIndependentAndOutputStaysSorted)
+{
+  DeadTimeOptions options;
+  options.resolvingTime = 3;
+  options.deadTime = 20;
+  options.model = DeadTimeModel::NonParalyzable;
+  std::vector<long> cells;
+  for (long cell = 1000; cell < 3000; cell++)
+    cells.push_back(cell);
+  DeadTimeWriter stage(out, DetectorCells(cells), options);
+  std::mt19937_64 generator(5);
+  std::exponential_distribution<double> gap(1.0);
+  double t = 0;
+  const int n = 100000;
+  for (int i = 0; i < n; i++)
+    stage.write(makePulse(t += gap(generator), 1000 + generator() % 2000));
+  stage.flush();
+
+  EXPECT_EQ(stage.getNbRecorded() + stage.getNbPiledUp() + stage.getNbLost(), n);
+  EXPECT_EQ(out.pulses.size(), stage.getNbRecorded());
+  EXPECT_TRUE(std::is_sorted(out.pulses.begin(), out.pulses.end(),
+                             [](Pulse const &a, Pulse const &b) { return a.time < b.time; }));
+  // at least the dead time between two pulses of the same cell
+  std::map<long, double> lastTime;
+  for (auto const &p : out.pulses)
+  {
+    auto previous = lastTime.find(p.cellID);
+    if (previous != lastTime.end())
+    {
+      EXPECT_GE(p.time - previous->second, 20);
+    }
+    lastTime[p.cellID] = p.time;
+  }
+}
+
+TEST_F(DeadTimeTest, Errors)
+{
+  DeadTimeWriter stage(out, DetectorCells({601}), DeadTimeOptions());
+  EXPECT_THROW(stage.write(makePulse(1, 602)), std::logic_error);
+  stage.write(makePulse(5, 601));
+  EXPECT_THROW(stage.write(makePulse(4, 601)), std::logic_error);
+
+  DeadTimeOptions negative;
+  negative.deadTime = -1;
+  EXPECT_THROW(DeadTimeWriter(out, DetectorCells({601}), negative), std::invalid_argument);
+}
@@ -0,0 +1,215 @@
+/**
+* @file decompress_test.cc
+*
+*
+* @brief Test reading gzip and zstd compressed PTRAC files
+*
+* @version 1.1
+*/
+#include "decompress.hh"
+#include "parser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <sstream>
+
+#ifdef PTRAC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+class DecompressTest : public ::testing::Test
+{
+public:
+  const std::string path = "decompress_test.ptrac";
+  const std::string gzPath = "decompress_test.ptrac.gz";
+  const std::string zstPath = "decompress_test.ptrac.zst";
+  const long nbHistories = 300;
+
+  void SetUp()
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3));
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+    std::remove(gzPath.c_str());
+    std::remove(zstPath.c_str());
+  }
+
+  std::string contents(std::string const &file)
+  {
+    std::ifstream stream(file, std::ios::binary);
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    return buffer.str();
+  }
+
+  /// compresses the PTRAC file into nbMembers concatenated gzip members
+  void writeGzip(int nbMembers)
+  {
+    const std::string bytes = contents(path);
+    std::remove(gzPath.c_str());
+    const std::size_t memberSize = bytes.size() / nbMembers + 1;
+    for (std::size_t first = 0; first < bytes.size(); first += memberSize)
+    {
+      gzFile file = gzopen(gzPath.c_str(), "ab");
+      ASSERT_NE(file, nullptr);
+      const std::size_t n = std::min(memberSize, bytes.size() - first);
+      ASSERT_EQ(gzwrite(file, bytes.data() + first, static_cast<unsigned>(n)), static_cast<int>(n));
+      gzclose(file);
+    }
+  }
+
+  /// reads the file to its end, errors may be raised as soon as it is opened
+  static void readAll(std::string const &file)
+  {
+    MCNPPTRACBinary ptrac(file);
+    while (ptrac.readNextNPS(1e9))
+    {
+    }
+  }
+
+  void expectSameHistories(MCNPPTRAC &expected, MCNPPTRAC &actual)
+  {
+    long histories = 0;
+    while (expected.readNextNPS(1e9))
+    {
+      ASSERT_TRUE(actual.readNextNPS(1e9));
+      const NPSHistory &e = expected.getNPSHistory();
+      const NPSHistory &a = actual.getNPSHistory();
+      ASSERT_EQ(a.nbEvents(), e.nbEvents());
+      EXPECT_EQ(a.nps, e.nps);
+      EXPECT_EQ(a.cellID, e.cellID);
+      EXPECT_EQ(a.energy, e.energy);
+      EXPECT_EQ(a.time, e.time);
+      histories++;
+    }
+    EXPECT_EQ(histories, nbHistories);
+    EXPECT_FALSE(actual.readNextNPS(1e9));
+  }
+};
+
+TEST(Compression, DetectsMagicNumbers)
+{
+  const char gzip[] = {'\x1f', '\x8b', '\x08', '\x00'};
+  const char zstd[] = {'\x28', '\xb5', '\x2f', '\xfd'};
+  const char ptrac[] = {'\x04', '\x00', '\x00', '\x00'};
+  EXPECT_EQ(detectCompression(gzip, 4), Compression::Gzip);
+  EXPECT_EQ(detectCompression(zstd, 4), Compression::Zstd);
+  EXPECT_EQ(detectCompression(zstd, 3), Compression::None);
+  EXPECT_EQ(detectCompression(ptrac, 4), Compression::None);
+  EXPECT_EQ(detectCompression(ptrac, 0), Compression::None);
+}
+
+TEST_F(DecompressTest, DetectsFiles)
+{
+  writeGzip(1);
+  EXPECT_EQ(detectCompression(path), Compression::None);
+  EXPECT_EQ(detectCompression(gzPath), Compression::Gzip);
+  EXPECT_EQ(detectCompression("decompress_test.missing"), Compression::None);
+}
+
+TEST_F(DecompressTest, GzipBufferRestoresBytes)
+{
+  writeGzip(1);
+  std::ifstream compressed(gzPath, std::ios::binary);
+  GzipBuffer buffer(*compressed.rdbuf(), 4096);
+  std::stringstream actual;
+  actual << &buffer;
+  EXPECT_EQ(actual.str(), contents(path));
+}
+
+TEST_F(DecompressTest, ReadsGzipPTRAC)
+{
+  writeGzip(1);
+  MCNPPTRACBinary expected(path);
+  MCNPPTRACBinary actual(gzPath);
+  expectSameHistories(expected, actual);
+}
+
+TEST_F(DecompressTest, ReadsConcatenatedMembers)
+{
+  writeGzip(4);
+  ReadAheadOptions small;
+  small.blockSize = 4096;
+  MCNPPTRACBinary expected(path);
+  MCNPPTRACBinary actual(gzPath, small);
+  expectSameHistories(expected, actual);
+}
+
+TEST_F(DecompressTest, CorruptGzipThrows)
+{
+  writeGzip(1);
+  std::string bytes = contents(gzPath);
+  for (std::size_t i = 20; i < bytes.size(); i += 7)
+  {
+    bytes[i] = static_cast<char>(~bytes[i]);
+  }
+  std::stringbuf corrupt(bytes);
+  GzipBuffer buffer(corrupt);
+  EXPECT_THROW(buffer.sgetc(), std::runtime_error);
+}
+
+TEST_F(DecompressTest, TruncatedGzipThrows)
+{
+  writeGzip(2);
+  const std::string bytes = contents(gzPath);
+  // cut inside the deflate data of the last member, and before its trailer
+  for (std::size_t cut : {bytes.size() / 2 + bytes.size() / 4, bytes.size() - 4})
+  {
+    std::stringbuf truncated(bytes.substr(0, cut));
+    GzipBuffer buffer(truncated, 4096);
+    EXPECT_THROW(
+        while (buffer.sbumpc() != EOF) {}, std::runtime_error)
+        << cut;
+  }
+
+  std::ofstream(gzPath, std::ios::binary | std::ios::trunc) << bytes.substr(0, bytes.size() - 4);
+  EXPECT_THROW(readAll(gzPath), std::runtime_error);
+}
+
+#ifdef PTRAC_HAVE_ZSTD
+TEST_F(DecompressTest, ReadsZstdFrames)
+{
+  // two frames, as written by appending .zst files
+  const std::string bytes = contents(path);
+  std::string compressed;
+  for (std::size_t first : {std::size_t(0), bytes.size() / 2})
+  {
+    const std::size_t n = first == 0 ? bytes.size() / 2 : bytes.size() - first;
+    std::string frame(ZSTD_compressBound(n), '\0');
+    const std::size_t size = ZSTD_compress(&frame[0], frame.size(), bytes.data() + first, n, 3);
+    ASSERT_FALSE(ZSTD_isError(size));
+    compressed += frame.substr(0, size);
+  }
+  std::ofstream(zstPath, std::ios::binary) << compressed;
+  {
+    MCNPPTRACBinary expected(path);
+    MCNPPTRACBinary actual(zstPath);
+    expectSameHistories(expected, actual);
+  }
+
+  std::ofstream(zstPath, std::ios::binary | std::ios::trunc) << compressed.substr(0, compressed.size() - 4);
+  EXPECT_THROW(readAll(zstPath), std::runtime_error);
+}
+#endif
+
+TEST(Compression, ZstdSupport)
+{
+  std::stringbuf empty;
+  if (hasZstd())
+  {
+    EXPECT_NE(makeDecompressor(Compression::Zstd, empty), nullptr);
+  }
+  else
+  {
+    EXPECT_THROW(makeDecompressor(Compression::Zstd, empty), std::runtime_error);
+  }
+  EXPECT_EQ(makeDecompressor(Compression::None, empty), nullptr);
+}
@@ -0,0 +1,175 @@
+/**
+* @file diagnostics_test.cc
+*
+*
+* @brief Test the anomaly counters and the event classification table
+*
+* @version 1.1
+*/
+#include "historyvisitor.hh"
+#include "parallelparser.hh"
+#include "ptracwriter.hh"
+#include "pulsebuilder.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+class DiagnosticsTest : public ::testing::Test
+{
+public:
+  void SetUp() { Diagnostics::reset(); }
+  void TearDown() { Diagnostics::reset(); }
+};
+
+TEST_F(DiagnosticsTest, EventTypeTableMatchesTheRanges)
+{
+  for (long id = -7000; id <= 10000; id++)
+  {
+    // the classification the table replaces
+    const long number = std::abs(id);
+    int expected = number / 1000 - 1;
+    if (expected < 0 || expected >= NbEventTypes)
+      expected = -1;
+    if (std::abs(number - 2000) < 40)
+      expected = BnkEvent;
+    ASSERT_EQ(eventType(id), expected) << id;
+    ASSERT_EQ(isBnkEvent(id), std::abs(number - 2000) < 40) << id;
+  }
+  EXPECT_EQ(eventType(9000), -1);
+  EXPECT_EQ(eventType(LONG_MIN + 1), -1);
+  EXPECT_EQ(eventType(LONG_MAX), -1);
+  EXPECT_FALSE(isBnkEvent(LONG_MIN + 1));
+  EXPECT_FALSE(isBnkEvent(LONG_MAX));
+}
+
+TEST_F(DiagnosticsTest, UnusualBankEventsAreCountedNotPrinted)
+{
+  testing::internal::CaptureStdout();
+  EXPECT_TRUE(isBnkEvent(2001));
+  EXPECT_TRUE(isBnkEvent(-2039));
+  EXPECT_FALSE(isBnkEvent(2040));
+  // the classification alone records nothing
+  EXPECT_EQ(Diagnostics::count(Diagnostics::UnusualBankEvent), 0u);
+  recordBnkEvent(2030);
+  recordBnkEvent(-2033);
+  EXPECT_EQ(Diagnostics::count(Diagnostics::UnusualBankEvent), 0u);
+  recordBnkEvent(2001);
+  recordBnkEvent(-2039);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+  EXPECT_EQ(Diagnostics::count(Diagnostics::UnusualBankEvent), 2u);
+  std::vector<Diagnostics::Sample> samples = Diagnostics::samples(Diagnostics::UnusualBankEvent);
+  ASSERT_EQ(samples.size(), 2u);
+  EXPECT_EQ(samples[0].value, 2001);
+  EXPECT_EQ(samples[1].value, -2039);
+}
+
+TEST_F(DiagnosticsTest, EachReaderCountsUnusualBankEventsOnce)
+{
+  const std::string path = "diagnostics_test.ptrac";
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= 20; nps++)
+    {
+      SyntheticHistory history = SyntheticPTRACWriter::makeHistory(nps, 2);
+      if (nps == 5)
+        history.particles[1].front().eventID = 2001; // on a data line
+      if (nps == 9)
+        history.particles[0].front().eventID = -2039; // on the NPS line
+      writer.writeHistory(history);
+    }
+  }
+  auto readAll = [](MCNPPTRAC &reader) {
+    while (reader.readNextNPS(1e9))
+      ;
+  };
+
+  // the index and recovery scans walk the file too, without recording
+  MCNPPTRACMmap mmap(path);
+  mmap.setRecovery(true);
+  ASSERT_TRUE(mmap.seekToNPS(1));
+  readAll(mmap);
+  EXPECT_EQ(Diagnostics::count(Diagnostics::UnusualBankEvent), 2u);
+
+  Diagnostics::reset();
+  MCNPPTRACParallel parallel(path, 2, 4);
+  parallel.setRecovery(true);
+  readAll(parallel);
+  EXPECT_EQ(Diagnostics::count(Diagnostics::UnusualBankEvent), 2u);
+
+  Diagnostics::reset();
+  MCNPPTRACBinary binary(path);
+  readAll(binary);
+  EXPECT_EQ(Diagnostics::count(Diagnostics::UnusualBankEvent), 2u);
+
+  // the cell filter walks each particle twice
+  Diagnostics::reset();
+  MCNPPTRACMmap visited(path);
+  visited.setProjection(EventProjection::pulses({601}));
+  HistoryVisitor visitor;
+  EXPECT_EQ(visited.visit(visitor), 20);
+  EXPECT_EQ(Diagnostics::count(Diagnostics::UnusualBankEvent), 2u);
+  std::vector<Diagnostics::Sample> samples = Diagnostics::samples(Diagnostics::UnusualBankEvent);
+  ASSERT_EQ(samples.size(), 2u);
+  EXPECT_EQ(samples[0].value, 2001);
+  EXPECT_EQ(samples[1].value, -2039);
+
+  std::remove(path.c_str());
+  std::remove(NPSIndex::sidecarPath(path).c_str());
+}
+
+TEST_F(DiagnosticsTest, CountsOverThreadsAndLimitsSamples)
+{
+  const int nbThreads = 4;
+  const long perThread = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nbThreads; t++)
+  {
+    threads.emplace_back([perThread, t] {
+      for (long i = 0; i < perThread; i++)
+        Diagnostics::record(Diagnostics::MissingTermination, 4000, t * perThread + i);
+    });
+  }
+  // counted while the threads are alive and after they ended
+  Diagnostics::record(Diagnostics::MissingTermination, 4000, -1);
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(Diagnostics::count(Diagnostics::MissingTermination), nbThreads * perThread + 1u);
+  EXPECT_EQ(Diagnostics::samples(Diagnostics::MissingTermination).size(), Diagnostics::maxSamples);
+  EXPECT_EQ(Diagnostics::count(Diagnostics::CorruptRegion), 0u);
+  EXPECT_FALSE(Diagnostics::empty());
+
+  std::ostringstream report;
+  Diagnostics::report(report);
+  EXPECT_EQ(report.str().find(std::to_string(nbThreads * perThread + 1) + " particles"), 0u);
+  EXPECT_EQ(report.str().find("bank"), std::string::npos);
+
+  Diagnostics::reset();
+  EXPECT_TRUE(Diagnostics::empty());
+  EXPECT_TRUE(Diagnostics::samples(Diagnostics::MissingTermination).empty());
+}
+
+TEST_F(DiagnosticsTest, PulseBuilderRecordsMissingTermination)
+{
+  NPSHistory history;
+  // the last event of the particle is in the detector cell
+  history.addEvent(7, 2030, 602, 0, 0, 0, 2, 1, 0);
+  history.addEvent(7, 4000, 601, 1, 0, 0, 1.5, 1, 1);
+  history.addEvent(7, 4000, 601, 2, 0, 0, 1, 1, 2);
+  history.endParticle();
+
+  testing::internal::CaptureStdout();
+  PulseBuilder builder{DetectorCells({601})};
+  std::vector<Pulse> pulses;
+  EXPECT_EQ(builder.build(history[0], pulses), 1u);
+  Pulse pulse(history[0]);
+  EXPECT_EQ(testing::internal::GetCapturedStdout(), "");
+  EXPECT_DOUBLE_EQ(pulses[0].energy, 0.5);
+  EXPECT_DOUBLE_EQ(pulse.energy, 0.5);
+  EXPECT_EQ(Diagnostics::count(Diagnostics::MissingTermination), 2u);
+  EXPECT_EQ(Diagnostics::samples(Diagnostics::MissingTermination).front().nps, 7);
+
+  std::ostringstream json;
+  Diagnostics::writeJSON(json);
+  EXPECT_NE(json.str().find("\"missing_termination\": 2"), std::string::npos);
+}
@@ -0,0 +1,286 @@
+/**
+* @file historyvisitor_test.cc
+*
+*
+* @brief Test visiting the events of a PTRAC file without storing histories
+*
+* @version 1.1
+*/
+#include "historyvisitor.hh"
+#include "parallelparser.hh"
+#include "pulsebuilder.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+namespace
+{
+/// stores the visited histories the way the readers do
+struct CollectingVisitor : public HistoryVisitor
+{
+  std::vector<long> npsList;
+  std::vector<NPSHistory> histories;
+  NPSHistory current;
+  int depth = 0;
+
+  void onHistoryBegin(long nps)
+  {
+    EXPECT_EQ(depth++, 0);
+    npsList.push_back(nps);
+    current.clear();
+  }
+  void onEvent(Event const &event) { current.addEvent(event); }
+  void onParticleEnd()
+  {
+    EXPECT_GT(current.openEvents(), 0u);
+    current.endParticle();
+  }
+  void onHistoryEnd(long nps)
+  {
+    EXPECT_EQ(--depth, 0);
+    EXPECT_EQ(nps, npsList.back());
+    EXPECT_EQ(current.openEvents(), 0u);
+    histories.push_back(current);
+  }
+};
+
+/// only counts, every other callback is the default one
+struct EventCounter : public HistoryVisitor
+{
+  long nbEvents = 0;
+  void onEvent(Event const &) { nbEvents++; }
+};
+
+class VectorPulseWriter : public PulseWriter
+{
+public:
+  std::vector<Pulse> pulses;
+  void write(const Pulse &p) { pulses.push_back(p); }
+  void flush() {}
+};
+
+void expectSameHistory(NPSHistory const &expected, NPSHistory const &actual)
+{
+  ASSERT_EQ(expected.size(), actual.size());
+  for (std::size_t p = 0; p < expected.size(); p++)
+  {
+    EXPECT_EQ(expected[p].first(), actual[p].first());
+    EXPECT_EQ(expected[p].last(), actual[p].last());
+  }
+  EXPECT_EQ(expected.nps, actual.nps);
+  EXPECT_EQ(expected.eventID, actual.eventID);
+  EXPECT_EQ(expected.cellID, actual.cellID);
+  EXPECT_EQ(expected.x, actual.x);
+  EXPECT_EQ(expected.y, actual.y);
+  EXPECT_EQ(expected.z, actual.z);
+  EXPECT_EQ(expected.energy, actual.energy);
+  EXPECT_EQ(expected.weight, actual.weight);
+  EXPECT_EQ(expected.time, actual.time);
+}
+} // namespace
+
+class HistoryVisitorTest : public ::testing::Test
+{
+public:
+  const std::string path = "historyvisitor_test.ptrac";
+  long nbHistories;
+
+  void SetUp()
+  {
+    SyntheticMix mix;
+    mix.maxParticles = 4;
+    nbHistories = writeSyntheticPTRAC(path, 500, std::size_t(1) << 30, mix);
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+    std::remove(NPSIndex::sidecarPath(path).c_str());
+  }
+
+  /// the visited histories, compared to the ones read with readNextNPS
+  void expectVisitMatchesRead(EventProjection const &projection)
+  {
+    MCNPPTRACMmap reader(path);
+    reader.setProjection(projection);
+    MCNPPTRACMmap visited(path);
+    visited.setProjection(projection);
+    CollectingVisitor visitor;
+    EXPECT_EQ(visited.visit(visitor), nbHistories);
+    ASSERT_EQ(visitor.histories.size(), static_cast<std::size_t>(nbHistories));
+    for (long i = 0; i < nbHistories; i++)
+    {
+      ASSERT_TRUE(reader.readNextNPS(1e9));
+      EXPECT_EQ(visitor.npsList[i], i + 1);
+      expectSameHistory(reader.getNPSHistory(), visitor.histories[i]);
+    }
+    EXPECT_FALSE(reader.readNextNPS(1e9));
+    EXPECT_EQ(visited.visit(visitor), 0);
+  }
+};
+
+TEST_F(HistoryVisitorTest, SameEventsAsReadNextNPS)
+{
+  expectVisitMatchesRead(EventProjection());
+}
+
+TEST_F(HistoryVisitorTest, ProjectionApplies)
+{
+  EventProjection pulses = EventProjection::pulses({601});
+  pulses.eventTypes &= ~(1u << SufEvent);
+  expectVisitMatchesRead(pulses);
+
+  EventProjection energy;
+  energy.fields = EventProjection::Energy;
+  energy.cells = {602};
+  expectVisitMatchesRead(energy);
+
+  // no particle goes through cell 700, the histories are still visited
+  EventProjection none;
+  none.cells = {700};
+  expectVisitMatchesRead(none);
+}
+
+TEST_F(HistoryVisitorTest, StopsAtMaxNPSAndRange)
+{
+  MCNPPTRACMmap ptrac(path);
+  EventCounter counter;
+  EXPECT_EQ(ptrac.visit(counter, 9), 10);
+  EXPECT_EQ(ptrac.getNPSRead(), 10);
+  EXPECT_GT(counter.nbEvents, 0);
+
+  // reading goes on after the visited histories
+  ASSERT_TRUE(ptrac.readNextNPS(1e9));
+  EXPECT_EQ(ptrac.getNPSHistory().nps.front(), 11);
+
+  ASSERT_TRUE(ptrac.setNPSRange(100, 120));
+  CollectingVisitor visitor;
+  EXPECT_EQ(ptrac.visit(visitor), 20);
+  EXPECT_EQ(visitor.npsList.front(), 100);
+  EXPECT_EQ(visitor.npsList.back(), 119);
+}
+
+TEST_F(HistoryVisitorTest, ParallelReaderVisitsFromNextHistory)
+{
+  MCNPPTRACParallel ptrac(path, 2, 16);
+  for (int i = 0; i < 40; i++)
+  {
+    ASSERT_TRUE(ptrac.readNextNPS(1e9));
+  }
+  CollectingVisitor visitor;
+  EXPECT_EQ(ptrac.visit(visitor), nbHistories - 40);
+  EXPECT_EQ(visitor.npsList.front(), 41);
+  EXPECT_FALSE(ptrac.readNextNPS(1e9));
+}
+
+TEST_F(HistoryVisitorTest, VisitHistoriesOfAnyReader)
+{
+  MCNPPTRACBinary binary(path);
+  CollectingVisitor fromBinary;
+  EXPECT_EQ(visitHistories(binary, fromBinary), nbHistories);
+
+  MCNPPTRACMmap mmap(path);
+  CollectingVisitor fromMmap;
+  mmap.visit(fromMmap);
+  ASSERT_EQ(fromBinary.histories.size(), fromMmap.histories.size());
+  EXPECT_EQ(fromBinary.npsList, fromMmap.npsList);
+  for (std::size_t i = 0; i < fromMmap.histories.size(); i++)
+  {
+    expectSameHistory(fromMmap.histories[i], fromBinary.histories[i]);
+  }
+}
+
+TEST_F(HistoryVisitorTest, VisitHistoriesWithNoEventLeft)
+{
+  // no particle goes through the cell, every history is still visited
+  const EventProjection projection = EventProjection::pulses({999999});
+  MCNPPTRACBinary binary(path);
+  binary.setProjection(projection);
+  CollectingVisitor fromBinary;
+  EXPECT_EQ(visitHistories(binary, fromBinary), nbHistories);
+
+  MCNPPTRACMmap mmap(path);
+  mmap.setProjection(projection);
+  CollectingVisitor fromMmap;
+  EXPECT_EQ(mmap.visit(fromMmap), nbHistories);
+  ASSERT_EQ(fromBinary.npsList.size(), static_cast<std::size_t>(nbHistories));
+  EXPECT_EQ(fromBinary.npsList, fromMmap.npsList);
+  EXPECT_EQ(fromBinary.npsList.back(), nbHistories);
+  for (auto const &history : fromBinary.histories)
+  {
+    EXPECT_EQ(history.nbEvents(), 0u);
+  }
+}
+
+TEST_F(HistoryVisitorTest, EventColumnsOfChunks)
+{
+  MCNPPTRACMmap reader(path);
+  MCNPPTRACMmap visited(path);
+  EventColumns columns;
+  long nbChunks = 0;
+  while (visited.visit(columns, visited.getNPSRead() + 99) > 0)
+  {
+    nbChunks++;
+    // the chunk holds the next 100 histories one after the other
+    std::size_t particle = 0;
+    for (int i = 0; i < 100 && reader.readNextNPS(1e9); i++)
+    {
+      for (auto const &parHist : reader.getNPSHistory())
+      {
+        ASSERT_LT(particle, columns.nbParticles());
+        const std::size_t first = columns.particleOffsets[particle];
+        ASSERT_EQ(columns.particleOffsets[particle + 1] - first, parHist.size());
+        for (std::size_t e = 0; e < parHist.size(); e++)
+        {
+          const Event event = parHist[e];
+          EXPECT_EQ(columns.nps[first + e], event.nps);
+          EXPECT_EQ(columns.eventID[first + e], event.eventID);
+          EXPECT_EQ(columns.cellID[first + e], event.cellID);
+          EXPECT_EQ(columns.x[first + e], event.pos[0]);
+          EXPECT_EQ(columns.z[first + e], event.pos[2]);
+          EXPECT_EQ(columns.energy[first + e], event.energy);
+          EXPECT_EQ(columns.time[first + e], event.time);
+        }
+        particle++;
+      }
+    }
+    EXPECT_EQ(particle, columns.nbParticles());
+    EXPECT_EQ(columns.particleOffsets.back(), columns.nbEvents());
+    columns.clear();
+  }
+  EXPECT_EQ(nbChunks, (nbHistories + 99) / 100);
+  EXPECT_FALSE(reader.readNextNPS(1e9));
+}
+
+TEST_F(HistoryVisitorTest, PulseVisitorMatchesPulseBuilder)
+{
+  const std::vector<long> cells = {601, 602, 603};
+  MCNPPTRACMmap reader(path);
+  PulseBuilder builder{DetectorCells(cells)};
+  std::vector<Pulse> expected;
+  while (reader.readNextNPS(1e9))
+  {
+    for (auto const &parHist : reader.getNPSHistory())
+    {
+      builder.build(parHist, expected);
+    }
+  }
+  ASSERT_FALSE(expected.empty());
+
+  MCNPPTRACMmap visited(path);
+  VectorPulseWriter writer;
+  PulseVisitor visitor(DetectorCells(cells), writer);
+  visited.visit(visitor);
+  EXPECT_EQ(visitor.getNbPulses(), expected.size());
+  ASSERT_EQ(writer.pulses.size(), expected.size());
+  for (std::size_t i = 0; i < expected.size(); i++)
+  {
+    EXPECT_EQ(writer.pulses[i].nps, expected[i].nps);
+    EXPECT_EQ(writer.pulses[i].cellID, expected[i].cellID);
+    EXPECT_EQ(writer.pulses[i].startPos, expected[i].startPos);
+    EXPECT_EQ(writer.pulses[i].endPos, expected[i].endPos);
+    EXPECT_EQ(writer.pulses[i].pos, expected[i].pos);
+    EXPECT_EQ(writer.pulses[i].time, expected[i].time);
+    EXPECT_EQ(writer.pulses[i].energy, expected[i].energy);
+  }
+}
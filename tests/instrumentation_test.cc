@@ -0,0 +1,118 @@
+/**
+* @file instrumentation_test.cc
+*
+*
+* @brief Test the counters, stage timers and reports
+*
+* @version 1.1
+*/
+#include "instrumentation.hh"
+#include "parallelparser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <sstream>
+#include <thread>
+
+using namespace Instrumentation;
+
+class InstrumentationTest : public ::testing::Test
+{
+public:
+  const std::string path = "instrumentation_test.ptrac";
+  const long nbHistories = 100;
+
+  void SetUp()
+  {
+    reset();
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3));
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+
+  template <typename Reader>
+  std::vector<uint64_t> countReading()
+  {
+    reset();
+    Reader ptrac(path);
+    while (ptrac.readNextNPS(1e9))
+    {
+    }
+    std::vector<uint64_t> counts;
+    for (int c = 0; c < NbCounters; c++)
+    {
+      counts.push_back(get(Counter(c)));
+    }
+    return counts;
+  }
+};
+
+TEST_F(InstrumentationTest, Counters)
+{
+  add(Events, 3);
+  add(Events, 4);
+  add(Pulses, 1);
+  EXPECT_EQ(get(Events), enabled ? 7 : 0);
+  EXPECT_EQ(get(Pulses), enabled ? 1 : 0);
+  EXPECT_EQ(get(Bytes), 0);
+  reset();
+  EXPECT_EQ(get(Events), 0);
+}
+
+TEST_F(InstrumentationTest, Timers)
+{
+  {
+    ScopedTimer timer(Build);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  if (enabled)
+  {
+    EXPECT_GE(nanoseconds(Build), 2000000);
+  }
+  EXPECT_EQ(nanoseconds(Write), 0);
+}
+
+TEST_F(InstrumentationTest, ReadersCountTheSame)
+{
+  const std::vector<uint64_t> binary = countReading<MCNPPTRACBinary>();
+  const std::vector<uint64_t> mmap = countReading<MCNPPTRACMmap>();
+  const std::vector<uint64_t> parallel = countReading<MCNPPTRACParallel>();
+  EXPECT_EQ(mmap, binary);
+  EXPECT_EQ(parallel, binary);
+  if (enabled)
+  {
+    // 1 + nps % 3 particles of 4 events each
+    EXPECT_EQ(binary[Histories], nbHistories);
+    EXPECT_EQ(binary[Particles], 200);
+    EXPECT_EQ(binary[Events], 4 * 200);
+    EXPECT_EQ(binary[Records], nbHistories + 4 * 200);
+    EXPECT_EQ(binary[Pulses], 0);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    EXPECT_GT(binary[Bytes], 0);
+    EXPECT_LT(binary[Bytes], static_cast<uint64_t>(file.tellg()));
+  }
+}
+
+TEST_F(InstrumentationTest, Reports)
+{
+  add(Bytes, 3 << 20);
+  add(Histories, 30);
+  std::ostringstream json;
+  writeJSON(json, 1.5, 42);
+  EXPECT_NE(json.str().find("\"allocations\": 42"), std::string::npos);
+  EXPECT_NE(json.str().find("\"read_wait\""), std::string::npos);
+  EXPECT_NE(json.str().find("\"histories\""), std::string::npos);
+  EXPECT_EQ(json.str().front(), '{');
+
+  std::ostringstream line;
+  writeThroughput(line, 30, 2.0);
+  EXPECT_EQ(line.str(), enabled ? "NPS = 30, 1.5 MB/s, 15 histories/s\n" : "NPS = 30\n");
+}
@@ -0,0 +1,172 @@
+/**
+* @file mmapparser_test.cc
+*
+*
+* @brief Test of memory-mapped PTRAC file parser
+*
+* @version 1.1
+*/
+#include "mmapparser.hh"
+#include "parallelparser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class MCNPtestPtracMmap : public ::testing::Test
+{
+public:
+  const std::string path = "mmapparser_test.ptrac";
+  const long nbHistories = 50;
+
+  void SetUp()
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3));
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+};
+
+TEST_F(MCNPtestPtracMmap, ReadFirstData)
+{
+  MCNPPTRACMmap ptrac(path);
+  ASSERT_TRUE(ptrac.readNextNPS(1000));
+  const NPSHistory &record = ptrac.getNPSHistory();
+  EXPECT_EQ(record.size(), 2);
+
+  ParticleHistory parHist = record[0];
+  EXPECT_EQ(parHist.size(), 4);
+  const auto beg = parHist.begin();
+  EXPECT_EQ(beg->nps, 1);
+  EXPECT_EQ(beg->eventID, 2030);
+  EXPECT_EQ(beg->cellID, 602);
+  EXPECT_DOUBLE_EQ(beg->pos[1], 2.0);
+  EXPECT_DOUBLE_EQ(beg->energy, 1.0);
+  EXPECT_DOUBLE_EQ(beg->time, 1.0e6);
+
+  parHist = record[1];
+  const auto endd = parHist.rbegin();
+  EXPECT_EQ(endd->eventID, 5000);
+  EXPECT_EQ(endd->cellID, 603);
+  EXPECT_DOUBLE_EQ(endd->pos[0], 2.5);
+  EXPECT_DOUBLE_EQ(endd->time, 1.0e6 + 13.0);
+}
+
+TEST_F(MCNPtestPtracMmap, MatchesStreamParser)
+{
+  MCNPPTRACMmap mmapped(path);
+  MCNPPTRACBinary streamed(path);
+  long histories = 0;
+  while (streamed.readNextNPS(1000))
+  {
+    ASSERT_TRUE(mmapped.readNextNPS(1000));
+    const NPSHistory &expected = streamed.getNPSHistory();
+    const NPSHistory &actual = mmapped.getNPSHistory();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+    {
+      ASSERT_EQ(actual[i].size(), expected[i].size());
+      auto a = actual[i].begin();
+      for (auto e = expected[i].begin(); e != expected[i].end(); e++, a++)
+      {
+        EXPECT_EQ(a->nps, e->nps);
+        EXPECT_EQ(a->eventID, e->eventID);
+        EXPECT_EQ(a->cellID, e->cellID);
+        EXPECT_EQ(a->pos, e->pos);
+        EXPECT_EQ(a->energy, e->energy);
+        EXPECT_EQ(a->weight, e->weight);
+        EXPECT_EQ(a->time, e->time);
+      }
+    }
+    histories++;
+  }
+  EXPECT_EQ(histories, nbHistories);
+  EXPECT_FALSE(mmapped.readNextNPS(1000));
+}
+
+TEST_F(MCNPtestPtracMmap, MaxReadNPS)
+{
+  MCNPPTRACMmap ptrac(path);
+  long histories = 0;
+  while (ptrac.readNextNPS(9))
+  {
+    histories++;
+  }
+  EXPECT_EQ(histories, 10);
+  EXPECT_EQ(ptrac.getNPSHistory()[0].begin()->nps, 10);
+}
+
+TEST(MCNPPTRACRecord, MismatchedRecordLength)
+{
+  const char bytes[] = {4, 0, 0, 0, 1, 2, 3, 4, 5, 0, 0, 0};
+  const char *cursor = bytes;
+  std::size_t length;
+  EXPECT_THROW(nextRecord(cursor, bytes + sizeof(bytes), length), std::logic_error);
+  cursor = bytes;
+  EXPECT_THROW(nextRecord(cursor, bytes + 6, length), std::logic_error);
+}
+
+TEST(MCNPPTRACMmapTest, MissingFileThrows)
+{
+  EXPECT_THROW(MCNPPTRACMmap("mmapparser_test.missing"), std::invalid_argument);
+  EXPECT_THROW(MCNPPTRACParallel("mmapparser_test.missing"), std::invalid_argument);
+}
+
+TEST_F(MCNPtestPtracMmap, HistoryStorageIsReused)
+{
+  MCNPPTRACMmap ptrac(path);
+  // warm up with the largest history, 3 particles
+  while (ptrac.readNextNPS(1000) && ptrac.getNPSHistory().size() < 3)
+  {
+  }
+  const NPSHistory &record = ptrac.getNPSHistory();
+  const double *timeColumn = record.time.data();
+  const long *cellColumn = record.cellID.data();
+  while (ptrac.readNextNPS(1000))
+  {
+    EXPECT_EQ(record.time.data(), timeColumn);
+    EXPECT_EQ(record.cellID.data(), cellColumn);
+    EXPECT_EQ(record.nbEvents(), 4 * record.size());
+  }
+}
+
+TEST(NPSHistoryTest, ColumnsAndParticles)
+{
+  NPSHistory history;
+  EXPECT_TRUE(history.empty());
+  history.addEvent(Event{7, 2030, 602, {1, 2, 3}, 1.5, 1.0, 10});
+  history.addEvent(Event{7, 5000, 601, {4, 5, 6}, 0.5, 1.0, 11});
+  history.endParticle();
+  history.addEvent(Event{7, 2030, 603, {7, 8, 9}, 2.5, 0.5, 12});
+  history.endParticle();
+
+  ASSERT_EQ(history.size(), 2);
+  EXPECT_EQ(history.nbEvents(), 3);
+  EXPECT_EQ(history[0].size(), 2);
+  EXPECT_EQ(history[1].first(), 2);
+  EXPECT_EQ(history[0].rbegin()->cellID, 601);
+  EXPECT_EQ(history[1][0].pos, (std::array<double, 3>{7, 8, 9}));
+
+  std::size_t particles = 0;
+  for (auto const &parHist : history)
+  {
+    for (auto const &event : parHist)
+    {
+      EXPECT_EQ(event.nps, 7);
+    }
+    particles++;
+  }
+  EXPECT_EQ(particles, 2);
+
+  history.clear();
+  EXPECT_TRUE(history.empty());
+  EXPECT_EQ(history.nbEvents(), 0);
+  EXPECT_GE(history.x.capacity(), 3);
+}
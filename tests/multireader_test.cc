@@ -0,0 +1,155 @@
+/**
+* @file multireader_test.cc
+*
+*
+* @brief Test reading the PTRAC files of several jobs as one
+*
+* @version 1.1
+*/
+#include "multireader.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class MultiReaderTest : public ::testing::Test
+{
+public:
+  const std::string directory = "multireader_test.jobs";
+  const std::vector<long> nbHistories = {120, 1, 75};
+  std::vector<std::string> paths;
+
+  void SetUp()
+  {
+    mkdir(directory.c_str(), 0755);
+    for (std::size_t job = 0; job < nbHistories.size(); job++)
+    {
+      const std::string jobDirectory = directory + "/job.seq-" + std::to_string(job);
+      mkdir(jobDirectory.c_str(), 0755);
+      paths.push_back(jobDirectory + "/ptrac");
+      SyntheticPTRACWriter writer(paths.back());
+      for (long nps = 1; nps <= nbHistories[job]; nps++)
+      {
+        // every job starts from NPS 1, with a different number of particles
+        writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + (nps + job) % 3));
+      }
+      writer.close();
+    }
+  }
+
+  void TearDown()
+  {
+    for (auto const &path : paths)
+    {
+      std::remove(path.c_str());
+      rmdir(path.substr(0, path.rfind('/')).c_str());
+    }
+    rmdir(directory.c_str());
+  }
+};
+
+TEST_F(MultiReaderTest, ExpandsPatterns)
+{
+  EXPECT_EQ(expandPTRACPaths({directory + "/job.seq-*/ptrac"}), paths);
+  EXPECT_EQ(expandPTRACPaths({paths[2], paths[0]}), std::vector<std::string>({paths[2], paths[0]}));
+  // no match: kept, so that opening it reports the missing file
+  EXPECT_EQ(expandPTRACPaths({directory + "/none.*"}), std::vector<std::string>({directory + "/none.*"}));
+}
+
+TEST_F(MultiReaderTest, RenumbersNPS)
+{
+  MCNPPTRACMulti multi(paths, 2, 16, 2);
+  EXPECT_EQ(multi.getNbFiles(), 3);
+  long offset = 0;
+  for (std::size_t job = 0; job < paths.size(); job++)
+  {
+    std::unique_ptr<MCNPPTRAC> single = openPTRAC(paths[job]);
+    while (single->readNextNPS(1e9))
+    {
+      ASSERT_TRUE(multi.readNextNPS(1e9));
+      EXPECT_EQ(multi.getCurrentFile(), job);
+      const NPSHistory &expected = single->getNPSHistory();
+      const NPSHistory &actual = multi.getNPSHistory();
+      ASSERT_EQ(actual.nbEvents(), expected.nbEvents());
+      for (std::size_t i = 0; i < expected.nbEvents(); i++)
+      {
+        EXPECT_EQ(actual.nps[i], expected.nps[i] + offset);
+      }
+      EXPECT_EQ(actual.energy, expected.energy);
+      EXPECT_EQ(actual.time, expected.time);
+    }
+    offset += nbHistories[job];
+  }
+  EXPECT_FALSE(multi.readNextNPS(1e9));
+  EXPECT_FALSE(multi.readNextNPS(1e9));
+  EXPECT_EQ(multi.getNPSRead(), 196);
+  EXPECT_EQ(multi.getCurrentFile(), 3);
+}
+
+TEST_F(MultiReaderTest, RenumberingIgnoresProjection)
+{
+  // the last histories of the first file miss the detector cell
+  const std::string missing = directory + "/missing.ptrac";
+  {
+    SyntheticPTRACWriter writer(missing);
+    for (long nps = 1; nps <= 10; nps++)
+    {
+      SyntheticHistory history = SyntheticPTRACWriter::makeHistory(nps, 1);
+      for (auto &event : history.particles.front())
+        event.cellID = nps > 7 ? 700 : event.cellID;
+      writer.writeHistory(history);
+    }
+    writer.close();
+  }
+  for (auto const &projection : {EventProjection(), EventProjection::pulses({601})})
+  {
+    MCNPPTRACMulti multi({missing, paths[1]}, 2, 4, 2);
+    multi.setProjection(projection);
+    std::vector<long> npsList;
+    while (multi.readNextNPS(1e9))
+      npsList.push_back(multi.getNPSHistory().historyNPS);
+    ASSERT_EQ(npsList.size(), 11u);
+    EXPECT_EQ(npsList.back(), 11);
+    EXPECT_TRUE(multi.getNPSHistory().nps.size() == 0 || multi.getNPSHistory().nps.front() == 11);
+  }
+  std::remove(missing.c_str());
+}
+
+TEST_F(MultiReaderTest, OneThreadManyFiles)
+{
+  // the files wait for their turn on the only thread
+  MCNPPTRACMulti multi(paths, 1, 4, 1);
+  long lastNPS = 0;
+  while (multi.readNextNPS(1e9))
+  {
+    const long nps = multi.getNPSHistory().nps.front();
+    EXPECT_GT(nps, lastNPS);
+    lastNPS = nps;
+  }
+  EXPECT_EQ(lastNPS, 196);
+}
+
+TEST_F(MultiReaderTest, MaxReadNPS)
+{
+  MCNPPTRACMulti multi(paths, 2, 8, 2);
+  long histories = 0;
+  while (multi.readNextNPS(129))
+  {
+    histories++;
+  }
+  EXPECT_EQ(histories, 130);
+}
+
+TEST_F(MultiReaderTest, StopsEarly)
+{
+  // destroying the reader stops the tasks blocked on full queues
+  MCNPPTRACMulti multi(paths, 3, 2, 1);
+  ASSERT_TRUE(multi.readNextNPS(1e9));
+}
+
+TEST_F(MultiReaderTest, MissingFile)
+{
+  EXPECT_THROW(MCNPPTRACMulti({paths[0], directory + "/missing"}), std::invalid_argument);
+  EXPECT_THROW(MCNPPTRACMulti(std::vector<std::string>()), std::invalid_argument);
+}
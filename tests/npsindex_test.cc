@@ -0,0 +1,141 @@
+/**
+* @file npsindex_test.cc
+*
+*
+* @brief Test of the NPS offset index and random access
+*
+* @version 1.1
+*/
+#include "parallelparser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class NPSIndexTest : public ::testing::Test
+{
+public:
+  const std::string path = "npsindex_test.ptrac";
+  const long nbHistories = 3000;
+
+  void SetUp()
+  {
+    std::remove(NPSIndex::sidecarPath(path).c_str());
+    writeFile(nbHistories);
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+    std::remove(NPSIndex::sidecarPath(path).c_str());
+  }
+
+  // histories are numbered 3, 6, 9, ...
+  void writeFile(long histories)
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long i = 1; i <= histories; i++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(3 * i, 1 + i % 2));
+    }
+    writer.close();
+  }
+};
+
+TEST_F(NPSIndexTest, BuildAndReload)
+{
+  {
+    MCNPPTRACMmap ptrac(path);
+    NPSIndex const &index = ptrac.loadIndex(100);
+    EXPECT_EQ(index.getNbHistories(), nbHistories);
+    EXPECT_EQ(index.getEntries().size(), 30);
+    EXPECT_EQ(index.getFirstNPS(), 3);
+    EXPECT_EQ(index.getLastNPS(), 3 * nbHistories);
+  }
+  NPSIndex reloaded;
+  ASSERT_TRUE(reloaded.load(NPSIndex::sidecarPath(path), FileStamp::of(path)));
+  EXPECT_EQ(reloaded.getStride(), 100);
+  EXPECT_EQ(reloaded.getNbHistories(), nbHistories);
+  EXPECT_EQ(reloaded.floor(2), nullptr);
+  EXPECT_EQ(reloaded.floor(3)->nps, 3);
+  EXPECT_EQ(reloaded.floor(3 * 150)->nps, 3 * 101);
+}
+
+TEST_F(NPSIndexTest, StaleSidecarIsRebuilt)
+{
+  {
+    MCNPPTRACMmap ptrac(path);
+    ptrac.loadIndex();
+  }
+  writeFile(nbHistories / 2);
+  NPSIndex stale;
+  EXPECT_FALSE(stale.load(NPSIndex::sidecarPath(path), FileStamp::of(path)));
+
+  MCNPPTRACMmap ptrac(path);
+  EXPECT_EQ(ptrac.loadIndex().getNbHistories(), nbHistories / 2);
+}
+
+TEST_F(NPSIndexTest, CorruptSidecarIsRebuilt)
+{
+  const std::string sidecar = NPSIndex::sidecarPath(path);
+  auto overwrite = [&sidecar](std::size_t offset, int64_t value) {
+    std::fstream file(sidecar, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  };
+  // nbEntries is the last field of the 72-byte header, the entries follow
+  const std::size_t nbEntriesOffset = 64;
+  const std::size_t firstEntry = 72;
+  for (auto corrupt : std::vector<std::pair<std::size_t, int64_t>>{
+           {nbEntriesOffset, int64_t(1) << 60},       // more entries than the sidecar holds
+           {nbEntriesOffset, -1},
+           {firstEntry + 8, FileStamp::of(path).size}, // offset past the end of the PTRAC file
+           {firstEntry + 8, 0},                        // offset in the header of the PTRAC file
+           {firstEntry + 16 + 8, 1}})                  // offsets out of order
+  {
+    long firstHistory;
+    {
+      MCNPPTRACMmap ptrac(path);
+      firstHistory = ptrac.loadIndex(100).getEntries().front().offset;
+    }
+    overwrite(corrupt.first, corrupt.second);
+    NPSIndex index;
+    EXPECT_FALSE(index.load(sidecar, FileStamp::of(path), firstHistory)) << corrupt.first << " " << corrupt.second;
+
+    MCNPPTRACMmap ptrac(path);
+    EXPECT_EQ(ptrac.loadIndex(100).getNbHistories(), nbHistories);
+    ASSERT_TRUE(ptrac.seekToNPS(3 * 150));
+    ASSERT_TRUE(ptrac.readNextNPS(LONG_MAX));
+    EXPECT_EQ(ptrac.getNPSHistory()[0].begin()->nps, 3 * 150);
+  }
+}
+
+TEST_F(NPSIndexTest, SeekToNPS)
+{
+  MCNPPTRACMmap ptrac(path);
+  ptrac.loadIndex(64);
+  for (long nps : {3L, 4L, 3 * 64L, 3 * 65L, 3 * 1000L + 1, 3 * nbHistories})
+  {
+    ASSERT_TRUE(ptrac.seekToNPS(nps));
+    ASSERT_TRUE(ptrac.readNextNPS(LONG_MAX));
+    EXPECT_EQ(ptrac.getNPSHistory()[0].begin()->nps, (nps + 2) / 3 * 3);
+  }
+  EXPECT_FALSE(ptrac.seekToNPS(3 * nbHistories + 1));
+  EXPECT_FALSE(ptrac.readNextNPS(LONG_MAX));
+}
+
+TEST_F(NPSIndexTest, RangeRead)
+{
+  MCNPPTRACParallel ptrac(path, 3, 16);
+  ASSERT_TRUE(ptrac.setNPSRange(300, 600));
+  long histories = 0;
+  long nps = 297;
+  while (ptrac.readNextNPS(LONG_MAX))
+  {
+    nps += 3;
+    EXPECT_EQ(ptrac.getNPSHistory()[0].begin()->nps, nps);
+    histories++;
+  }
+  EXPECT_EQ(histories, 100);
+  EXPECT_FALSE(ptrac.setNPSRange(100000, 200000));
+  EXPECT_FALSE(ptrac.readNextNPS(LONG_MAX));
+}
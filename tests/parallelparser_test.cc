@@ -0,0 +1,84 @@
+/**
+* @file parallelparser_test.cc
+*
+*
+* @brief Test of multi-threaded PTRAC file parser
+*
+* @version 1.1
+*/
+#include "parallelparser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class MCNPtestPtracParallel : public ::testing::TestWithParam<std::tuple<unsigned, std::size_t>>
+{
+public:
+  const std::string path = "parallelparser_test.ptrac";
+  const long nbHistories = 200;
+
+  void SetUp()
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(3 * nps, 1 + nps % 4));
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+};
+
+TEST_P(MCNPtestPtracParallel, MatchesSerialParser)
+{
+  MCNPPTRACMmap serial(path);
+  MCNPPTRACParallel parallel(path, std::get<0>(GetParam()), std::get<1>(GetParam()));
+  long histories = 0;
+  while (serial.readNextNPS(1000))
+  {
+    ASSERT_TRUE(parallel.readNextNPS(1000));
+    const NPSHistory &expected = serial.getNPSHistory();
+    const NPSHistory &actual = parallel.getNPSHistory();
+    ASSERT_EQ(actual.size(), expected.size());
+    for (std::size_t i = 0; i < expected.size(); i++)
+    {
+      ASSERT_EQ(actual[i].size(), expected[i].size());
+      auto a = actual[i].begin();
+      for (auto e = expected[i].begin(); e != expected[i].end(); e++, a++)
+      {
+        EXPECT_EQ(a->nps, e->nps);
+        EXPECT_EQ(a->eventID, e->eventID);
+        EXPECT_EQ(a->cellID, e->cellID);
+        EXPECT_EQ(a->pos, e->pos);
+        EXPECT_EQ(a->energy, e->energy);
+        EXPECT_EQ(a->time, e->time);
+      }
+    }
+    histories++;
+  }
+  EXPECT_EQ(histories, nbHistories);
+  EXPECT_FALSE(parallel.readNextNPS(1000));
+  EXPECT_FALSE(parallel.readNextNPS(1000));
+}
+
+TEST_P(MCNPtestPtracParallel, MaxReadNPS)
+{
+  MCNPPTRACParallel ptrac(path, std::get<0>(GetParam()), std::get<1>(GetParam()));
+  long histories = 0;
+  while (ptrac.readNextNPS(41))
+  {
+    histories++;
+  }
+  EXPECT_EQ(histories, 42);
+  EXPECT_EQ(ptrac.getNPSHistory()[0].begin()->nps, 3 * 42);
+}
+
+INSTANTIATE_TEST_SUITE_P(ThreadsAndBatches, MCNPtestPtracParallel,
+                         ::testing::Values(std::make_tuple(1u, 4096),
+                                           std::make_tuple(4u, 1),
+                                           std::make_tuple(3u, 7),
+                                           std::make_tuple(8u, 64)));
@@ -0,0 +1,122 @@
+/**
+* @file pipeline_test.cc
+*
+*
+* @brief Test of the streaming pulse pipeline
+*
+* @version 1.1
+*/
+#include "parallelparser.hh"
+#include "pipeline.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class PipelineTest : public ::testing::Test
+{
+public:
+  const std::string path = "pipeline_test.ptrac";
+  const long nbHistories = 500;
+
+  void SetUp()
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3));
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+
+  // pulses written one by one, the way main used to
+  std::string sequentialPulses(long maxPulses)
+  {
+    MCNPPTRACMmap ptrac(path);
+    std::ostringstream text;
+    long pulseIdx = 0;
+    while (pulseIdx < maxPulses && ptrac.readNextNPS(1e9))
+    {
+      for (auto const &parHist : ptrac.getNPSHistory())
+      {
+        Pulse pulse(parHist);
+        if (pulse.energy <= 0)
+          continue;
+        text << pulse << '\n';
+        if (++pulseIdx >= maxPulses)
+          break;
+      }
+    }
+    return text.str();
+  }
+};
+
+TEST_F(PipelineTest, MatchesSequentialOutput)
+{
+  MCNPPTRACParallel ptrac(path, 2, 16);
+  std::ostringstream text;
+  TextPulseWriter writer(text, false, 1000);
+  PipelineOptions options;
+  options.batchSize = 7;
+  options.nbBatches = 2;
+  PulsePipeline pipeline(ptrac, writer, options);
+  EXPECT_EQ(pipeline.run(), 1001);
+  EXPECT_EQ(text.str(), sequentialPulses(1e9));
+}
+
+TEST_F(PipelineTest, StopsAtMaxPulses)
+{
+  MCNPPTRACMmap ptrac(path);
+  std::ostringstream text;
+  TextPulseWriter writer(text, false);
+  PipelineOptions options;
+  options.maxPulses = 123;
+  options.batchSize = 10;
+  options.nbBatches = 1;
+  PulsePipeline pipeline(ptrac, writer, options);
+  EXPECT_EQ(pipeline.run(), 123);
+  EXPECT_EQ(text.str(), sequentialPulses(123));
+}
+
+TEST_F(PipelineTest, ParseErrorIsRethrown)
+{
+  // cut the file in the middle of a history
+  std::ifstream file(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+  std::ofstream rewrite(path, std::ios::binary | std::ios::trunc);
+  rewrite.write(bytes.data(), bytes.size() - 30);
+  rewrite.close();
+
+  MCNPPTRACMmap ptrac(path);
+  std::ostringstream text;
+  TextPulseWriter writer(text);
+  PulsePipeline pipeline(ptrac, writer);
+  EXPECT_THROW(pipeline.run(), std::logic_error);
+}
+
+TEST_F(PipelineTest, SeveralDetectorCells)
+{
+  MCNPPTRACMmap ptrac(path);
+  std::ostringstream text;
+  TextPulseWriter writer(text, false, 1000, true);
+  PipelineOptions options;
+  // banks in 602 deposit 0.25, collisions in 601 deposit 0.5
+  options.detectorCells = {601, 602};
+  PulsePipeline pipeline(ptrac, writer, options);
+  EXPECT_EQ(pipeline.run(), 2 * 1001);
+
+  std::istringstream lines(text.str());
+  std::string line;
+  long nbLines[2] = {0, 0};
+  while (std::getline(lines, line))
+  {
+    nbLines[std::stol(line.substr(line.size() - 10)) - 601]++;
+  }
+  EXPECT_EQ(nbLines[0], 1001);
+  EXPECT_EQ(nbLines[1], 1001);
+}
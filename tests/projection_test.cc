@@ -0,0 +1,233 @@
+/**
+* @file projection_test.cc
+*
+*
+* @brief Test decoding only the requested fields, event types and particles
+*
+* @version 1.1
+*/
+#include "multireader.hh"
+#include "parallelparser.hh"
+#include "pulsebuilder.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class ProjectionTest : public ::testing::Test
+{
+public:
+  const std::string path = "projection_test.ptrac";
+  const long nbHistories = 300;
+
+  void SetUp()
+  {
+    // one particle in three never reaches the detector cell 601
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      SyntheticHistory history = SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3);
+      for (std::size_t p = 0; p < history.particles.size(); p++)
+      {
+        if ((nps + p) % 3 == 0)
+        {
+          for (auto &event : history.particles[p])
+          {
+            event.cellID = event.cellID == 601 ? 700 : event.cellID;
+          }
+        }
+      }
+      writer.writeHistory(history);
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+
+  /// the histories read with the projection, compared to a full decode
+  template <typename Reader>
+  void expectProjected(EventProjection const &projection)
+  {
+    MCNPPTRACMmap full(path);
+    Reader projected(path);
+    projected.setProjection(projection);
+    long histories = 0;
+    while (full.readNextNPS(1e9))
+    {
+      ASSERT_TRUE(projected.readNextNPS(1e9));
+      expectSameHistory(full.getNPSHistory(), projected.getNPSHistory(), projected.getProjection());
+      histories++;
+    }
+    EXPECT_EQ(histories, nbHistories);
+    EXPECT_FALSE(projected.readNextNPS(1e9));
+  }
+
+  static void expectSameHistory(NPSHistory const &full, NPSHistory const &actual, EventProjection const &projection)
+  {
+    // the full history filtered the slow way
+    std::vector<Event> expected;
+    std::size_t nbParticles = 0;
+    for (auto particle : full)
+    {
+      bool inCells = projection.cells.empty();
+      for (auto event : particle)
+      {
+        inCells = inCells || projection.keepsCell(event.cellID);
+      }
+      const std::size_t before = expected.size();
+      for (auto event : particle)
+      {
+        if (inCells && projection.keepsType(eventType(event.eventID)))
+        {
+          expected.push_back(event);
+        }
+      }
+      nbParticles += expected.size() > before;
+    }
+
+    ASSERT_EQ(actual.size(), nbParticles);
+    ASSERT_EQ(actual.nbEvents(), expected.size());
+    const bool cell = projection.fields & EventProjection::Cell;
+    const bool position = projection.fields & EventProjection::Position;
+    const bool energy = projection.fields & EventProjection::Energy;
+    const bool weight = projection.fields & EventProjection::Weight;
+    const bool time = projection.fields & EventProjection::Time;
+    for (std::size_t i = 0; i < expected.size(); i++)
+    {
+      EXPECT_EQ(actual.nps[i], expected[i].nps);
+      EXPECT_EQ(actual.eventID[i], expected[i].eventID);
+      EXPECT_EQ(actual.cellID[i], cell ? expected[i].cellID : -1);
+      EXPECT_EQ(actual.x[i], position ? expected[i].pos[0] : 0);
+      EXPECT_EQ(actual.z[i], position ? expected[i].pos[2] : 0);
+      EXPECT_EQ(actual.energy[i], energy ? expected[i].energy : 0);
+      EXPECT_EQ(actual.weight[i], weight ? expected[i].weight : 0);
+      EXPECT_EQ(actual.time[i], time ? expected[i].time : 0);
+    }
+  }
+
+  static EventProjection onlyFields(unsigned fields)
+  {
+    EventProjection projection;
+    projection.fields = fields;
+    return projection;
+  }
+
+  static EventProjection withoutTypes(unsigned types)
+  {
+    EventProjection projection;
+    projection.eventTypes &= ~types;
+    return projection;
+  }
+};
+
+TEST_F(ProjectionTest, Identity)
+{
+  EXPECT_TRUE(EventProjection().isIdentity());
+  EXPECT_FALSE(EventProjection::pulses({601}).isIdentity());
+  EXPECT_FALSE(onlyFields(EventProjection::Energy).isIdentity());
+  expectProjected<MCNPPTRACBinary>(EventProjection());
+  expectProjected<MCNPPTRACMmap>(EventProjection());
+}
+
+TEST_F(ProjectionTest, Fields)
+{
+  for (unsigned fields : {0u, unsigned(EventProjection::Energy), unsigned(EventProjection::Cell | EventProjection::Time),
+                          unsigned(EventProjection::AllFields & ~EventProjection::Weight)})
+  {
+    expectProjected<MCNPPTRACBinary>(onlyFields(fields));
+    expectProjected<MCNPPTRACMmap>(onlyFields(fields));
+    expectProjected<MCNPPTRACParallel>(onlyFields(fields));
+  }
+}
+
+TEST_F(ProjectionTest, EventTypes)
+{
+  expectProjected<MCNPPTRACBinary>(withoutTypes(1 << TerEvent));
+  expectProjected<MCNPPTRACMmap>(withoutTypes(1 << TerEvent));
+  // no event left in any particle
+  expectProjected<MCNPPTRACBinary>(withoutTypes((1 << NbEventTypes) - 1));
+  expectProjected<MCNPPTRACMmap>(withoutTypes((1 << NbEventTypes) - 1));
+}
+
+TEST_F(ProjectionTest, Cells)
+{
+  EventProjection projection;
+  projection.cells = {601, 999, 601};
+  expectProjected<MCNPPTRACBinary>(projection);
+  expectProjected<MCNPPTRACMmap>(projection);
+  expectProjected<MCNPPTRACParallel>(projection);
+
+  projection.eventTypes = 1 << ColEvent;
+  projection.fields = EventProjection::Energy;
+  expectProjected<MCNPPTRACBinary>(projection);
+  expectProjected<MCNPPTRACMmap>(projection);
+}
+
+TEST_F(ProjectionTest, SamePulses)
+{
+  const std::vector<long> cells = {601, 700};
+  PulseBuilder builder((DetectorCells(cells)));
+  MCNPPTRACMmap full(path);
+  MCNPPTRACParallel projected(path, 2, 16);
+  projected.setProjection(EventProjection::pulses({601}));
+  std::vector<Pulse> expected, actual;
+  while (full.readNextNPS(1e9))
+  {
+    for (auto particle : full.getNPSHistory())
+    {
+      builder.build(particle, expected);
+    }
+  }
+  // only the pulses of cell 601 are left
+  PulseBuilder detector((DetectorCells({601})));
+  while (projected.readNextNPS(1e9))
+  {
+    for (auto particle : projected.getNPSHistory())
+    {
+      detector.build(particle, actual);
+    }
+  }
+  expected.erase(std::remove_if(expected.begin(), expected.end(), [](Pulse const &p) { return p.cellID != 601; }),
+                 expected.end());
+  ASSERT_EQ(actual.size(), expected.size());
+  ASSERT_GT(actual.size(), 0);
+  for (std::size_t i = 0; i < expected.size(); i++)
+  {
+    EXPECT_EQ(actual[i].nps, expected[i].nps);
+    EXPECT_EQ(actual[i].energy, expected[i].energy);
+    EXPECT_EQ(actual[i].time, expected[i].time);
+    EXPECT_EQ(actual[i].startPos, expected[i].startPos);
+    EXPECT_EQ(actual[i].endPos, expected[i].endPos);
+  }
+}
+
+TEST_F(ProjectionTest, ParallelAfterReading)
+{
+  // the histories decoded ahead are decoded again with the projection
+  MCNPPTRACParallel projected(path, 2, 16);
+  for (int i = 0; i < 20; i++)
+  {
+    ASSERT_TRUE(projected.readNextNPS(1e9));
+  }
+  projected.setProjection(onlyFields(EventProjection::Energy));
+  ASSERT_TRUE(projected.readNextNPS(1e9));
+  EXPECT_EQ(projected.getNPSHistory().nps.front(), 21);
+  EXPECT_EQ(projected.getNPSHistory().time.front(), 0);
+  long histories = 21;
+  while (projected.readNextNPS(1e9))
+  {
+    histories++;
+  }
+  EXPECT_EQ(histories, nbHistories);
+}
+
+TEST_F(ProjectionTest, MultiBeforeReading)
+{
+  MCNPPTRACMulti multi({path, path});
+  multi.setProjection(EventProjection::pulses({601}));
+  ASSERT_TRUE(multi.readNextNPS(1e9));
+  EXPECT_EQ(multi.getNPSHistory().weight.front(), 0);
+  EXPECT_THROW(multi.setProjection(EventProjection()), std::logic_error);
+}
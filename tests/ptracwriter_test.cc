@@ -0,0 +1,88 @@
+/**
+* @file ptracwriter_test.cc
+*
+*
+* @brief Test of the synthetic PTRAC file generator
+*
+* @version 1.1
+*/
+#include "mmapparser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class PTRACWriterTest : public ::testing::Test
+{
+public:
+  const std::string path = "ptracwriter_test.ptrac";
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+};
+
+TEST_F(PTRACWriterTest, RandomHistoriesFollowTheMix)
+{
+  SyntheticMix mix;
+  mix.minParticles = 2;
+  mix.maxParticles = 4;
+  mix.minCollisions = 3;
+  mix.maxCollisions = 3;
+  mix.surfaceFraction = 0.5;
+  EXPECT_EQ(writeSyntheticPTRAC(path, 200, SIZE_MAX, mix), 200);
+
+  MCNPPTRACMmap ptrac(path);
+  long nbHistories = 0, nbSurfaces = 0, nbCollisions = 0;
+  while (ptrac.readNextNPS(1e9))
+  {
+    NPSHistory const &history = ptrac.getNPSHistory();
+    EXPECT_EQ(history.nps.front(), ++nbHistories);
+    EXPECT_GE(history.size(), 2);
+    EXPECT_LE(history.size(), 4);
+    for (auto const &particle : history)
+    {
+      // bank, three steps and termination
+      ASSERT_EQ(particle.size(), 5);
+      EXPECT_TRUE(isBnkEvent(particle.begin()->eventID));
+      EXPECT_EQ(particle.rbegin()->eventID, 5000);
+      for (std::size_t i = 1; i < 4; i++)
+      {
+        nbSurfaces += particle[i].eventID == 3000;
+        nbCollisions += particle[i].eventID == 4000;
+        EXPECT_EQ(particle[i].cellID, mix.detectorCell);
+      }
+    }
+  }
+  EXPECT_EQ(nbHistories, 200);
+  EXPECT_GT(nbSurfaces, 0);
+  EXPECT_GT(nbCollisions, 0);
+}
+
+TEST_F(PTRACWriterTest, StopsAtTheRequestedSize)
+{
+  const std::size_t size = 64 << 10;
+  const long nbHistories = writeSyntheticPTRAC(path, LONG_MAX, size);
+  MappedFile file(path);
+  EXPECT_GE(file.size(), size);
+  EXPECT_LT(file.size(), size + 4096);
+
+  MCNPPTRACMmap ptrac(path);
+  long count = 0;
+  while (ptrac.readNextNPS(1e9))
+    count++;
+  EXPECT_EQ(count, nbHistories);
+}
+
+TEST_F(PTRACWriterTest, SameSeedSameFile)
+{
+  writeSyntheticPTRAC(path, 50, SIZE_MAX);
+  std::string first;
+  {
+    MappedFile file(path);
+    first.assign(file.begin(), file.end());
+  }
+  writeSyntheticPTRAC(path, 50, SIZE_MAX);
+  MappedFile file(path);
+  EXPECT_EQ(std::string(file.begin(), file.end()), first);
+}
@@ -0,0 +1,121 @@
+/**
+* @file pulsebuilder_test.cc
+*
+*
+* @brief Test of the multi-cell pulse builder
+*
+* @version 1.1
+*/
+#include "mmapparser.hh"
+#include "pulsebuilder.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+TEST(DetectorCellsTest, Lookup)
+{
+  DetectorCells cells({610, 601, 605, 601});
+  ASSERT_EQ(cells.size(), 3);
+  EXPECT_EQ(cells[0], 601);
+  EXPECT_EQ(cells.index(601), 0);
+  EXPECT_EQ(cells.index(605), 1);
+  EXPECT_EQ(cells.index(610), 2);
+  EXPECT_EQ(cells.index(602), -1);
+  EXPECT_EQ(cells.index(600), -1);
+  EXPECT_EQ(cells.index(611), -1);
+  EXPECT_EQ(cells.index(-1), -1);
+  EXPECT_EQ(cells.index(0), -1);
+
+  EXPECT_THROW(DetectorCells(std::vector<long>()), std::invalid_argument);
+  EXPECT_THROW(DetectorCells({1, DetectorCells::maxSpan + 1}), std::invalid_argument);
+}
+
+class PulseBuilderTest : public ::testing::Test
+{
+public:
+  const std::string path = "pulsebuilder_test.ptrac";
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+};
+
+TEST_F(PulseBuilderTest, DefaultCellMatchesPulse)
+{
+  SyntheticMix mix;
+  mix.surfaceFraction = 0.3;
+  writeSyntheticPTRAC(path, 300, SIZE_MAX, mix);
+
+  MCNPPTRACMmap ptrac(path);
+  PulseBuilder builder(DetectorCells({defaultDetectorCell}));
+  std::vector<Pulse> pulses;
+  long nbPulses = 0;
+  while (ptrac.readNextNPS(1e9))
+  {
+    for (auto const &parHist : ptrac.getNPSHistory())
+    {
+      Pulse expected(parHist);
+      pulses.clear();
+      builder.build(parHist, pulses);
+      if (expected.energy <= 0)
+      {
+        EXPECT_TRUE(pulses.empty());
+        continue;
+      }
+      ASSERT_EQ(pulses.size(), 1);
+      EXPECT_EQ(pulses[0].nps, expected.nps);
+      EXPECT_EQ(pulses[0].cellID, defaultDetectorCell);
+      EXPECT_EQ(pulses[0].startPos, expected.startPos);
+      EXPECT_EQ(pulses[0].endPos, expected.endPos);
+      EXPECT_EQ(pulses[0].pos, expected.pos);
+      EXPECT_EQ(pulses[0].energy, expected.energy);
+      EXPECT_EQ(pulses[0].time, expected.time);
+      nbPulses++;
+    }
+  }
+  EXPECT_GT(nbPulses, 100);
+}
+
+TEST_F(PulseBuilderTest, OnePulsePerCell)
+{
+  // a particle going through 605, 601, 605 again and 700
+  {
+    SyntheticPTRACWriter writer(path);
+    writer.writeHistory(SyntheticHistory{7, {{
+        Event{7, 2030, 602, {0, 0, 0}, 5.0, 1.0, 100},
+        Event{7, 4000, 605, {1, 0, 0}, 5.0, 1.0, 101},
+        Event{7, 4000, 601, {2, 0, 0}, 4.0, 1.0, 102},
+        Event{7, 4000, 605, {3, 0, 0}, 3.5, 1.0, 103},
+        Event{7, 4000, 700, {4, 0, 0}, 1.5, 1.0, 104},
+        Event{7, 5000, 700, {5, 0, 0}, 1.0, 1.0, 105}}}});
+    writer.close();
+  }
+  MCNPPTRACMmap ptrac(path);
+  ASSERT_TRUE(ptrac.readNextNPS(1e9));
+  PulseBuilder builder(DetectorCells({601, 605, 700}));
+  std::vector<Pulse> pulses;
+  EXPECT_EQ(builder.build(ptrac.getNPSHistory()[0], pulses), 3);
+  ASSERT_EQ(pulses.size(), 3);
+
+  // in the order the particle entered the cells
+  EXPECT_EQ(pulses[0].cellID, 605);
+  EXPECT_DOUBLE_EQ(pulses[0].energy, 1.0 + 2.0);
+  EXPECT_EQ(pulses[0].time, 101);
+  EXPECT_EQ(pulses[0].startPos, std::vector<double>({1, 0, 0}));
+  EXPECT_EQ(pulses[0].endPos, std::vector<double>({4, 0, 0}));
+
+  EXPECT_EQ(pulses[1].cellID, 601);
+  EXPECT_DOUBLE_EQ(pulses[1].energy, 0.5);
+  EXPECT_EQ(pulses[1].time, 102);
+
+  // the termination deposits nothing
+  EXPECT_EQ(pulses[2].cellID, 700);
+  EXPECT_DOUBLE_EQ(pulses[2].energy, 0.5);
+  EXPECT_EQ(pulses[2].pos, std::vector<double>({4.5, 0, 0}));
+
+  // the state is reset between particles
+  pulses.clear();
+  EXPECT_EQ(builder.build(ptrac.getNPSHistory()[0], pulses), 3);
+  EXPECT_DOUBLE_EQ(pulses[0].energy, 3.0);
+}
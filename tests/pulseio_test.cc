@@ -0,0 +1,204 @@
+/**
+* @file pulseio_test.cc
+*
+*
+* @brief Test of the text and binary pulse files
+*
+* @version 1.1
+*/
+#include "pulseio.hh"
+#include "gtest/gtest.h"
+#include <cstring>
+#include <sstream>
+
+class PulseIOTest : public ::testing::TestWithParam<PulseLayout>
+{
+public:
+  std::vector<Pulse> pulses;
+
+  void SetUp()
+  {
+    for (long i = 0; i < 1000; i++)
+    {
+      Pulse p;
+      p.nps = 1000000000000L + i;
+      p.startPos = {0.1 * i, -0.2 * i, 1.0 / (i + 1)};
+      p.endPos = {0.1 * i + 0.01, -0.2 * i, 1.0 / (i + 2)};
+      p.energy = 1.0 / 3.0 + i;
+      // more digits than the text format keeps
+      p.time = 123456789.123456789 + i * 1e-7;
+      pulses.push_back(p);
+    }
+  }
+};
+
+TEST_P(PulseIOTest, RoundTrip)
+{
+  std::stringstream file;
+  BinaryPulseWriter writer(file, GetParam(), 64);
+  for (auto const &p : pulses)
+  {
+    writer.write(p);
+  }
+  writer.flush();
+
+  BinaryPulseReader reader(file);
+  EXPECT_EQ(reader.getLayout(), GetParam());
+  Pulse p;
+  for (auto const &expected : pulses)
+  {
+    ASSERT_TRUE(reader.read(p));
+    EXPECT_EQ(p.nps, expected.nps);
+    EXPECT_EQ(p.startPos, expected.startPos);
+    EXPECT_EQ(p.endPos, expected.endPos);
+    EXPECT_EQ(p.energy, expected.energy);
+    EXPECT_EQ(p.time, expected.time);
+  }
+  EXPECT_FALSE(reader.read(p));
+}
+
+TEST_P(PulseIOTest, ConvertsToText)
+{
+  std::stringstream file;
+  BinaryPulseWriter writer(file, GetParam(), 100);
+  std::ostringstream expected;
+  TextPulseWriter direct(expected);
+  for (auto const &p : pulses)
+  {
+    writer.write(p);
+    direct.write(p);
+  }
+  writer.flush();
+  direct.flush();
+
+  BinaryPulseReader reader(file);
+  std::ostringstream converted;
+  TextPulseWriter text(converted, true, 256);
+  Pulse p;
+  while (reader.read(p))
+  {
+    text.write(p);
+  }
+  text.flush();
+  EXPECT_EQ(converted.str(), expected.str());
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, PulseIOTest,
+                         ::testing::Values(PulseLayout::RowMajor, PulseLayout::ColumnMajor));
+
+TEST(BinaryPulseReaderTest, RejectsOtherFiles)
+{
+  std::istringstream text(TextPulseWriter::header);
+  EXPECT_THROW(BinaryPulseReader reader(text), std::runtime_error);
+
+  std::stringstream truncated;
+  {
+    Pulse p;
+    p.startPos = p.endPos = {1, 2, 3};
+    BinaryPulseWriter writer(truncated, PulseLayout::RowMajor);
+    writer.write(p);
+    writer.flush();
+  }
+  std::string bytes = truncated.str();
+  std::istringstream cut(bytes.substr(0, bytes.size() - 4));
+  BinaryPulseReader reader(cut);
+  Pulse p;
+  EXPECT_THROW(reader.read(p), std::runtime_error);
+
+  // a corrupt count, far more pulses than the file holds or than fit in memory
+  const std::size_t countOffset = bytes.size() - 80 - sizeof(uint64_t);
+  for (uint64_t count : {uint64_t(1) << 40, ~uint64_t(0)})
+  {
+    std::string corrupt = bytes;
+    std::memcpy(&corrupt[countOffset], &count, sizeof(count));
+    std::istringstream file(corrupt);
+    BinaryPulseReader corruptReader(file);
+    EXPECT_THROW(corruptReader.read(p), std::runtime_error);
+  }
+}
+
+TEST(BinaryPulseReaderTest, KeepsTheCell)
+{
+  std::stringstream file;
+  {
+    Pulse p;
+    p.startPos = p.endPos = {1, 2, 3};
+    p.cellID = 1234;
+    BinaryPulseWriter writer(file, PulseLayout::RowMajor);
+    writer.write(p);
+    writer.flush();
+  }
+  BinaryPulseReader reader(file);
+  Pulse p;
+  ASSERT_TRUE(reader.read(p));
+  EXPECT_EQ(p.cellID, 1234);
+  EXPECT_EQ(p.endPos, std::vector<double>({1, 2, 3}));
+}
+
+TEST(BinaryPulseReaderTest, RejectsOtherVersions)
+{
+  std::stringstream file;
+  {
+    Pulse p;
+    p.startPos = p.endPos = {1, 2, 3};
+    BinaryPulseWriter writer(file, PulseLayout::RowMajor);
+    writer.write(p);
+    writer.flush();
+  }
+  std::string bytes = file.str();
+  const uint32_t version = 2;
+  std::memcpy(&bytes[8], &version, sizeof(version));
+  std::istringstream other(bytes);
+  EXPECT_THROW(BinaryPulseReader reader(other), std::runtime_error);
+}
+
+TEST(TextPulseWriterTest, CellColumn)
+{
+  Pulse p;
+  p.startPos = p.endPos = {1, 2, 3};
+  p.nps = 5;
+  p.energy = 1;
+  p.time = 2;
+  p.cellID = 42;
+  std::ostringstream plain, withCell;
+  TextPulseWriter plainWriter(plain, false);
+  TextPulseWriter cellWriter(withCell, true, 256, true);
+  plainWriter.write(p);
+  cellWriter.write(p);
+  plainWriter.flush();
+  cellWriter.flush();
+
+  std::ostringstream line;
+  line << p;
+  EXPECT_EQ(plain.str(), line.str() + "\n");
+  const std::string text = withCell.str();
+  const std::string firstLine = text.substr(0, text.find('\n'));
+  EXPECT_EQ(firstLine.substr(firstLine.size() - 4), "cell");
+  EXPECT_EQ(text.substr(firstLine.size() + 1), line.str() + "        42\n");
+}
+
+TEST(ColumnPulseWriterTest, OneVectorPerField)
+{
+  ColumnPulseWriter columns;
+  for (int i = 0; i < 3; i++)
+  {
+    Pulse p;
+    p.startPos = {1.0 + i, 2, 3};
+    p.endPos = {4, 5, 6.0 + i};
+    p.nps = 10 + i;
+    p.energy = 0.5 * i;
+    p.time = 100.0 + i;
+    p.cellID = 601 + i;
+    columns.write(p);
+  }
+  ASSERT_EQ(columns.size(), 3u);
+  EXPECT_EQ(columns.startPos, std::vector<double>({1, 2, 3, 2, 2, 3, 3, 2, 3}));
+  EXPECT_EQ(columns.endPos, std::vector<double>({4, 5, 6, 4, 5, 7, 4, 5, 8}));
+  EXPECT_EQ(columns.energy, std::vector<double>({0, 0.5, 1}));
+  EXPECT_EQ(columns.time, std::vector<double>({100, 101, 102}));
+  EXPECT_EQ(columns.nps, std::vector<long>({10, 11, 12}));
+  EXPECT_EQ(columns.cellID, std::vector<long>({601, 602, 603}));
+  columns.clear();
+  EXPECT_EQ(columns.size(), 0u);
+  EXPECT_TRUE(columns.startPos.empty());
+}
@@ -0,0 +1,154 @@
+/**
+* @file readahead_test.cc
+*
+*
+* @brief Test the read-ahead stream buffer
+*
+* @version 1.1
+*/
+#include "parser.hh"
+#include "ptracwriter.hh"
+#include "readahead.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <sstream>
+
+class ReadAheadTest : public ::testing::Test
+{
+public:
+  const std::string path = "readahead_test.bin";
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+
+  std::string writeFile(std::size_t size)
+  {
+    std::string bytes(size, '\0');
+    for (std::size_t i = 0; i < size; i++)
+    {
+      bytes[i] = static_cast<char>(i * 131 + i / 4096);
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+    return bytes;
+  }
+
+  /// reads the whole stream in chunks of odd sizes
+  static std::string readAll(std::istream &stream)
+  {
+    std::string bytes;
+    char chunk[1000];
+    for (std::size_t n = 1; stream.peek() != EOF; n = n % 997 + 3)
+    {
+      stream.read(chunk, n);
+      bytes.append(chunk, stream.gcount());
+    }
+    return bytes;
+  }
+};
+
+TEST_F(ReadAheadTest, ReadsAcrossBlocks)
+{
+  const std::string expected = writeFile(3 * 4096 + 123);
+  ReadAheadOptions options;
+  options.blockSize = 4096;
+  ReadAheadBuffer buffer(path, options);
+  ASSERT_TRUE(buffer.is_open());
+  std::istream stream(&buffer);
+  EXPECT_EQ(readAll(stream), expected);
+  EXPECT_EQ(stream.peek(), EOF);
+}
+
+TEST_F(ReadAheadTest, ReadsWholeBlocks)
+{
+  const std::string expected = writeFile(4 * 4096);
+  ReadAheadOptions options;
+  options.blockSize = 4096;
+  ReadAheadBuffer buffer(path, options);
+  std::istream stream(&buffer);
+  EXPECT_EQ(readAll(stream), expected);
+}
+
+TEST_F(ReadAheadTest, RoundsBlockSize)
+{
+  writeFile(10);
+  ReadAheadOptions options;
+  options.blockSize = 5000;
+  ReadAheadBuffer buffer(path, options);
+  EXPECT_EQ(buffer.getBlockSize(), 8192);
+}
+
+TEST_F(ReadAheadTest, EmptyFile)
+{
+  writeFile(0);
+  ReadAheadBuffer buffer(path);
+  std::istream stream(&buffer);
+  EXPECT_EQ(stream.peek(), EOF);
+}
+
+TEST_F(ReadAheadTest, MissingFile)
+{
+  ReadAheadBuffer buffer("readahead_test.missing");
+  EXPECT_FALSE(buffer.is_open());
+  std::istream stream(&buffer);
+  EXPECT_EQ(stream.peek(), EOF);
+}
+
+TEST_F(ReadAheadTest, DirectIO)
+{
+  // falls back to buffered reads where the file system has no O_DIRECT
+  const std::string expected = writeFile(5 * 4096 + 17);
+  ReadAheadOptions options;
+  options.blockSize = 8192;
+  options.direct = true;
+  ReadAheadBuffer buffer(path, options);
+  ASSERT_TRUE(buffer.is_open());
+  std::istream stream(&buffer);
+  EXPECT_EQ(readAll(stream), expected);
+}
+
+TEST_F(ReadAheadTest, ReadsAheadOfStreamBuffer)
+{
+  const std::string expected = writeFile(3 * 4096 + 5);
+  std::stringbuf source(expected);
+  ReadAheadOptions options;
+  options.blockSize = 4096;
+  ReadAheadBuffer buffer(source, options);
+  ASSERT_TRUE(buffer.is_open());
+  char magic[4];
+  ASSERT_EQ(buffer.peek(magic, sizeof(magic)), sizeof(magic));
+  EXPECT_EQ(std::string(magic, 4), expected.substr(0, 4));
+  std::istream stream(&buffer);
+  EXPECT_EQ(readAll(stream), expected);
+}
+
+TEST_F(ReadAheadTest, BlockSizeDoesNotChangeHistories)
+{
+  SyntheticPTRACWriter writer(path);
+  for (long nps = 1; nps <= 200; nps++)
+  {
+    writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3));
+  }
+  writer.close();
+
+  ReadAheadOptions small;
+  small.blockSize = 4096;
+  MCNPPTRACBinary expected(path);
+  MCNPPTRACBinary actual(path, small);
+  long histories = 0;
+  while (expected.readNextNPS(1e9))
+  {
+    ASSERT_TRUE(actual.readNextNPS(1e9));
+    const NPSHistory &e = expected.getNPSHistory();
+    const NPSHistory &a = actual.getNPSHistory();
+    ASSERT_EQ(a.nbEvents(), e.nbEvents());
+    EXPECT_EQ(a.nps, e.nps);
+    EXPECT_EQ(a.time, e.time);
+    EXPECT_EQ(a.energy, e.energy);
+    histories++;
+  }
+  EXPECT_EQ(histories, 200);
+  EXPECT_FALSE(actual.readNextNPS(1e9));
+}
@@ -0,0 +1,238 @@
+/**
+* @file recovery_test.cc
+*
+*
+* @brief Test skipping corrupt and truncated regions of PTRAC files
+*
+* @version 1.1
+*/
+#include "historyvisitor.hh"
+#include "multireader.hh"
+#include "parallelparser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+
+namespace
+{
+struct NPSVisitor : public HistoryVisitor
+{
+  std::vector<long> npsList;
+  void onHistoryBegin(long nps) { npsList.push_back(nps); }
+  void onHistoryAbort(long) { npsList.pop_back(); }
+};
+} // namespace
+
+class RecoveryTest : public ::testing::Test
+{
+public:
+  const std::string path = "recovery_test.ptrac";
+  const long nbHistories = 100;
+  const long badNPS = 50;
+  // where the history badNPS starts and ends in the file
+  std::size_t badBegin;
+  std::size_t badEnd;
+  std::size_t fileSize;
+
+  void SetUp()
+  {
+    SyntheticPTRACWriter writer(path);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      if (nps == badNPS)
+        badBegin = writer.size();
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 2));
+      if (nps == badNPS)
+        badEnd = writer.size();
+    }
+    fileSize = writer.size();
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+
+  void overwrite(std::size_t offset, std::string const &bytes)
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(offset);
+    file.write(bytes.data(), bytes.size());
+  }
+
+  /// breaks the record marker of the first data line of the history badNPS
+  void corruptHistory()
+  {
+    const std::size_t firstDataLine = badBegin + 2 * sizeof(int32_t) + 2 * sizeof(long);
+    overwrite(firstDataLine, std::string("\x39\x30\x00\x00", 4));
+  }
+
+  /// NPS of all the histories that can be read
+  template <typename Reader>
+  std::vector<long> readAll(Reader &reader)
+  {
+    std::vector<long> npsList;
+    while (reader.readNextNPS(1e9))
+    {
+      npsList.push_back(reader.getNPSHistory().nps.front());
+    }
+    return npsList;
+  }
+
+  std::vector<long> allBut(long missing)
+  {
+    std::vector<long> npsList;
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      if (nps != missing)
+        npsList.push_back(nps);
+    }
+    return npsList;
+  }
+};
+
+TEST_F(RecoveryTest, CleanFileReadsTheSame)
+{
+  MCNPPTRACMmap ptrac(path);
+  ptrac.setRecovery(true);
+  EXPECT_EQ(readAll(ptrac), allBut(0));
+  EXPECT_TRUE(ptrac.getSkippedRegions().empty());
+}
+
+TEST_F(RecoveryTest, ThrowsWithoutRecovery)
+{
+  corruptHistory();
+  MCNPPTRACMmap ptrac(path);
+  EXPECT_THROW(readAll(ptrac), std::logic_error);
+}
+
+TEST_F(RecoveryTest, SkipsCorruptHistory)
+{
+  corruptHistory();
+  MCNPPTRACMmap ptrac(path);
+  ptrac.setRecovery(true);
+  EXPECT_EQ(readAll(ptrac), allBut(badNPS));
+  ASSERT_EQ(ptrac.getSkippedRegions().size(), 1u);
+  SkippedRegion const &region = ptrac.getSkippedRegions().front();
+  EXPECT_EQ(region.path, path);
+  EXPECT_EQ(region.offset, badBegin);
+  EXPECT_EQ(region.length, badEnd - badBegin);
+  EXPECT_EQ(region.lastNPS, badNPS - 1);
+  EXPECT_FALSE(region.reason.empty());
+}
+
+TEST_F(RecoveryTest, SkipsCorruptNPSLine)
+{
+  overwrite(badBegin, std::string("\xff\xff\xff\xff", 4));
+  MCNPPTRACMmap ptrac(path);
+  ptrac.setRecovery(true);
+  EXPECT_EQ(readAll(ptrac), allBut(badNPS));
+  ASSERT_EQ(ptrac.getSkippedRegions().size(), 1u);
+  EXPECT_EQ(ptrac.getSkippedRegions().front().length, badEnd - badBegin);
+}
+
+TEST_F(RecoveryTest, SkipsTruncatedTail)
+{
+  ASSERT_EQ(truncate(path.c_str(), fileSize - 10), 0);
+  MCNPPTRACMmap ptrac(path);
+  ptrac.setRecovery(true);
+  std::vector<long> expected = allBut(nbHistories);
+  EXPECT_EQ(readAll(ptrac), expected);
+  ASSERT_EQ(ptrac.getSkippedRegions().size(), 1u);
+  SkippedRegion const &region = ptrac.getSkippedRegions().front();
+  EXPECT_EQ(region.offset + region.length, fileSize - 10);
+  EXPECT_EQ(region.lastNPS, nbHistories - 1);
+}
+
+TEST_F(RecoveryTest, SkipsGarbageBetweenHistories)
+{
+  // shift the end of the file by some garbage inserted after history badNPS
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+  bytes.insert(badEnd, std::string(37, '\x5a'));
+  std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+
+  MCNPPTRACMmap ptrac(path);
+  ptrac.setRecovery(true);
+  EXPECT_EQ(readAll(ptrac), allBut(0));
+  ASSERT_EQ(ptrac.getSkippedRegions().size(), 1u);
+  EXPECT_EQ(ptrac.getSkippedRegions().front().offset, badEnd);
+  EXPECT_EQ(ptrac.getSkippedRegions().front().length, 37u);
+  EXPECT_EQ(ptrac.getSkippedRegions().front().lastNPS, badNPS);
+}
+
+TEST_F(RecoveryTest, ParallelAndVisitorSkipToo)
+{
+  corruptHistory();
+  MCNPPTRACParallel parallel(path, 2, 16);
+  parallel.setRecovery(true);
+  EXPECT_EQ(readAll(parallel), allBut(badNPS));
+  EXPECT_EQ(parallel.getSkippedRegions().size(), 1u);
+
+  MCNPPTRACMmap visited(path);
+  visited.setRecovery(true);
+  NPSVisitor visitor;
+  EXPECT_EQ(visited.visit(visitor), nbHistories - 1);
+  EXPECT_EQ(visitor.npsList, allBut(badNPS));
+  EXPECT_EQ(visited.getSkippedRegions().size(), 1u);
+}
+
+TEST_F(RecoveryTest, VisitorDropsAbortedHistory)
+{
+  EventColumns clean;
+  {
+    MCNPPTRACMmap ptrac(path);
+    ptrac.visit(clean);
+  }
+  // the last record of history badNPS is broken, its first events are visited
+  overwrite(badEnd - sizeof(int32_t), std::string("\x39\x30\x00\x00", 4));
+  MCNPPTRACMmap ptrac(path);
+  ptrac.setRecovery(true);
+  EventColumns columns;
+  EXPECT_EQ(ptrac.visit(columns), nbHistories - 1);
+  ASSERT_EQ(ptrac.getSkippedRegions().size(), 1u);
+  EXPECT_EQ(ptrac.getSkippedRegions().front().offset, badBegin);
+
+  const long badEvents = std::count(clean.nps.begin(), clean.nps.end(), badNPS);
+  ASSERT_GT(badEvents, 0);
+  EXPECT_EQ(std::count(columns.nps.begin(), columns.nps.end(), badNPS), 0);
+  EXPECT_EQ(columns.nbEvents(), clean.nbEvents() - badEvents);
+  EXPECT_EQ(columns.particleOffsets.back(), columns.nbEvents());
+  EXPECT_EQ(columns.nps.back(), nbHistories);
+}
+
+TEST_F(RecoveryTest, MultipleFilesRenumberRegions)
+{
+  const std::string clean = "recovery_test_clean.ptrac";
+  writeSyntheticPTRAC(clean, nbHistories, std::size_t(1) << 30);
+  corruptHistory();
+  MCNPPTRACMulti multi({clean, path}, 2, 16);
+  multi.setRecovery(true);
+  EXPECT_EQ(readAll(multi).size(), static_cast<std::size_t>(2 * nbHistories - 1));
+  ASSERT_EQ(multi.getSkippedRegions().size(), 1u);
+  EXPECT_EQ(multi.getSkippedRegions().front().path, path);
+  EXPECT_EQ(multi.getSkippedRegions().front().lastNPS, nbHistories + badNPS - 1);
+  std::remove(clean.c_str());
+}
+
+TEST_F(RecoveryTest, MultipleFilesRejectCompressedFiles)
+{
+  // only the magic number is read before recovery is refused
+  const std::string compressed = "recovery_test.ptrac.gz";
+  std::ofstream(compressed, std::ios::binary) << std::string("\x1f\x8b\x08\x00", 4);
+  MCNPPTRACMulti multi({path, compressed}, 2, 16);
+  EXPECT_THROW(multi.setRecovery(true), std::invalid_argument);
+  EXPECT_NO_THROW(multi.setRecovery(false));
+  std::remove(compressed.c_str());
+}
+
+TEST_F(RecoveryTest, StreamingReaderCannotSkip)
+{
+  MCNPPTRACBinary ptrac(path);
+  EXPECT_THROW(ptrac.setRecovery(true), std::invalid_argument);
+  EXPECT_NO_THROW(ptrac.setRecovery(false));
+}
@@ -0,0 +1,214 @@
+/**
+* @file schema_test.cc
+*
+*
+* @brief Test of the decoding of the PTRAC data line layouts
+*
+* @version 1.1
+*/
+#include "eventlayouts.hh"
+#include "mmapparser.hh"
+#include "ptracwriter.hh"
+#include "gtest/gtest.h"
+#include <cstdio>
+
+class SchemaTest : public ::testing::Test
+{
+public:
+  const std::string path = "schema_test.ptrac";
+
+  // collision lines without weight and with the fields in another order,
+  // terminations without cell
+  std::vector<SyntheticLayout> filteredLayouts()
+  {
+    std::vector<SyntheticLayout> layouts(NbEventTypes, SyntheticLayout::standard());
+    layouts[ColEvent] = SyntheticLayout{{17, 7}, {28, 26, 20, 21, 22}};
+    layouts[TerEvent] = SyntheticLayout{{7, 8}, {20, 21, 22, 26, 27, 28}};
+    return layouts;
+  }
+
+  void writeFile(std::vector<SyntheticLayout> const &layouts, long nbHistories)
+  {
+    SyntheticPTRACWriter writer(path, layouts);
+    for (long nps = 1; nps <= nbHistories; nps++)
+    {
+      writer.writeHistory(SyntheticPTRACWriter::makeHistory(nps, 1 + nps % 3));
+    }
+    writer.close();
+  }
+
+  void TearDown()
+  {
+    std::remove(path.c_str());
+  }
+};
+
+TEST_F(SchemaTest, StandardLayout)
+{
+  writeFile(std::vector<SyntheticLayout>(NbEventTypes, SyntheticLayout::standard()), 1);
+  MappedFile file(path);
+  const char *cursor = file.begin();
+  std::size_t length6, length7;
+  for (int i = 0; i < 4; i++)
+  {
+    nextRecord(cursor, file.end(), length6);
+  }
+  const char *line6 = nextRecord(cursor, file.end(), length6);
+  const char *line7 = nextRecord(cursor, file.end(), length7);
+  const PTRACSchema schema = parseSchema(line6, length6, line7, length7);
+
+  EXPECT_EQ(schema.idNum.nbDataNPS, 2);
+  for (auto const &event : schema.events)
+  {
+    EXPECT_EQ(event.nbLong, 6);
+    EXPECT_EQ(event.nbDouble, 9);
+    EXPECT_EQ(event.length, 15 * sizeof(double));
+    EXPECT_TRUE(event.exactLength);
+    // the historical field positions
+    EXPECT_EQ(event.next, 0);
+    EXPECT_EQ(event.cell, 5 * sizeof(double));
+    EXPECT_EQ(event.x, 6 * sizeof(double));
+    EXPECT_EQ(event.erg, 12 * sizeof(double));
+    EXPECT_EQ(event.wt, 13 * sizeof(double));
+    EXPECT_EQ(event.tme, 14 * sizeof(double));
+  }
+}
+
+TEST_F(SchemaTest, PerEventTypeLayouts)
+{
+  writeFile(filteredLayouts(), 30);
+  MCNPPTRACMmap mapped(path);
+  MCNPPTRACBinary streamed(path);
+  long histories = 0;
+  while (mapped.readNextNPS(1000))
+  {
+    ASSERT_TRUE(streamed.readNextNPS(1000));
+    for (NPSHistory const *record : {&mapped.getNPSHistory(), &streamed.getNPSHistory()})
+    {
+      ASSERT_EQ(record->size(), 1 + (histories + 1) % 3);
+      for (std::size_t p = 0; p < record->size(); p++)
+      {
+        ParticleHistory parHist = (*record)[p];
+        ASSERT_EQ(parHist.size(), 4);
+        const Event bank = parHist[0], collision = parHist[2], termination = parHist[3];
+        EXPECT_EQ(bank.cellID, 602);
+        EXPECT_EQ(bank.weight, 1.0);
+        EXPECT_EQ(collision.eventID, 4000);
+        EXPECT_EQ(collision.cellID, 601);
+        EXPECT_EQ(collision.pos, (std::array<double, 3>{2.0 * p, 3.0, 4.0}));
+        EXPECT_EQ(collision.energy, 1.0 + 0.1 * p - 0.5);
+        EXPECT_EQ(collision.weight, 0.);
+        EXPECT_EQ(collision.time, 1.0e6 * (histories + 1) + 10.0 * p + 2.0);
+        EXPECT_EQ(termination.cellID, -1);
+        EXPECT_EQ(termination.time, 1.0e6 * (histories + 1) + 10.0 * p + 3.0);
+      }
+    }
+    histories++;
+  }
+  EXPECT_EQ(histories, 30);
+}
+
+TEST_F(SchemaTest, CellFilterNeedsACellField)
+{
+  // terminations without cell can still be filtered on the other events
+  writeFile(filteredLayouts(), 3);
+  {
+    MCNPPTRACMmap mapped(path);
+    EXPECT_NO_THROW(mapped.setProjection(EventProjection::pulses({601})));
+  }
+
+  std::vector<SyntheticLayout> layouts(NbEventTypes, SyntheticLayout{{7, 8, 10, 12, 13}, {20, 21, 22, 26, 27, 28}});
+  writeFile(layouts, 3);
+  MCNPPTRACMmap mapped(path);
+  MCNPPTRACBinary streamed(path);
+  for (MCNPPTRAC *reader : std::vector<MCNPPTRAC *>{&mapped, &streamed})
+  {
+    EXPECT_THROW(reader->setProjection(EventProjection::pulses({601})), std::invalid_argument);
+    // the projection in place is kept, every particle is still read
+    EXPECT_TRUE(reader->getProjection().cells.empty());
+    long histories = 0;
+    while (reader->readNextNPS(1000))
+    {
+      EXPECT_EQ(reader->getNPSHistory().size(), 1 + (histories + 1) % 3);
+      histories++;
+    }
+    EXPECT_EQ(histories, 3);
+  }
+}
+
+TEST(ParseSchemaTest, MissingNextEventIsRejected)
+{
+  std::string line6, line7;
+  const int32_t nbDataNPS = 1;
+  line6.append(reinterpret_cast<const char *>(&nbDataNPS), sizeof(nbDataNPS));
+  for (int i = 0; i < 2 * NbEventTypes; i++)
+  {
+    const long count = 1;
+    line6.append(reinterpret_cast<const char *>(&count), sizeof(count));
+  }
+  const long npsID = 1;
+  line7.append(reinterpret_cast<const char *>(&npsID), sizeof(npsID));
+  for (int i = 0; i < 2 * NbEventTypes; i++)
+  {
+    const int32_t id = 17 + 3 * (i % 2);
+    line7.append(reinterpret_cast<const char *>(&id), sizeof(id));
+  }
+  EXPECT_THROW(parseSchema(line6.data(), line6.size(), line7.data(), line7.size()), std::logic_error);
+}
+
+TEST(ParseSchemaTest, EventTypes)
+{
+  EXPECT_EQ(eventType(1000), SrcEvent);
+  EXPECT_EQ(eventType(2030), BnkEvent);
+  EXPECT_EQ(eventType(-2033), BnkEvent);
+  EXPECT_EQ(eventType(3000), SufEvent);
+  EXPECT_EQ(eventType(4000), ColEvent);
+  EXPECT_EQ(eventType(5000), TerEvent);
+  EXPECT_EQ(eventType(9000), -1);
+  EXPECT_EQ(eventType(0), -1);
+}
+
+TEST(SelectDecodersTest, KnownLayoutsAreSpecialized)
+{
+  const std::size_t d = sizeof(double);
+  PTRACSchema schema;
+  schema.events[SrcEvent] = EventSchema{6, 9, 15 * d, true, 0, 5 * d, 6 * d, 7 * d, 8 * d, 12 * d, 13 * d, 14 * d};
+  schema.events[BnkEvent] = EventSchema{2, 6, 8 * d, true, 0, d, 2 * d, 3 * d, 4 * d, 5 * d, 6 * d, 7 * d};
+  // compact layout without weight
+  schema.events[SufEvent] = EventSchema{2, 6, 8 * d, true, 0, d, 2 * d, 3 * d, 4 * d, 5 * d, EventSchema::absent, 7 * d};
+  // standard positions, but only the minimum length is known
+  schema.events[ColEvent] = schema.events[SrcEvent];
+  schema.events[ColEvent].exactLength = false;
+  schema.events[TerEvent] = schema.events[SrcEvent];
+  selectDecoders(schema);
+
+  EXPECT_EQ(schema.decoders[SrcEvent], &StandardLayout::decode);
+  EXPECT_EQ(schema.decoders[BnkEvent], &CompactLayout::decode);
+  EXPECT_EQ(schema.decoders[SufEvent], &decodeEventGeneric);
+  EXPECT_EQ(schema.decoders[ColEvent], &decodeEventGeneric);
+  EXPECT_EQ(schema.decoders[TerEvent], &StandardLayout::decode);
+
+  // both decoders read the same values
+  double values[15];
+  for (int i = 0; i < 15; i++)
+  {
+    values[i] = 100 + i;
+  }
+  values[0] = 5000;
+  const char *record = reinterpret_cast<const char *>(values);
+  NPSHistory history;
+  EXPECT_EQ(decodeEventGeneric(record, sizeof(values), schema.events[SrcEvent], 3, 1000, history), 5000);
+  EXPECT_EQ(StandardLayout::decode(record, sizeof(values), schema.events[SrcEvent], 3, 1000, history), 5000);
+  EXPECT_THROW(StandardLayout::decode(record, sizeof(values) - 8, schema.events[SrcEvent], 3, 1000, history),
+               std::logic_error);
+  history.endParticle();
+  ASSERT_EQ(history[0].size(), 2);
+  const Event generic = history[0][0], specialized = history[0][1];
+  EXPECT_EQ(generic.cellID, 105);
+  EXPECT_EQ(specialized.cellID, 105);
+  EXPECT_EQ(generic.pos, specialized.pos);
+  EXPECT_EQ(generic.energy, specialized.energy);
+  EXPECT_EQ(generic.weight, specialized.weight);
+  EXPECT_EQ(generic.time, 114);
+  EXPECT_EQ(specialized.time, 114);
+}
@@ -0,0 +1,191 @@
+/**
+* @file timesort_test.cc
+*
+*
+* @brief Test of the time-sorted pulse train
+*
+* @version 1.1
+*/
+#include "timesort.hh"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// keeps the pulses written to it
+class CollectingWriter : public PulseWriter
+{
+public:
+  std::vector<Pulse> pulses;
+  int nbFlushes = 0;
+  void write(const Pulse &p) { pulses.push_back(p); }
+  void flush() { nbFlushes++; }
+};
+
+class TimeSortTest : public ::testing::Test
+{
+public:
+  const std::string runDirectory = "timesort_test_runs";
+  std::vector<Pulse> pulses;
+
+  void SetUp()
+  {
+    mkdir(runDirectory.c_str(), 0755);
+    std::mt19937_64 generator(7);
+    for (long i = 0; i < 5000; i++)
+    {
+      Pulse p;
+      p.nps = i;
+      p.startPos = {0.1 * i, 0, 0};
+      p.endPos = {0.1 * i, 1, 0};
+      p.energy = 1;
+      // plenty of equal times
+      p.time = static_cast<double>(generator() % 1000);
+      p.cellID = 601 + i % 3;
+      pulses.push_back(p);
+    }
+  }
+
+  void TearDown()
+  {
+    rmdir(runDirectory.c_str());
+  }
+
+  std::size_t nbFilesInRunDirectory()
+  {
+    std::size_t count = 0;
+    DIR *dir = opendir(runDirectory.c_str());
+    while (dirent *entry = readdir(dir))
+    {
+      count += entry->d_name[0] != '.';
+    }
+    closedir(dir);
+    return count;
+  }
+
+  void expectSortedAndStable(std::vector<Pulse> const &sorted)
+  {
+    std::vector<Pulse> expected(pulses);
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](Pulse const &a, Pulse const &b) { return a.time < b.time; });
+    ASSERT_EQ(sorted.size(), expected.size());
+    for (std::size_t i = 0; i < sorted.size(); i++)
+    {
+      ASSERT_EQ(sorted[i].nps, expected[i].nps) << "pulse " << i;
+      EXPECT_EQ(sorted[i].time, expected[i].time);
+      EXPECT_EQ(sorted[i].startPos, expected[i].startPos);
+      EXPECT_EQ(sorted[i].endPos, expected[i].endPos);
+      EXPECT_EQ(sorted[i].cellID, expected[i].cellID);
+    }
+  }
+};
+
+TEST_F(TimeSortTest, InMemory)
+{
+  CollectingWriter out;
+  TimeSortOptions options;
+  options.runDirectory = runDirectory;
+  TimeSortingWriter sorter(out, options);
+  for (auto const &p : pulses)
+    sorter.write(p);
+  EXPECT_TRUE(out.pulses.empty());
+  sorter.flush();
+  EXPECT_EQ(sorter.getNbRuns(), 0);
+  EXPECT_EQ(out.nbFlushes, 1);
+  expectSortedAndStable(out.pulses);
+}
+
+TEST_F(TimeSortTest, SpillsAndMergesRuns)
+{
+  CollectingWriter out;
+  TimeSortOptions options;
+  options.runDirectory = runDirectory;
+  // room for about 300 pulses
+  options.memoryBudget = 300 * 80;
+  {
+    TimeSortingWriter sorter(out, options);
+    for (auto const &p : pulses)
+      sorter.write(p);
+    EXPECT_GE(sorter.getNbRuns(), 16);
+    EXPECT_EQ(nbFilesInRunDirectory(), sorter.getNbRuns());
+    sorter.flush();
+    EXPECT_EQ(nbFilesInRunDirectory(), 0);
+  }
+  expectSortedAndStable(out.pulses);
+}
+
+TEST_F(TimeSortTest, RunsAreRemovedWithoutFlush)
+{
+  CollectingWriter out;
+  TimeSortOptions options;
+  options.runDirectory = runDirectory;
+  options.memoryBudget = 1000;
+  {
+    TimeSortingWriter sorter(out, options);
+    for (auto const &p : pulses)
+      sorter.write(p);
+    EXPECT_GT(nbFilesInRunDirectory(), 0);
+  }
+  EXPECT_EQ(nbFilesInRunDirectory(), 0);
+}
+
+TEST_F(TimeSortTest, MissingRunDirectory)
+{
+  CollectingWriter out;
+  TimeSortOptions options;
+  options.runDirectory = "no/such/directory";
+  options.memoryBudget = 1;
+  TimeSortingWriter sorter(out, options);
+  EXPECT_THROW(sorter.write(pulses[0]), std::runtime_error);
+}
+
+TEST(SourceTimelineTest, PoissonGaps)
+{
+  const double rate = 1e5; // 1000 shakes between histories on average
+  SourceTimeline timeline(rate, 3);
+  double last = 0, sum = 0;
+  const long n = 100000;
+  for (long nps = 1; nps <= n; nps++)
+  {
+    const double offset = timeline.offset(nps);
+    EXPECT_GT(offset, last);
+    // all the pulses of a history start at the same time
+    EXPECT_EQ(timeline.offset(nps), offset);
+    sum += offset - last;
+    last = offset;
+  }
+  EXPECT_NEAR(sum / n, 1000, 20);
+  EXPECT_THROW(timeline.offset(n - 1), std::logic_error);
+
+  // same seed, same timeline, even when histories are skipped
+  SourceTimeline again(rate, 3), skipping(rate, 3);
+  EXPECT_EQ(again.offset(1), SourceTimeline(rate, 3).offset(1));
+  EXPECT_GT(skipping.offset(1000), 0.5e6);
+  EXPECT_LT(skipping.offset(1000), 1.5e6);
+
+  EXPECT_THROW(SourceTimeline(0), std::invalid_argument);
+}
+
+TEST(TimeOffsetWriterTest, ShiftsWholeHistories)
+{
+  CollectingWriter out;
+  TimeOffsetWriter shifter(out, SourceTimeline(1e6, 5));
+  Pulse p;
+  p.startPos = p.endPos = {0, 0, 0};
+  for (long nps : {1, 1, 2, 5, 5})
+  {
+    p.nps = nps;
+    p.time = 10 * nps;
+    shifter.write(p);
+  }
+  shifter.flush();
+  EXPECT_EQ(out.nbFlushes, 1);
+  ASSERT_EQ(out.pulses.size(), 5);
+  SourceTimeline expected(1e6, 5);
+  const double offsets[] = {expected.offset(1), expected.offset(2), expected.offset(5)};
+  EXPECT_EQ(out.pulses[0].time, 10 + offsets[0]);
+  EXPECT_EQ(out.pulses[1].time, 10 + offsets[0]);
+  EXPECT_EQ(out.pulses[2].time, 20 + offsets[1]);
+  EXPECT_EQ(out.pulses[4].time, 50 + offsets[2]);
+}